@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "attractor_cache.h"
+
+#ifdef _WIN32
+#define RA_CACHE_SEPARATOR '\\'
+#else
+#define RA_CACHE_SEPARATOR '/'
+#endif
+
+/**
+ * Create every directory leading up to the file at the given path. Failures
+ * are ignored, because most of them already exist, and anything else will
+ * make the file itself fail to open anyway.
+ */
+static void ra_cache_make_parents(const char *path)
+{
+    char prefix[RA_CACHE_PATH_LENGTH];
+    snprintf(prefix, sizeof(prefix), "%s", path);
+
+    for (char *c = prefix + 1; *c != '\0'; c++)
+    {
+        if (*c != RA_CACHE_SEPARATOR) continue;
+
+        *c = '\0';
+#ifdef _WIN32
+        _mkdir(prefix);
+#else
+        mkdir(prefix, 0755);
+#endif
+        *c = RA_CACHE_SEPARATOR;
+    }
+}
+
+static bool ra_cache_header_is_valid(const struct AttractorCacheHeader *header)
+{
+    return strncmp(header->magic, RA_CACHE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == RA_CACHE_VERSION
+        && header->record_size == sizeof(struct AttractorRecord);
+}
+
+/**
+ * Work out where the cache lives, and make sure its directory exists:
+ * - Windows: %LOCALAPPDATA%\RandomAttractors\attractors.racache
+ * - Others:  $XDG_CACHE_HOME/random_attractors/attractors.racache,
+ *            where XDG_CACHE_HOME defaults to ~/.cache
+ *
+ * @returns false if there's nowhere sensible to put it
+ */
+bool ra_cache_default_path(char *path, size_t size)
+{
+    int length = -1;
+
+#ifdef _WIN32
+    const char *local_app_data = getenv("LOCALAPPDATA");
+    if (local_app_data && local_app_data[0] != '\0')
+    {
+        length = snprintf(path, size, "%s\\RandomAttractors\\attractors.racache", local_app_data);
+    }
+#else
+    const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+    const char *home           = getenv("HOME");
+    if (xdg_cache_home && xdg_cache_home[0] != '\0')
+    {
+        length = snprintf(path, size, "%s/random_attractors/attractors.racache", xdg_cache_home);
+    }
+    else if (home && home[0] != '\0')
+    {
+        length = snprintf(path, size, "%s/.cache/random_attractors/attractors.racache", home);
+    }
+#endif
+
+    if (length < 0 || (size_t)length >= size) return false;
+
+    ra_cache_make_parents(path);
+    return true;
+}
+
+/**
+ * Memory-map a cache file. Any trailing partial record (from a write that
+ * was interrupted) is ignored.
+ *
+ * @returns false if the file doesn't exist, is empty or is from another
+ *          version, in which case the cache is left empty.
+ */
+bool ra_cache_open(struct AttractorCache *cache, const char *path)
+{
+    memset(cache, 0, sizeof(*cache));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)
+        || (size_t)file_size.QuadPart < sizeof(struct AttractorCacheHeader))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping_handle == NULL) return false;
+
+    void *mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (mapping == NULL)
+    {
+        CloseHandle(mapping_handle);
+        return false;
+    }
+
+    cache->mapping        = mapping;
+    cache->mapping_size   = (size_t)file_size.QuadPart;
+    cache->mapping_handle = mapping_handle;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0
+        || (size_t)file_stat.st_size < sizeof(struct AttractorCacheHeader))
+    {
+        close(file);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) return false;
+
+    cache->mapping      = mapping;
+    cache->mapping_size = (size_t)file_stat.st_size;
+#endif
+
+    const struct AttractorCacheHeader *header = cache->mapping;
+    if (!ra_cache_header_is_valid(header))
+    {
+        ra_cache_close(cache);
+        return false;
+    }
+
+    cache->records = (const struct AttractorRecord *)(header + 1);
+    cache->count   = (cache->mapping_size - sizeof(*header)) / sizeof(struct AttractorRecord);
+    return cache->count > 0;
+}
+
+void ra_cache_close(struct AttractorCache *cache)
+{
+    if (cache->mapping)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(cache->mapping);
+        CloseHandle(cache->mapping_handle);
+#else
+        munmap(cache->mapping, cache->mapping_size);
+#endif
+    }
+
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * Guard against records from a damaged file, which would otherwise be drawn
+ * as garbage (or not at all).
+ */
+bool ra_cache_record_is_valid(const struct AttractorRecord *record)
+{
+    if (record->candidate.family <= RA_FAMILY_NONE || RA_FAMILY_COUNT <= record->candidate.family)
+        return false;
+
+    for (int i = 0; i < RA_ENGINE_PREVIOUS_LENGTH; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            float v = record->candidate.previous[i][c];
+            if (!(-1e3f <= v && v <= 1e3f)) return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Append records to the end of a cache file, creating it if necessary.
+ *
+ * @returns false if the file couldn't be written, belongs to another version,
+ *          is damaged, or already holds RA_CACHE_MAX_RECORDS
+ */
+bool ra_cache_append(const char *path, const struct AttractorRecord *records, size_t count)
+{
+    FILE *file = fopen(path, "ab+");
+    if (file == NULL) return false;
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+
+    bool ok = true;
+    if (file_size <= 0)
+    {
+        struct AttractorCacheHeader header = {
+            .magic       = RA_CACHE_MAGIC,
+            .version     = RA_CACHE_VERSION,
+            .record_size = sizeof(struct AttractorRecord),
+        };
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    else
+    {
+        struct AttractorCacheHeader header = { 0 };
+        fseek(file, 0, SEEK_SET);
+        ok = fread(&header, sizeof(header), 1, file) == 1 && ra_cache_header_is_valid(&header);
+
+        // A torn record at the end would misalign everything appended after it
+        size_t body     = (size_t)file_size - sizeof(header);
+        size_t existing = body / sizeof(struct AttractorRecord);
+        ok              = ok && body % sizeof(struct AttractorRecord) == 0;
+        ok              = ok && existing + count <= RA_CACHE_MAX_RECORDS;
+
+        // Append mode writes at the end regardless of where we just read
+        fseek(file, 0, SEEK_END);
+    }
+
+    ok = ok && fwrite(records, sizeof(struct AttractorRecord), count, file) == count;
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+/**
+ * Replace a cache file with the given records. Used for catalogs, which are
+ * written in one go rather than appended to.
+ */
+bool ra_cache_write(const char *path, const struct AttractorRecord *records, size_t count)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    struct AttractorCacheHeader header = {
+        .magic       = RA_CACHE_MAGIC,
+        .version     = RA_CACHE_VERSION,
+        .record_size = sizeof(struct AttractorRecord),
+    };
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok      = ok && fwrite(records, sizeof(struct AttractorRecord), count, file) == count;
+    ok      = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+/**
+ * The given path with suffix in place of its extension
+ */
+static bool ra_cache_swap_extension(char *path, size_t size, const char *from, const char *suffix)
+{
+    const char *separator = strrchr(from, RA_CACHE_SEPARATOR);
+    const char *extension = strrchr(from, '.');
+    int         stem      = (int)strlen(from);
+    if (extension && (separator == NULL || separator < extension)) stem = (int)(extension - from);
+
+    int length = snprintf(path, size, "%.*s%s", stem, from, suffix);
+    return 0 <= length && (size_t)length < size;
+}
+
+/**
+ * Work out where the proposal file for the given cache lives, which is the
+ * cache's path with RA_PROPOSAL_SUFFIX in place of its extension.
+ */
+bool ra_cache_proposal_path(char *path, size_t size, const char *cache_path)
+{
+    return ra_cache_swap_extension(path, size, cache_path, RA_PROPOSAL_SUFFIX);
+}
+
+/**
+ * Work out where the cache of attractors found with an equations file lives,
+ * which is next to it, with RA_CACHE_SUFFIX in place of its extension.
+ * Custom attractors are only worth anything with the equations they were
+ * found with, so they're kept apart from the rest.
+ *
+ * @returns false if that would be the equations file itself
+ */
+bool ra_cache_equations_path(char *path, size_t size, const char *equations_path)
+{
+    return ra_cache_swap_extension(path, size, equations_path, RA_CACHE_SUFFIX)
+        && strcmp(path, equations_path) != 0;
+}
+
+/**
+ * Read a file of the given kind, which is a header followed by one struct
+ * of the given size.
+ *
+ * @returns false if the file doesn't exist, is damaged or is from another
+ *          version, in which case data is left zeroed.
+ */
+static bool ra_cache_read_single(const char *path, const char *magic, void *data, size_t size)
+{
+    memset(data, 0, size);
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    struct AttractorCacheHeader header = { 0 };
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && strncmp(header.magic, magic, sizeof(header.magic)) == 0
+           && header.version == RA_CACHE_VERSION
+           && header.record_size == size;
+    ok = ok && fread(data, size, 1, file) == 1;
+    fclose(file);
+
+    if (!ok) memset(data, 0, size);
+    return ok;
+}
+
+/**
+ * Replace a file of the given kind with the given struct.
+ */
+static bool ra_cache_write_single(const char *path, const char *magic, const void *data,
+    size_t size)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+
+    struct AttractorCacheHeader header = {
+        .version     = RA_CACHE_VERSION,
+        .record_size = (uint32_t)size,
+    };
+    snprintf(header.magic, sizeof(header.magic), "%s", magic);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    ok      = ok && fwrite(data, size, 1, file) == 1;
+    ok      = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+/**
+ * Read what an earlier run learned about the proposal.
+ */
+bool ra_cache_read_proposal(const char *path, struct AttractorProposalStats *stats)
+{
+    return ra_cache_read_single(path, RA_PROPOSAL_MAGIC, stats, sizeof(*stats));
+}
+
+bool ra_cache_write_proposal(const char *path, const struct AttractorProposalStats *stats)
+{
+    return ra_cache_write_single(path, RA_PROPOSAL_MAGIC, stats, sizeof(*stats));
+}
+
+/**
+ * Read a chaos atlas from ra_mine.
+ *
+ * @returns false if the file doesn't exist, is damaged or is from another
+ *          version
+ */
+bool ra_cache_read_atlas(const char *path, struct AttractorAtlas *atlas)
+{
+    return ra_cache_read_single(path, RA_ATLAS_MAGIC, atlas, sizeof(*atlas))
+        && ra_engine_atlas_is_valid(atlas);
+}
+
+bool ra_cache_write_atlas(const char *path, const struct AttractorAtlas *atlas)
+{
+    return ra_cache_write_single(path, RA_ATLAS_MAGIC, atlas, sizeof(*atlas));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "attractor_engine.h"
+
+//
+// A flat binary file of attractors that have already passed the suitability
+// test, so they can be drawn again without searching.
+//
+// The file is a header followed by tightly packed AttractorRecords. The
+// screensaver's own cache is only ever appended to; catalogs from ra_mine
+// use the same format, but are written in one go. Like the engine, this has
+// no OpenGL dependency.
+//
+// Next to the cache is the proposal file: the same header, followed by one
+// AttractorProposalStats, so what the search has learned carries over to
+// the next run. Chaos atlases from ra_mine are a header followed by one
+// AttractorAtlas. With /equations, the cache and its proposal file live
+// next to the equations instead.
+//
+
+#define RA_CACHE_MAGIC       "RACACHE"
+#define RA_CACHE_VERSION     (1)
+#define RA_CACHE_SUFFIX      ".racache"
+#define RA_CACHE_MAX_RECORDS (4096)  // Stop appending once the file is this full
+#define RA_CACHE_PATH_LENGTH (1024)
+#define RA_PROPOSAL_MAGIC    "RAPROPS"
+#define RA_PROPOSAL_SUFFIX   ".raprops"
+#define RA_ATLAS_MAGIC       "RAATLAS"
+
+struct AttractorCacheHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+/**
+ * One accepted attractor. The candidate is everything needed to redraw it;
+ * the verdict is kept so files can be sorted and curated.
+ */
+struct AttractorRecord
+{
+    struct AttractorCandidate candidate;
+    float                     lyapunov;
+    float                     anisotropy;
+};
+
+/**
+ * A read-only memory map of a cache file.
+ */
+struct AttractorCache
+{
+    const struct AttractorRecord *records;
+    size_t                        count;
+    // Platform mapping details, for ra_cache_close
+    void  *mapping;
+    size_t mapping_size;
+    void  *mapping_handle;
+};
+
+bool ra_cache_default_path(char *path, size_t size);
+bool ra_cache_open(struct AttractorCache *cache, const char *path);
+void ra_cache_close(struct AttractorCache *cache);
+bool ra_cache_record_is_valid(const struct AttractorRecord *record);
+bool ra_cache_append(const char *path, const struct AttractorRecord *records, size_t count);
+bool ra_cache_write(const char *path, const struct AttractorRecord *records, size_t count);
+bool ra_cache_proposal_path(char *path, size_t size, const char *cache_path);
+bool ra_cache_equations_path(char *path, size_t size, const char *equations_path);
+bool ra_cache_read_proposal(const char *path, struct AttractorProposalStats *stats);
+bool ra_cache_write_proposal(const char *path, const struct AttractorProposalStats *stats);
+bool ra_cache_read_atlas(const char *path, struct AttractorAtlas *atlas);
+bool ra_cache_write_atlas(const char *path, const struct AttractorAtlas *atlas);
@@ -0,0 +1,2100 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "attractor_engine.h"
+#include "attractor_kernels.h"
+
+//
+// Everything in here mirrors mesh_cs.glsl. If you change one, change both!
+//
+// attractor_engine_simd.c builds this file a second time, with the
+// instruction set RA_ENGINE_SIMD picks (see CMakeLists.txt), but only for
+// the lane test, which ra_engine_test_lanes() hands over to on CPUs that
+// have it. Everything else is only built here, so it runs on any CPU.
+//
+
+#define RA_ENGINE_BOUNDS_LIMIT      (1e3f)
+#define RA_ENGINE_POINT_EPSILON     (1e-6f)
+#define RA_ENGINE_MAX_ANISOTROPY    (0.75f)
+#define RA_ENGINE_MIN_LYAPUNOV      (0.001f)
+#define RA_ENGINE_NEWTON_STEPS      (8)
+#define RA_ENGINE_FIXED_TOLERANCE   (1e-4f)
+#define RA_ENGINE_FIXED_CONTRACTION (0.5f)
+#define RA_ENGINE_ATLAS_EXTENT      (3.0f)
+#define RA_ENGINE_ATLAS_ATTEMPTS    (16)
+
+// Host-side only: the GPU just draws from the proposal it's given
+#define RA_ENGINE_PROPOSAL_MAX_WEIGHT  (10.0)  // Most a single accepted draw counts for
+#define RA_ENGINE_PROPOSAL_PRIOR_COUNT (16.0)  // Accepted draws the fixed Gaussian counts for
+#define RA_ENGINE_ATLAS_PRIOR_COUNT    (8.0)   // Draws pulling a cell's chance to its family's
+
+static bool ra_finite(float v)
+{
+    // Unlike isfinite(), this vectorises, and is false for both NaN and Inf
+    return fabsf(v) <= FLT_MAX;
+}
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+
+static float ra_mix(float a, float b, float t)
+{
+    return a * (1.0f - t) + b * t;
+}
+
+void ra_engine_default_params(struct AttractorSearchParams *params)
+{
+    // Must match the uniform defaults in mesh_cs.glsl
+    params->warmup_iterations         = 1000;
+    params->warmup_window             = 100;
+    params->warmup_tolerance          = 0.1f;
+    params->probe_iterations          = 200;
+    params->lyapunov_probe_iterations = 500;
+    params->probe_min_lyapunov        = 0.0f;
+    params->test_iterations           = 10000;
+    params->lyapunov_window           = 250;
+    params->lyapunov_tolerance        = 0.005f;
+    params->lyapunov_margin           = 0.01f;
+    params->family                    = RA_FAMILY_NONE;
+    params->mutation_rate             = 0.25f;
+    params->mutation_sigma            = 0.1f;
+    params->parent_count              = 0;
+    params->proposal_floor            = 0.5f;
+    params->atlas                     = NULL;
+    params->equations                 = NULL;
+
+    // The custom family is only searched once there are equations for it.
+    // Sprott's maps are only searched when asked for (/family, /weights), as
+    // about 1 candidate in 2000 passes.
+    for (int family = 0; family < RA_FAMILY_COUNT; family++)
+    {
+        params->family_weights[family] = (family == RA_FAMILY_NONE || family == RA_FAMILY_CUSTOM
+                                          || family == RA_FAMILY_SPROTT)
+            ? 0.0f
+            : 1.0f;
+        params->family_caps[family]    = 0;
+    }
+
+    // Nothing learned yet
+    struct AttractorProposalStats stats = { 0 };
+    ra_engine_fit_proposal(params, &stats);
+}
+
+//
+// Random
+//
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3"), as philox4x32() in mesh_cs.glsl.
+ */
+static void ra_engine_philox4x32(uint32_t counter[4], uint32_t key0, uint32_t key1)
+{
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t product0 = (uint64_t)0xD2511F53u * counter[0];
+        uint64_t product1 = (uint64_t)0xCD9E8D57u * counter[2];
+
+        uint32_t hi0 = (uint32_t)(product0 >> 32), lo0 = (uint32_t)product0;
+        uint32_t hi1 = (uint32_t)(product1 >> 32), lo1 = (uint32_t)product1;
+
+        counter[0] = hi1 ^ counter[1] ^ key0;
+        counter[1] = lo1;
+        counter[2] = hi0 ^ counter[3] ^ key1;
+        counter[3] = lo0;
+
+        key0 += 0x9E3779B9u;
+        key1 += 0xBB67AE85u;
+    }
+}
+
+void ra_engine_rng_init(struct AttractorRng *rng, uint32_t seed, uint32_t stream)
+{
+    rng->seed    = seed;
+    rng->stream  = stream;
+    rng->counter = 0;
+}
+
+void ra_engine_rng_skip(struct AttractorRng *rng, uint32_t count)
+{
+    rng->counter += count;
+}
+
+uint32_t ra_engine_next_uint(struct AttractorRng *rng)
+{
+    // Each block of the generator is four numbers
+    uint32_t block[4] = { rng->counter >> 2, 0, 0, 0 };
+    ra_engine_philox4x32(block, rng->seed, rng->stream);
+
+    return block[rng->counter++ & 3];
+}
+
+float ra_engine_next_float(struct AttractorRng *rng)
+{
+    // 24 bits fill a float's mantissa exactly, so this is [0, 1) everywhere
+    return (float)(ra_engine_next_uint(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Box-Muller Gaussian
+float ra_engine_next_gaussian(struct AttractorRng *rng, float mean, float sigma)
+{
+    float u1 = fmaxf(ra_engine_next_float(rng), 1e-7f);
+    float u2 = ra_engine_next_float(rng);
+
+    float r     = sqrtf(-2.0f * logf(u1));
+    float theta = 6.28318530718f * u2;
+
+    float z = r * cosf(theta);
+
+    return mean + sigma * z;
+}
+
+#endif
+
+//
+// Factories
+//
+// Each family's kernel is generated from its equations in
+// attractor_families.h into attractor_kernels.h (see tools/ra_families.c),
+// as is factory_next() in mesh_cs.glsl. Kernels take their coefficients
+// with a stride, so the same code reads both a single AttractorCandidate
+// (stride 1) and one lane of an AttractorLanes (stride RA_ENGINE_LANES).
+//
+
+//
+// Flows
+//
+// Continuous-time families are sampled every RA_ENGINE_FLOW_OUTPUT_STEP by an
+// embedded Dormand-Prince 5(4) integrator, whose steps adapt to keep each
+// one's error estimate under RA_ENGINE_FLOW_TOLERANCE: long on calm
+// stretches of the orbit, short on fast ones. A flow only supplies its
+// derivative, and the derivative's Jacobian applied to a vector for the
+// tangent, which are generated from its equations as it's marked FLOW in
+// attractor_families.h.
+//
+
+#define RA_ENGINE_FLOW_OUTPUT_STEP (0.05f)  // FLOW_OUTPUT_STEP in mesh_cs.glsl
+#define RA_ENGINE_FLOW_TOLERANCE   (1e-3f)  // FLOW_TOLERANCE in mesh_cs.glsl
+#define RA_ENGINE_FLOW_MIN_STEP    (RA_ENGINE_FLOW_OUTPUT_STEP / 64.0f)
+#define RA_ENGINE_FLOW_MAX_STEPS   (64)     // Tried steps, the last of which is forced
+
+// FACTORY_FLOW in mesh_cs.glsl
+#define RA_ENGINE_FAMILY_FLOW(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    RA_TIME_##TIME == RA_TIME_FLOW,
+static const bool ra_engine_family_flow[RA_FAMILY_COUNT]
+    = { false, RA_FAMILIES(RA_ENGINE_FAMILY_FLOW) };
+
+typedef void (*RA_FlowDerivative)(const float *coeff, int stride, const float p[3], float d[3]);
+typedef void (*RA_FlowTangent)(const float *coeff, int stride, const float p[3], const float w[3],
+    float d[3]);
+
+// Dormand-Prince tableau. The last row of A is also the 5th order weights,
+// so the last stage is the derivative at the next point, which is reused as
+// the first stage of the step after.
+static const float ra_engine_flow_a[7][6] = {
+    { 0.0f },
+    { 1.0f / 5.0f },
+    { 3.0f / 40.0f, 9.0f / 40.0f },
+    { 44.0f / 45.0f, -56.0f / 15.0f, 32.0f / 9.0f },
+    { 19372.0f / 6561.0f, -25360.0f / 2187.0f, 64448.0f / 6561.0f, -212.0f / 729.0f },
+    { 9017.0f / 3168.0f, -355.0f / 33.0f, 46732.0f / 5247.0f, 49.0f / 176.0f, -5103.0f / 18656.0f },
+    { 35.0f / 384.0f, 0.0f, 500.0f / 1113.0f, 125.0f / 192.0f, -2187.0f / 6784.0f, 11.0f / 84.0f },
+};
+// 5th order weights less the 4th order's, for the error estimate
+static const float ra_engine_flow_e[7] = {
+    71.0f / 57600.0f, 0.0f, -71.0f / 16695.0f, 71.0f / 1920.0f, -17253.0f / 339200.0f,
+    22.0f / 525.0f, -1.0f / 40.0f,
+};
+
+/**
+ * Mirrors integrate_flow() and integrate_flow_tangent(), for count orbits at
+ * once: 1, or every lane of an AttractorLanes. Orbit i starts at p[.][i],
+ * with its coefficients at coeff + i, and is integrated in place for
+ * RA_ENGINE_FLOW_OUTPUT_STEP. Unless v is NULL, the variational equation is
+ * integrated through the same steps, replacing v[.][i] with J * v[.][i].
+ * The steps only depend on the orbit, so p ends up the same either way.
+ *
+ * Each orbit has its own step size, but they're all stepped together until
+ * the last has finished, so that the loops over them still vectorise.
+ */
+static inline void ra_engine_integrate_flow(RA_FlowDerivative derivative, RA_FlowTangent tangent,
+    const float *coeff, int stride, int count, float p[3][RA_ENGINE_LANES],
+    float v[3][RA_ENGINE_LANES])
+{
+    float k[7][3][RA_ENGINE_LANES], l[7][3][RA_ENGINE_LANES];
+    float t[3][RA_ENGINE_LANES], w[3][RA_ENGINE_LANES];
+    // Step size, and time left to integrate, which the last step takes
+    // exactly to 0
+    float h[RA_ENGINE_LANES], remaining[RA_ENGINE_LANES];
+    bool  accept[RA_ENGINE_LANES];
+
+    for (int i = 0; i < count; i++)
+    {
+        float q[3] = { p[0][i], p[1][i], p[2][i] };
+        float d[3];
+        derivative(coeff + i, stride, q, d);
+        for (int c = 0; c < 3; c++) k[0][c][i] = d[c];
+
+        h[i]         = RA_ENGINE_FLOW_OUTPUT_STEP;
+        remaining[i] = RA_ENGINE_FLOW_OUTPUT_STEP;
+    }
+    for (int i = 0; i < count && v; i++)
+    {
+        float q[3] = { p[0][i], p[1][i], p[2][i] };
+        float u[3] = { v[0][i], v[1][i], v[2][i] };
+        float d[3];
+        tangent(coeff + i, stride, q, u, d);
+        for (int c = 0; c < 3; c++) l[0][c][i] = d[c];
+    }
+
+    bool running = true;
+    for (int step = 0; step < RA_ENGINE_FLOW_MAX_STEPS && running; step++)
+    {
+        // The last try takes whatever is left in one step, error or not, so
+        // that no orbit falls short of RA_ENGINE_FLOW_OUTPUT_STEP
+        bool last = step == RA_ENGINE_FLOW_MAX_STEPS - 1;
+        for (int i = 0; i < count; i++) h[i] = last ? remaining[i] : fminf(h[i], remaining[i]);
+
+        // Every loop over the orbits is innermost, so it's the one that
+        // vectorises
+        for (int stage = 1; stage < 7; stage++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                for (int i = 0; i < count; i++) t[c][i] = p[c][i];
+                for (int j = 0; j < stage; j++)
+                {
+                    float a = ra_engine_flow_a[stage][j];
+                    for (int i = 0; i < count; i++) t[c][i] += h[i] * a * k[j][c][i];
+                }
+            }
+            for (int i = 0; i < count; i++)
+            {
+                float q[3] = { t[0][i], t[1][i], t[2][i] };
+                float d[3];
+                derivative(coeff + i, stride, q, d);
+                for (int c = 0; c < 3; c++) k[stage][c][i] = d[c];
+            }
+
+            if (!v) continue;
+            for (int c = 0; c < 3; c++)
+            {
+                for (int i = 0; i < count; i++) w[c][i] = v[c][i];
+                for (int j = 0; j < stage; j++)
+                {
+                    float a = ra_engine_flow_a[stage][j];
+                    for (int i = 0; i < count; i++) w[c][i] += h[i] * a * l[j][c][i];
+                }
+            }
+            for (int i = 0; i < count; i++)
+            {
+                float q[3] = { t[0][i], t[1][i], t[2][i] };
+                float u[3] = { w[0][i], w[1][i], w[2][i] };
+                float d[3];
+                tangent(coeff + i, stride, q, u, d);
+                for (int c = 0; c < 3; c++) l[stage][c][i] = d[c];
+            }
+        }
+
+        // The largest error, relative to the orbit's scale
+        float error[RA_ENGINE_LANES] = { 0.0f };
+        for (int c = 0; c < 3; c++)
+        {
+            float e[RA_ENGINE_LANES] = { 0.0f };
+            for (int j = 0; j < 7; j++)
+            {
+                for (int i = 0; i < count; i++) e[i] += ra_engine_flow_e[j] * k[j][c][i];
+            }
+            for (int i = 0; i < count; i++)
+            {
+                float scale = RA_ENGINE_FLOW_TOLERANCE
+                    * (1.0f + fmaxf(fabsf(p[c][i]), fabsf(t[c][i])));
+                error[i]    = fmaxf(error[i], fabsf(h[i] * e[i]) / scale);
+            }
+        }
+
+        // Steps already as short as they can be are taken regardless, which
+        // bounds the work for orbits that are flying apart, and so are NaN
+        // errors, so that those orbits finish at once and fail the checks
+        for (int i = 0; i < count; i++)
+        {
+            accept[i] = remaining[i] > 0.0f
+                && (!(error[i] > 1.0f) || h[i] <= RA_ENGINE_FLOW_MIN_STEP || last);
+            remaining[i] -= accept[i] ? h[i] : 0.0f;
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                p[c][i]    = accept[i] ? t[c][i] : p[c][i];
+                k[0][c][i] = accept[i] ? k[6][c][i] : k[0][c][i];
+            }
+            for (int i = 0; i < count && v; i++)
+            {
+                v[c][i]    = accept[i] ? w[c][i] : v[c][i];
+                l[0][c][i] = accept[i] ? l[6][c][i] : l[0][c][i];
+            }
+        }
+
+        // error^-1/4 rather than the usual -1/5, as it vectorises
+        running = false;
+        for (int i = 0; i < count; i++)
+        {
+            float factor = error[i] > 0.0f
+                ? fminf(fmaxf(0.9f / sqrtf(sqrtf(error[i])), 0.2f), 5.0f)
+                : 5.0f;
+            h[i]         = fmaxf(h[i] * factor, RA_ENGINE_FLOW_MIN_STEP);
+            running      = running || remaining[i] > 0.0f;
+        }
+    }
+}
+
+/**
+ * A flow's factory for a single point, like those of the maps. The lane
+ * loops integrate every lane together instead, see ra_engine_flow_lanes().
+ */
+static inline void ra_engine_factory_flow(
+    RA_FlowDerivative derivative, RA_FlowTangent tangent, const float *coeff, int stride,
+    const float p[3], float n[3])
+{
+    float q[3][RA_ENGINE_LANES] = { { p[0] }, { p[1] }, { p[2] } };
+    ra_engine_integrate_flow(derivative, tangent, coeff, stride, 1, q, NULL);
+
+    for (int c = 0; c < 3; c++) n[c] = q[c][0];
+}
+
+// Likewise, for the tangent, which also replaces v with J * v, where J is
+// the Jacobian of the whole step at p
+static inline void ra_engine_tangent_flow(RA_FlowDerivative derivative, RA_FlowTangent tangent,
+    const float *coeff, int stride, const float p[3], float v[3], float n[3])
+{
+    float q[3][RA_ENGINE_LANES] = { { p[0] }, { p[1] }, { p[2] } };
+    float u[3][RA_ENGINE_LANES] = { { v[0] }, { v[1] }, { v[2] } };
+    ra_engine_integrate_flow(derivative, tangent, coeff, stride, 1, q, u);
+
+    for (int c = 0; c < 3; c++)
+    {
+        n[c] = q[c][0];
+        v[c] = u[c][0];
+    }
+}
+
+//
+// Custom family
+//
+// Runs the program compiled from /equations (see attractor_equations.h)
+// rather than code of its own. Without equations, these mirror the stubs
+// that stand in for factory_custom() and tangent_custom().
+//
+
+static inline void ra_engine_factory_equations(
+    const struct AttractorEquations *equations, const float *coeff, int stride, const float p[3],
+    float n[3])
+{
+    if (equations == NULL)
+    {
+        for (int c = 0; c < 3; c++) n[c] = p[c];
+        return;
+    }
+
+    ra_equations_next(equations, coeff, stride, p, n);
+}
+
+static inline void ra_engine_tangent_equations(
+    const struct AttractorEquations *equations, const float *coeff, int stride, const float p[3],
+    float v[3], float n[3])
+{
+    if (equations == NULL)
+    {
+        for (int c = 0; c < 3; c++) n[c] = p[c];
+        return;
+    }
+
+    ra_equations_tangent(equations, coeff, stride, p, v, n);
+}
+
+// For the lane loops, which only pass the coefficients on
+#define RA_ENGINE_FACTORY_EQUATIONS(coeff, stride, p, n) \
+    ra_engine_factory_equations(lanes->equations, coeff, stride, p, n)
+#define RA_ENGINE_TANGENT_EQUATIONS(coeff, stride, p, v, n) \
+    ra_engine_tangent_equations(lanes->equations, coeff, stride, p, v, n)
+
+
+/**
+ * Run one factory step for every lane. Each family has its own loop, so the
+ * family is picked outside of it and the compiler can vectorise its body.
+ */
+#define RA_ENGINE_LANE_LOOP(FACTORY)                                                  \
+    for (int l = 0; l < RA_ENGINE_LANES; l++)                                         \
+    {                                                                                 \
+        float p[3] = { x[l], y[l], z[l] };                                            \
+        float n[3];                                                                   \
+        FACTORY(&lanes->coeff[0][0][l], RA_ENGINE_LANES, p, n);                       \
+        nx[l] = n[0];                                                                 \
+        ny[l] = n[1];                                                                 \
+        nz[l] = n[2];                                                                 \
+    }
+
+/**
+ * Run one tangent step for every lane, like RA_ENGINE_LANE_LOOP, replacing
+ * each lane's tangent with J * tangent, where J is the step's Jacobian.
+ */
+#define RA_ENGINE_TANGENT_LOOP(TANGENT)                                               \
+    for (int l = 0; l < RA_ENGINE_LANES; l++)                                         \
+    {                                                                                 \
+        float p[3] = { lanes->x[l], lanes->y[l], lanes->z[l] };                       \
+        float v[3] = { lanes->tangent[0][l], lanes->tangent[1][l], lanes->tangent[2][l] }; \
+        float n[3];                                                                   \
+        TANGENT(&lanes->coeff[0][0][l], RA_ENGINE_LANES, p, v, n);                    \
+        nx[l]                = n[0];                                                  \
+        ny[l]                = n[1];                                                  \
+        nz[l]                = n[2];                                                  \
+        lanes->tangent[0][l] = v[0];                                                  \
+        lanes->tangent[1][l] = v[1];                                                  \
+        lanes->tangent[2][l] = v[2];                                                  \
+    }
+
+/**
+ * Integrate a flow for every lane together (see ra_engine_integrate_flow()),
+ * in place of RA_ENGINE_LANE_LOOP, or of RA_ENGINE_TANGENT_LOOP when given
+ * the lanes' tangents.
+ */
+static inline void ra_engine_flow_lanes(RA_FlowDerivative derivative, RA_FlowTangent tangent,
+    const struct AttractorLanes *lanes, float v[3][RA_ENGINE_LANES], const float *x, const float *y,
+    const float *z, float *nx, float *ny, float *nz)
+{
+    float p[3][RA_ENGINE_LANES];
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        p[0][l] = x[l];
+        p[1][l] = y[l];
+        p[2][l] = z[l];
+    }
+
+    ra_engine_integrate_flow(derivative, tangent, &lanes->coeff[0][0][0], RA_ENGINE_LANES,
+        RA_ENGINE_LANES, p, v);
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        nx[l] = p[0][l];
+        ny[l] = p[1][l];
+        nz[l] = p[2][l];
+    }
+}
+
+//
+// Dispatch
+//
+// Each family's factory and tangent, for a single point and for every lane,
+// wrapped from its kernel in attractor_kernels.h by how it steps: MAP
+// kernels are the step, FLOW kernels are integrated over it, and the custom
+// family's EQUATIONS are run from /equations. The tables are indexed by
+// family, and [RA_FAMILY_NONE] is the 3D quadratic map, as it's the
+// fallback for unknown families, like factory_next()'s default.
+//
+
+typedef void (*RA_EngineFactory)(const struct AttractorEquations *equations, const float *coeff,
+    int stride, const float p[3], float n[3]);
+typedef void (*RA_EngineTangent)(const struct AttractorEquations *equations, const float *coeff,
+    int stride, const float p[3], float v[3], float n[3]);
+typedef void (*RA_EngineFactoryLanes)(const struct AttractorLanes *lanes, const float *x,
+    const float *y, const float *z, float *nx, float *ny, float *nz);
+typedef void (*RA_EngineTangentLanes)(struct AttractorLanes *lanes, float *nx, float *ny,
+    float *nz);
+
+#define RA_ENGINE_STEP_MAP(name, KERNEL)                                                           \
+    static inline void ra_engine_factory_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float n[3])                              \
+    {                                                                                              \
+        (void)equations;                                                                           \
+        KERNEL(coeff, stride, p, n);                                                               \
+    }                                                                                              \
+    static inline void ra_engine_tangent_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float v[3], float n[3])                  \
+    {                                                                                              \
+        (void)equations;                                                                           \
+        KERNEL##_tangent(coeff, stride, p, v, n);                                                  \
+    }                                                                                              \
+    static void ra_engine_factory_lanes_##name(const struct AttractorLanes *lanes, const float *x, \
+        const float *y, const float *z, float *nx, float *ny, float *nz)                           \
+    {                                                                                              \
+        RA_ENGINE_LANE_LOOP(KERNEL);                                                               \
+    }                                                                                              \
+    static void ra_engine_tangent_lanes_##name(struct AttractorLanes *lanes, float *nx, float *ny, \
+        float *nz)                                                                                 \
+    {                                                                                              \
+        RA_ENGINE_TANGENT_LOOP(KERNEL##_tangent);                                                  \
+    }
+
+#define RA_ENGINE_STEP_FLOW(name, KERNEL)                                                          \
+    static inline void ra_engine_factory_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float n[3])                              \
+    {                                                                                              \
+        (void)equations;                                                                           \
+        ra_engine_factory_flow(KERNEL, KERNEL##_tangent, coeff, stride, p, n);                     \
+    }                                                                                              \
+    static inline void ra_engine_tangent_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float v[3], float n[3])                  \
+    {                                                                                              \
+        (void)equations;                                                                           \
+        ra_engine_tangent_flow(KERNEL, KERNEL##_tangent, coeff, stride, p, v, n);                  \
+    }                                                                                              \
+    static void ra_engine_factory_lanes_##name(const struct AttractorLanes *lanes, const float *x, \
+        const float *y, const float *z, float *nx, float *ny, float *nz)                           \
+    {                                                                                              \
+        ra_engine_flow_lanes(KERNEL, KERNEL##_tangent, lanes, NULL, x, y, z, nx, ny, nz);          \
+    }                                                                                              \
+    static void ra_engine_tangent_lanes_##name(struct AttractorLanes *lanes, float *nx, float *ny, \
+        float *nz)                                                                                 \
+    {                                                                                              \
+        ra_engine_flow_lanes(KERNEL, KERNEL##_tangent, lanes, lanes->tangent, lanes->x, lanes->y,  \
+            lanes->z, nx, ny, nz);                                                                 \
+    }
+
+#define RA_ENGINE_STEP_EQUATIONS(name, KERNEL)                                                     \
+    static inline void ra_engine_factory_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float n[3])                              \
+    {                                                                                              \
+        ra_engine_factory_equations(equations, coeff, stride, p, n);                               \
+    }                                                                                              \
+    static inline void ra_engine_tangent_##name(const struct AttractorEquations *equations,        \
+        const float *coeff, int stride, const float p[3], float v[3], float n[3])                  \
+    {                                                                                              \
+        ra_engine_tangent_equations(equations, coeff, stride, p, v, n);                            \
+    }                                                                                              \
+    static void ra_engine_factory_lanes_##name(const struct AttractorLanes *lanes, const float *x, \
+        const float *y, const float *z, float *nx, float *ny, float *nz)                           \
+    {                                                                                              \
+        RA_ENGINE_LANE_LOOP(RA_ENGINE_FACTORY_EQUATIONS);                                          \
+    }                                                                                              \
+    static void ra_engine_tangent_lanes_##name(struct AttractorLanes *lanes, float *nx, float *ny, \
+        float *nz)                                                                                 \
+    {                                                                                              \
+        RA_ENGINE_TANGENT_LOOP(RA_ENGINE_TANGENT_EQUATIONS);                                       \
+    }
+
+#define RA_ENGINE_STEP(name, KERNEL, TIME) RA_ENGINE_STEP_##TIME(name, KERNEL)
+RA_KERNELS(RA_ENGINE_STEP)
+
+#define RA_ENGINE_TANGENT(name, KERNEL, TIME)       ra_engine_tangent_##name,
+#define RA_ENGINE_FACTORY_LANES(name, KERNEL, TIME) ra_engine_factory_lanes_##name,
+#define RA_ENGINE_TANGENT_LANES(name, KERNEL, TIME) ra_engine_tangent_lanes_##name,
+static const RA_EngineTangent ra_engine_tangents[RA_FAMILY_COUNT]
+    = { ra_engine_tangent_3d_quadratic, RA_KERNELS(RA_ENGINE_TANGENT) };
+static const RA_EngineFactoryLanes ra_engine_factory_lanes_table[RA_FAMILY_COUNT]
+    = { ra_engine_factory_lanes_3d_quadratic, RA_KERNELS(RA_ENGINE_FACTORY_LANES) };
+static const RA_EngineTangentLanes ra_engine_tangent_lanes_table[RA_FAMILY_COUNT]
+    = { ra_engine_tangent_lanes_3d_quadratic, RA_KERNELS(RA_ENGINE_TANGENT_LANES) };
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+#define RA_ENGINE_FACTORY(name, KERNEL, TIME) ra_engine_factory_##name,
+static const RA_EngineFactory ra_engine_factories[RA_FAMILY_COUNT]
+    = { ra_engine_factory_3d_quadratic, RA_KERNELS(RA_ENGINE_FACTORY) };
+#endif
+
+/**
+ * The family, or RA_FAMILY_3D_QUADRATIC if it's unknown
+ */
+static int ra_engine_kernel_family(int family)
+{
+    return family > RA_FAMILY_NONE && family < RA_FAMILY_COUNT ? family : RA_FAMILY_3D_QUADRATIC;
+}
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+static void ra_engine_factory(
+    enum RA_Family family, const struct AttractorEquations *equations, const float *coeff,
+    int stride, const float p[3], float n[3])
+{
+    ra_engine_factories[ra_engine_kernel_family(family)](equations, coeff, stride, p, n);
+}
+#endif
+
+static void ra_engine_tangent_lanes(struct AttractorLanes *lanes, float *nx, float *ny, float *nz)
+{
+    ra_engine_tangent_lanes_table[ra_engine_kernel_family(lanes->family)](lanes, nx, ny, nz);
+}
+
+static void ra_engine_factory_lanes(const struct AttractorLanes *lanes, const float *x,
+    const float *y, const float *z, float *nx, float *ny, float *nz)
+{
+    ra_engine_factory_lanes_table[ra_engine_kernel_family(lanes->family)](lanes, x, y, z, nx, ny,
+        nz);
+}
+
+//
+// Fixed point pre-screen
+//
+
+/**
+ * The factory's Jacobian at p, column by column (j[column][row]), found by
+ * carrying each axis through the tangent step. Also returns the factory's
+ * next point.
+ */
+static void ra_engine_jacobian(
+    enum RA_Family family, const struct AttractorEquations *equations, const float *coeff,
+    int stride, const float p[3], float j[3][3], float n[3])
+{
+    for (int column = 0; column < 3; column++)
+    {
+        float v[3] = { 0.0f, 0.0f, 0.0f };
+        v[column]  = 1.0f;
+
+        ra_engine_tangents[ra_engine_kernel_family(family)](equations, coeff, stride, p, v, n);
+
+        for (int row = 0; row < 3; row++) j[column][row] = v[row];
+    }
+}
+
+static void ra_engine_cross(const float a[3], const float b[3], float c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float ra_engine_dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/**
+ * Mirrors has_attracting_fixed_point(). Newton's method from p for a fixed
+ * point of a map, then whether the Jacobian there is a contraction: if
+ * |J^16| < RA_ENGINE_FIXED_CONTRACTION, every Eigenvalue is well inside the
+ * unit circle.
+ *
+ * @param steps Factory steps spent, added to
+ */
+static bool ra_engine_has_attracting_fixed_point(
+    enum RA_Family family, const struct AttractorEquations *equations, const float *coeff,
+    int stride, const float p[3], int *steps)
+{
+    // For a flow, a fixed point of one step is a fixed point of the flow,
+    // whose Eigenvalues say nothing about the map's
+    if (ra_engine_family_flow[family]) return false;
+
+    float x[3] = { p[0], p[1], p[2] };
+    float j[3][3], n[3];
+
+    for (int i = 0; i < RA_ENGINE_NEWTON_STEPS; i++)
+    {
+        ra_engine_jacobian(family, equations, coeff, stride, x, j, n);
+        *steps += 1;
+
+        // Solve (J - I) d = x - F(x) by Cramer's rule
+        float a[3][3];
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+                a[column][row] = j[column][row] - (column == row ? 1.0f : 0.0f);
+        }
+        float r[3] = { x[0] - n[0], x[1] - n[1], x[2] - n[2] };
+
+        float c12[3], c20[3], c01[3];
+        ra_engine_cross(a[1], a[2], c12);
+        ra_engine_cross(a[2], a[0], c20);
+        ra_engine_cross(a[0], a[1], c01);
+        float det = ra_engine_dot(a[0], c12);
+        if (!(fabsf(det) > 1e-12f)) return false;
+
+        x[0] += ra_engine_dot(c12, r) / det;
+        x[1] += ra_engine_dot(c20, r) / det;
+        x[2] += ra_engine_dot(c01, r) / det;
+        if (!(ra_finite(x[0]) && ra_finite(x[1]) && ra_finite(x[2]))) return false;
+    }
+
+    ra_engine_jacobian(family, equations, coeff, stride, x, j, n);
+    *steps += 1;
+
+    // Out of reach of the bounds checks, or not a fixed point after all
+    for (int c = 0; c < 3; c++)
+    {
+        if (!(fabsf(x[c]) <= RA_ENGINE_BOUNDS_LIMIT)) return false;
+        if (!(fabsf(n[c] - x[c]) <= RA_ENGINE_FIXED_TOLERANCE * (1.0f + fabsf(x[c])))) return false;
+    }
+
+    // J^16, by squaring
+    for (int i = 0; i < 4; i++)
+    {
+        float squared[3][3];
+        for (int column = 0; column < 3; column++)
+        {
+            for (int row = 0; row < 3; row++)
+            {
+                squared[column][row] = j[0][row] * j[column][0] + j[1][row] * j[column][1]
+                    + j[2][row] * j[column][2];
+            }
+        }
+        memcpy(j, squared, sizeof(squared));
+    }
+
+    float norm = 0.0f;
+    for (int column = 0; column < 3; column++) norm += ra_engine_dot(j[column], j[column]);
+    return sqrtf(norm) < RA_ENGINE_FIXED_CONTRACTION;
+}
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+
+//
+// Seeding
+//
+
+enum RA_Family ra_engine_bind_family(struct AttractorRng *rng,
+    const struct AttractorSearchParams *params)
+{
+    // Mirrors bind_attractor_factory()
+    float f = ra_engine_next_float(rng);
+    if (RA_FAMILY_NONE < params->family && params->family < RA_FAMILY_COUNT)
+        return (enum RA_Family)params->family;
+
+    float total = 0.0f;
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        total += fmaxf(params->family_weights[family], 0.0f);
+    }
+
+    // Rounding can leave a little of f * total over, which goes to the last
+    // enabled family rather than a disabled one
+    enum RA_Family picked    = RA_FAMILY_NONE;
+    float          remaining = f * total;
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        if (params->family_weights[family] <= 0.0f) continue;
+
+        picked = (enum RA_Family)family;
+        remaining -= params->family_weights[family];
+        if (remaining < 0.0f) break;
+    }
+
+    return (picked == RA_FAMILY_NONE) ? RA_FAMILY_3D_QUADRATIC : picked;
+}
+
+static void ra_engine_seed_previous(struct AttractorCandidate *candidate, const float lo[3],
+    const float hi[3], struct AttractorRng *rng)
+{
+    for (int i = 0; i < RA_ENGINE_PREVIOUS_LENGTH; i++)
+    {
+        candidate->previous[i][0] = ra_mix(lo[0], hi[0], ra_engine_next_float(rng));
+        candidate->previous[i][1] = ra_mix(lo[1], hi[1], ra_engine_next_float(rng));
+        candidate->previous[i][2] = ra_mix(lo[2], hi[2], ra_engine_next_float(rng));
+        candidate->previous[i][3] = 1.0f;
+    }
+}
+
+// The shape of each family, from attractor_families.h
+#define RA_ENGINE_FAMILY_COEFFICIENTS(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    COEFFICIENTS,
+#define RA_ENGINE_FAMILY_COMPONENTS(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    COMPONENTS,
+#define RA_ENGINE_FAMILY_SPREAD(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    (float)(SPREAD),
+#define RA_ENGINE_FAMILY_PROPOSAL(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    RA_DRAW_##DRAW * (COEFFICIENTS),
+static const int   ra_engine_family_coefficients[RA_FAMILY_COUNT]
+    = { 0, RA_FAMILIES(RA_ENGINE_FAMILY_COEFFICIENTS) };
+static const int   ra_engine_family_components[RA_FAMILY_COUNT]
+    = { 0, RA_FAMILIES(RA_ENGINE_FAMILY_COMPONENTS) };
+static const float ra_engine_family_spread[RA_FAMILY_COUNT]
+    = { 0.0f, RA_FAMILIES(RA_ENGINE_FAMILY_SPREAD) };
+// Coefficients each family draws from the proposal, which is none for
+// uniform families
+static const int   ra_engine_proposal_count[RA_FAMILY_COUNT]
+    = { 0, RA_FAMILIES(RA_ENGINE_FAMILY_PROPOSAL) };
+
+/**
+ * Where the family's coefficients start in the proposal (FACTORY_PROPOSAL_OFFSET)
+ */
+static int ra_engine_proposal_offset(int family)
+{
+    int offset = 0;
+    for (int before = RA_FAMILY_NONE + 1; before < family; before++)
+        offset += ra_engine_proposal_count[before];
+    return offset;
+}
+
+/**
+ * Where the family's coefficient pairs start in AttractorAtlasCounts
+ */
+static int ra_engine_atlas_pair_offset(int family)
+{
+    int offset = 0;
+    for (int before = RA_FAMILY_NONE + 1; before < family; before++)
+    {
+        int scalars = 3 * ra_engine_proposal_count[before];
+        offset += scalars * (scalars - 1) / 2;
+    }
+    return offset;
+}
+
+/**
+ * Mirrors atlas_cell()
+ */
+static int ra_engine_atlas_cell(enum RA_Family family, float x)
+{
+    float u    = x / (RA_ENGINE_ATLAS_EXTENT * ra_engine_family_spread[family]) * 0.5f + 0.5f;
+    int   cell = (int)floorf(u * (float)RA_ENGINE_ATLAS_SIZE);
+    return cell < 0 ? 0 : (cell >= RA_ENGINE_ATLAS_SIZE ? RA_ENGINE_ATLAS_SIZE - 1 : cell);
+}
+
+/**
+ * Mirrors next_atlas_pair(): redraw the atlas axes of a fresh draw until
+ * the atlas accepts them, or RA_ENGINE_ATLAS_ATTEMPTS have been tried
+ */
+static void ra_engine_atlas_redraw(
+    struct AttractorCandidate *candidate, enum RA_Family family,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng)
+{
+    const struct AttractorAtlas *atlas = params->atlas;
+
+    int    k[2], c[2];
+    float *pair[2];
+    for (int axis = 0; axis < 2; axis++)
+    {
+        k[axis]    = ra_engine_proposal_offset(family) + atlas->axes[family][axis] / 3;
+        c[axis]    = atlas->axes[family][axis] % 3;
+        pair[axis] = &candidate->coeff[atlas->axes[family][axis] / 3][c[axis]];
+    }
+
+    for (int attempt = 1; attempt < RA_ENGINE_ATLAS_ATTEMPTS; attempt++)
+    {
+        int   u      = ra_engine_atlas_cell(family, *pair[0]);
+        int   v      = ra_engine_atlas_cell(family, *pair[1]);
+        float chance = (float)atlas->cells[family][v][u] / 255.0f;
+        if (ra_engine_next_float(rng) < chance) break;
+
+        for (int axis = 0; axis < 2; axis++)
+        {
+            *pair[axis] = ra_engine_next_gaussian(rng, params->proposal_mean[k[axis]][c[axis]],
+                params->proposal_sigma[k[axis]][c[axis]]);
+        }
+    }
+}
+
+/**
+ * Mirrors next_coefficient() for every coefficient of the family
+ */
+static void ra_engine_seed_gaussian_coeff(
+    struct AttractorCandidate *candidate, enum RA_Family family,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng)
+{
+    for (int i = 0; i < ra_engine_proposal_count[family]; i++)
+    {
+        const float *mean  = params->proposal_mean[ra_engine_proposal_offset(family) + i];
+        const float *sigma = params->proposal_sigma[ra_engine_proposal_offset(family) + i];
+
+        candidate->coeff[i][0] = ra_engine_next_gaussian(rng, mean[0], sigma[0]);
+        candidate->coeff[i][1] = ra_engine_next_gaussian(rng, mean[1], sigma[1]);
+        candidate->coeff[i][2] = ra_engine_next_gaussian(rng, mean[2], sigma[2]);
+        candidate->coeff[i][3] = 0.0f;
+    }
+
+    if (params->atlas) ra_engine_atlas_redraw(candidate, family, params, rng);
+}
+
+// RA_UNIFORM_DRAWS and RA_STARTS, from attractor_families.h
+struct AttractorUniformDraw
+{
+    int   family, first, last;
+    float low, high;
+    int   steps;
+};
+
+struct AttractorStart
+{
+    int   family;
+    float low[3], high[3];
+};
+
+#define RA_ENGINE_UNIFORM_DRAW(NAME, FIRST, LAST, LOW, HIGH, STEPS) \
+    { RA_FAMILY_##NAME, FIRST, LAST, (float)(LOW), (float)(HIGH), STEPS },
+#define RA_ENGINE_START(NAME, LOW_X, LOW_Y, LOW_Z, HIGH_X, HIGH_Y, HIGH_Z) \
+    { RA_FAMILY_##NAME, { LOW_X, LOW_Y, LOW_Z }, { HIGH_X, HIGH_Y, HIGH_Z } },
+static const struct AttractorUniformDraw ra_engine_uniform_draws[]
+    = { RA_UNIFORM_DRAWS(RA_ENGINE_UNIFORM_DRAW) };
+static const struct AttractorStart ra_engine_starts[] = { RA_STARTS(RA_ENGINE_START) };
+
+/**
+ * Mirrors next_uniform_coefficients() for every coefficient of the family
+ */
+static void ra_engine_seed_uniform_coeff(
+    struct AttractorCandidate *candidate, enum RA_Family family, struct AttractorRng *rng)
+{
+    int count = (int)(sizeof(ra_engine_uniform_draws) / sizeof(ra_engine_uniform_draws[0]));
+    for (int i = 0; i < ra_engine_family_coefficients[family]; i++)
+    {
+        // attractor_families.h is checked to cover every coefficient when
+        // the project is configured
+        const struct AttractorUniformDraw *draw = &ra_engine_uniform_draws[0];
+        for (int row = 0; row < count; row++)
+        {
+            draw = &ra_engine_uniform_draws[row];
+            if (draw->family == (int)family && draw->first <= i && i <= draw->last) break;
+        }
+
+        for (int c = 0; c < ra_engine_family_components[family]; c++)
+        {
+            float u = ra_engine_next_float(rng);
+            if (draw->steps > 1)
+            {
+                int step = (int)(u * (float)draw->steps);
+                u = (float)(step < draw->steps - 1 ? step : draw->steps - 1)
+                  / (float)(draw->steps - 1);
+            }
+            candidate->coeff[i][c] = ra_mix(draw->low, draw->high, u);
+        }
+    }
+}
+
+/**
+ * Mirrors seed_attractor_factory()
+ */
+void ra_engine_seed_candidate(
+    struct AttractorCandidate *candidate, enum RA_Family family,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng)
+{
+    static const float unit_lo[3] = { -0.5f, -0.5f, -0.5f };
+    static const float unit_hi[3] = { +0.5f, +0.5f, +0.5f };
+
+    memset(candidate, 0, sizeof(*candidate));
+
+    // seed_attractor_factory() draws (and ignores) one float first
+    ra_engine_next_float(rng);
+
+    family            = (enum RA_Family)ra_engine_kernel_family(family);
+    candidate->family = family;
+
+    if (ra_engine_proposal_count[family] > 0)
+        ra_engine_seed_gaussian_coeff(candidate, family, params, rng);
+    else
+        ra_engine_seed_uniform_coeff(candidate, family, rng);
+
+    const float *lo = unit_lo, *hi = unit_hi;
+    for (size_t i = 0; i < sizeof(ra_engine_starts) / sizeof(ra_engine_starts[0]); i++)
+    {
+        if (ra_engine_starts[i].family != (int)family) continue;
+        lo = ra_engine_starts[i].low;
+        hi = ra_engine_starts[i].high;
+    }
+    ra_engine_seed_previous(candidate, lo, hi, rng);
+}
+
+/**
+ * Mirrors mutate_attractor_factory(): maybe replace a freshly seeded
+ * candidate's coefficients with a parent's, nudged a little. Its starting
+ * points are kept.
+ *
+ * @returns the parent, or -1 if the candidate is still a fresh draw
+ */
+int ra_engine_mutate_candidate(struct AttractorCandidate *candidate,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng)
+{
+    if (params->parent_count <= 0 || params->mutation_rate <= 0.0f) return -1;
+
+    // Both are drawn either way, so what follows doesn't depend on the parents
+    float    f    = ra_engine_next_float(rng);
+    uint32_t pick = ra_engine_next_uint(rng);
+
+    int family = candidate->family;
+    int count  = 0;
+    for (int i = 0; i < params->parent_count; i++) count += params->parent_family[i] == family;
+    if (count == 0 || f >= params->mutation_rate) return -1;
+
+    int parent = -1;
+    int k      = (int)(pick % (uint32_t)count);
+    for (int i = 0; i < params->parent_count && parent < 0; i++)
+    {
+        if (params->parent_family[i] == family && k-- == 0) parent = i;
+    }
+
+    float sigma = params->mutation_sigma * ra_engine_family_spread[family];
+    for (int i = 0; i < ra_engine_family_coefficients[family]; i++)
+    {
+        for (int c = 0; c < ra_engine_family_components[family]; c++)
+        {
+            candidate->coeff[i][c] = params->parent_coeff[parent][i][c]
+                + ra_engine_next_gaussian(rng, 0.0f, sigma);
+        }
+    }
+
+    return parent;
+}
+
+/**
+ * Make an attractor the newest parent, dropping the oldest if there's no
+ * room left.
+ */
+void ra_engine_add_parent(struct AttractorSearchParams *params,
+    const struct AttractorCandidate *parent)
+{
+    int count = params->parent_count < RA_ENGINE_PARENT_MAX
+        ? params->parent_count + 1
+        : RA_ENGINE_PARENT_MAX;
+
+    memmove(&params->parent_family[1], &params->parent_family[0],
+        (size_t)(count - 1) * sizeof(params->parent_family[0]));
+    memmove(&params->parent_coeff[1], &params->parent_coeff[0],
+        (size_t)(count - 1) * sizeof(params->parent_coeff[0]));
+
+    params->parent_family[0] = parent->family;
+    memcpy(params->parent_coeff[0], parent->coeff, sizeof(params->parent_coeff[0]));
+    params->parent_count = count;
+}
+
+/**
+ * Seed the candidate mesh_cs.glsl would test for the given key, like
+ * seed_candidate() there. The GPU's transcendentals are less accurate, so
+ * expect the coefficients to agree to a few ULPs rather than exactly.
+ */
+void ra_engine_seed_key(struct AttractorCandidate *candidate,
+    const struct AttractorSearchParams *params, uint32_t seed, uint32_t key)
+{
+    struct AttractorRng rng;
+    ra_engine_rng_init(&rng, seed, key + 1);
+
+    enum RA_Family family = ra_engine_bind_family(&rng, params);
+    ra_engine_seed_candidate(candidate, family, params, &rng);
+    ra_engine_mutate_candidate(candidate, params, &rng);
+}
+
+/**
+ * Add a fresh draw which passed the suitability test to the statistics the
+ * proposal is fitted to. params must hold the proposal it was drawn from.
+ */
+void ra_engine_learn_proposal(
+    struct AttractorProposalStats *stats, const struct AttractorSearchParams *params,
+    const struct AttractorCandidate *accepted)
+{
+    int family = accepted->family;
+    if (family <= RA_FAMILY_NONE || RA_FAMILY_COUNT <= family
+        || ra_engine_proposal_count[family] == 0)
+        return;
+
+    stats->accepted[family]++;
+
+    double prior = ra_engine_family_spread[family];
+    for (int i = 0; i < ra_engine_proposal_count[family]; i++)
+    {
+        int k = ra_engine_proposal_offset(family) + i;
+        for (int c = 0; c < 3; c++)
+        {
+            // Importance weight of the fixed Gaussian against the proposal
+            double x      = accepted->coeff[i][c];
+            double mean   = params->proposal_mean[k][c];
+            double sigma  = params->proposal_sigma[k][c];
+            double z      = (x - mean) / sigma;
+            double weight = (sigma / prior) * exp(0.5 * z * z - 0.5 * (x / prior) * (x / prior));
+            weight        = fmin(weight, RA_ENGINE_PROPOSAL_MAX_WEIGHT);
+
+            // West's weighted mean and variance
+            stats->weight[k][c] += weight;
+            double delta = x - stats->mean[k][c];
+            stats->mean[k][c] += delta * weight / stats->weight[k][c];
+            stats->m2[k][c] += weight * delta * (x - stats->mean[k][c]);
+        }
+    }
+}
+
+/**
+ * Fit the proposal to what has passed so far. Until a family has passed
+ * RA_ENGINE_PROPOSAL_PRIOR_COUNT times, its fit leans towards the fixed
+ * Gaussian, and it never gets narrower than proposal_floor of it, so there
+ * is always some exploration.
+ */
+void ra_engine_fit_proposal(struct AttractorSearchParams *params,
+    const struct AttractorProposalStats *stats)
+{
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        double prior    = ra_engine_family_spread[family];
+        double accepted = (params->proposal_floor < 1.0f) ? (double)stats->accepted[family] : 0.0;
+        double share    = accepted / (accepted + RA_ENGINE_PROPOSAL_PRIOR_COUNT);
+
+        for (int i = 0; i < ra_engine_proposal_count[family]; i++)
+        {
+            int k = ra_engine_proposal_offset(family) + i;
+            for (int c = 0; c < 3; c++)
+            {
+                double variance = stats->weight[k][c] > 0.0
+                    ? stats->m2[k][c] / stats->weight[k][c]
+                    : 0.0;
+                double mean     = share * stats->mean[k][c];
+                double sigma    = sqrt(share * variance + (1.0 - share) * prior * prior);
+
+                params->proposal_mean[k][c]  = (float)mean;
+                params->proposal_sigma[k][c] = (float)fmax(sigma, params->proposal_floor * prior);
+            }
+            params->proposal_mean[k][3]  = 0.0f;
+            params->proposal_sigma[k][3] = 0.0f;
+        }
+    }
+}
+
+void ra_engine_step_candidate(struct AttractorCandidate *candidate,
+    const struct AttractorEquations *equations)
+{
+    float n[3];
+    ra_engine_factory(candidate->family, equations, &candidate->coeff[0][0], 1,
+        candidate->previous[0], n);
+
+    // Shift the previous points back by one, and add the new point to the front
+    memmove(&candidate->previous[1], &candidate->previous[0],
+        sizeof(candidate->previous[0]) * (RA_ENGINE_PREVIOUS_LENGTH - 1));
+    candidate->previous[0][0] = n[0];
+    candidate->previous[0][1] = n[1];
+    candidate->previous[0][2] = n[2];
+    candidate->previous[0][3] = 1.0f;
+}
+
+#endif
+
+//
+// Lane groups
+//
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+
+/**
+ * @param rngs Each candidate's stream, which its tangent's direction is
+ *             drawn from
+ */
+void ra_engine_pack_lanes(struct AttractorLanes *lanes, const struct AttractorCandidate *candidates,
+    struct AttractorRng *rngs)
+{
+    lanes->family = candidates[0].family;
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        const struct AttractorCandidate *c = &candidates[l];
+
+        for (int k = 0; k < RA_ENGINE_COEFF_LENGTH; k++)
+        {
+            for (int i = 0; i < 4; i++) lanes->coeff[k][i][l] = c->coeff[k][i];
+        }
+
+        lanes->x[l]  = c->previous[0][0];
+        lanes->y[l]  = c->previous[0][1];
+        lanes->z[l]  = c->previous[0][2];
+        lanes->px[l] = c->previous[1][0];
+        lanes->py[l] = c->previous[1][1];
+        lanes->pz[l] = c->previous[1][2];
+
+        // Random 3D direction (W is drawn but ignored), normalised
+        float d[4];
+        for (int i = 0; i < 4; i++) d[i] = ra_mix(-1.0f, +1.0f, ra_engine_next_float(&rngs[l]));
+        float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        for (int i = 0; i < 3; i++) lanes->tangent[i][l] = d[i] / length;
+    }
+}
+
+void ra_engine_unpack_lane(const struct AttractorLanes *lanes, int lane,
+    struct AttractorCandidate *candidate)
+{
+    memset(candidate, 0, sizeof(*candidate));
+    candidate->family = lanes->family;
+
+    for (int k = 0; k < RA_ENGINE_COEFF_LENGTH; k++)
+    {
+        for (int i = 0; i < 4; i++) candidate->coeff[k][i] = lanes->coeff[k][i][lane];
+    }
+
+    // Only the two most recent points are tracked, and only PREVIOUS[0] ever
+    // feeds the factories, so the older history is just a copy of PREVIOUS[1]
+    for (int i = 0; i < RA_ENGINE_PREVIOUS_LENGTH; i++)
+    {
+        candidate->previous[i][0] = (i == 0) ? lanes->x[lane] : lanes->px[lane];
+        candidate->previous[i][1] = (i == 0) ? lanes->y[lane] : lanes->py[lane];
+        candidate->previous[i][2] = (i == 0) ? lanes->z[lane] : lanes->pz[lane];
+        candidate->previous[i][3] = 1.0f;
+    }
+}
+
+#endif
+
+/**
+ * Advance every lane by one step.
+ */
+static void ra_engine_advance_lanes(struct AttractorLanes *lanes)
+{
+    float nx[RA_ENGINE_LANES], ny[RA_ENGINE_LANES], nz[RA_ENGINE_LANES];
+    ra_engine_factory_lanes(lanes, lanes->x, lanes->y, lanes->z, nx, ny, nz);
+    lanes->steps++;
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        lanes->px[l] = lanes->x[l];
+        lanes->py[l] = lanes->y[l];
+        lanes->pz[l] = lanes->z[l];
+        lanes->x[l]  = nx[l];
+        lanes->y[l]  = ny[l];
+        lanes->z[l]  = nz[l];
+    }
+}
+
+/**
+ * Mirrors renormalised_step(). Advance every lane by one step, along with
+ * its tangent, and renormalise the tangent. Lanes whose tangent broke are
+ * killed.
+ *
+ * @param stretch Log of how far each tangent was stretched
+ */
+static void ra_engine_renormalised_advance_lanes(struct AttractorLanes *lanes, bool *alive,
+    float *stretch)
+{
+    float nx[RA_ENGINE_LANES], ny[RA_ENGINE_LANES], nz[RA_ENGINE_LANES];
+    ra_engine_tangent_lanes(lanes, nx, ny, nz);
+    lanes->steps++;
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        lanes->px[l] = lanes->x[l];
+        lanes->py[l] = lanes->y[l];
+        lanes->pz[l] = lanes->z[l];
+        lanes->x[l]  = nx[l];
+        lanes->y[l]  = ny[l];
+        lanes->z[l]  = nz[l];
+
+        float vx = lanes->tangent[0][l];
+        float vy = lanes->tangent[1][l];
+        float vz = lanes->tangent[2][l];
+        float vv = sqrtf(vx * vx + vy * vy + vz * vz);
+
+        // A tangent which broke, or collapsed to nothing, has no direction left
+        alive[l] = alive[l] && ra_finite(vv) && vv > 0.0f;
+
+        lanes->tangent[0][l] = vx / vv;
+        lanes->tangent[1][l] = vy / vv;
+        lanes->tangent[2][l] = vz / vv;
+        stretch[l]           = logf(vv);
+    }
+}
+
+/**
+ * Mirrors newest_point_is_sane(), killing any lane which fails.
+ *
+ * @returns true if any lane is still alive
+ */
+static bool ra_engine_check_lanes(const struct AttractorLanes *lanes, bool *alive)
+{
+    bool any_alive = false;
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        float x = lanes->x[l];
+        float y = lanes->y[l];
+        float z = lanes->z[l];
+
+        bool ok = alive[l];
+
+        // Check for irrationalities
+        ok = ok && ra_finite(x) && ra_finite(y) && ra_finite(z);
+
+        // If the bounds explode, also unsuitable
+        ok = ok && !(x < -RA_ENGINE_BOUNDS_LIMIT || RA_ENGINE_BOUNDS_LIMIT < x);
+        ok = ok && !(y < -RA_ENGINE_BOUNDS_LIMIT || RA_ENGINE_BOUNDS_LIMIT < y);
+        ok = ok && !(z < -RA_ENGINE_BOUNDS_LIMIT || RA_ENGINE_BOUNDS_LIMIT < z);
+
+        // If this tends to a point, also unsuitable
+        ok = ok
+          && !(fabsf(x - lanes->px[l]) < RA_ENGINE_POINT_EPSILON
+              && fabsf(y - lanes->py[l]) < RA_ENGINE_POINT_EPSILON
+              && fabsf(z - lanes->pz[l]) < RA_ENGINE_POINT_EPSILON);
+
+        alive[l] = ok;
+        any_alive |= ok;
+    }
+
+    return any_alive;
+}
+
+/**
+ * Brent's cycle detection, mirroring TEST_CYCLE_* in mesh_cs.glsl. Every
+ * lane steps together, so they share the schedule, and only the point each
+ * one is compared against is their own.
+ */
+struct AttractorCycles
+{
+    float x[RA_ENGINE_LANES], y[RA_ENGINE_LANES], z[RA_ENGINE_LANES];
+    int   power;
+    int   length;
+};
+
+static void ra_engine_begin_cycles(const struct AttractorLanes *lanes,
+    struct AttractorCycles *cycles)
+{
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        cycles->x[l] = lanes->x[l];
+        cycles->y[l] = lanes->y[l];
+        cycles->z[l] = lanes->z[l];
+    }
+    cycles->power  = 1;
+    cycles->length = 0;
+}
+
+/**
+ * Mirrors orbit_is_periodic(), killing any lane which has come back to
+ * where it was.
+ *
+ * @param running Lanes still being tested, or NULL for all of them. The
+ *                others have already finished on the GPU.
+ * @returns true if any lane is still alive
+ */
+static bool ra_engine_check_cycles(
+    const struct AttractorLanes *lanes, struct AttractorCycles *cycles, const bool *running,
+    bool *alive)
+{
+    bool any_alive = false;
+    bool restart   = ++cycles->length == cycles->power;
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        bool periodic = fabsf(lanes->x[l] - cycles->x[l]) < RA_ENGINE_POINT_EPSILON
+                     && fabsf(lanes->y[l] - cycles->y[l]) < RA_ENGINE_POINT_EPSILON
+                     && fabsf(lanes->z[l] - cycles->z[l]) < RA_ENGINE_POINT_EPSILON;
+
+        alive[l] = alive[l] && !(periodic && (running == NULL || running[l]));
+        any_alive |= alive[l];
+
+        if (restart)
+        {
+            cycles->x[l] = lanes->x[l];
+            cycles->y[l] = lanes->y[l];
+            cycles->z[l] = lanes->z[l];
+        }
+    }
+
+    if (restart)
+    {
+        cycles->power *= 2;
+        cycles->length = 0;
+    }
+
+    return any_alive;
+}
+
+/**
+ * Mirrors stage 0's warm-up, ending each lane's once warmup_has_settled()
+ * would. A lane which has settled stops moving, so it's left exactly where
+ * the GPU would leave it, and the group carries on until every lane has
+ * settled or the budget runs out.
+ */
+static void ra_engine_warm_up_lanes(
+    struct AttractorLanes *lanes, const struct AttractorSearchParams *params, const bool *alive)
+{
+    float minimum[3][RA_ENGINE_LANES], maximum[3][RA_ENGINE_LANES];
+    float settle_minimum[3][RA_ENGINE_LANES], settle_maximum[3][RA_ENGINE_LANES];
+    bool  settled[RA_ENGINE_LANES];
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        // Lanes the pre-screen rejected are never warmed up on the GPU
+        settled[l] = !alive[l];
+        for (int a = 0; a < 3; a++)
+        {
+            minimum[a][l]        = 1e10f;
+            maximum[a][l]        = -1e10f;
+            settle_minimum[a][l] = 1e10f;
+            settle_maximum[a][l] = -1e10f;
+        }
+    }
+
+    for (int i = 1; i <= params->warmup_iterations; i++)
+    {
+        float nx[RA_ENGINE_LANES], ny[RA_ENGINE_LANES], nz[RA_ENGINE_LANES];
+        ra_engine_factory_lanes(lanes, lanes->x, lanes->y, lanes->z, nx, ny, nz);
+        lanes->steps++;
+
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            if (settled[l]) continue;
+
+            lanes->px[l] = lanes->x[l];
+            lanes->py[l] = lanes->y[l];
+            lanes->pz[l] = lanes->z[l];
+            lanes->x[l]  = nx[l];
+            lanes->y[l]  = ny[l];
+            lanes->z[l]  = nz[l];
+
+            lanes->verdict[l].warmup = i;
+        }
+        if (params->warmup_window <= 0) continue;
+
+        bool sane[RA_ENGINE_LANES];
+        for (int l = 0; l < RA_ENGINE_LANES; l++) sane[l] = true;
+        ra_engine_check_lanes(lanes, sane);
+
+        bool window      = i % params->warmup_window == 0;
+        bool any_running = false;
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            if (settled[l]) continue;
+
+            // Mirrors warmup_has_settled()
+            if (!sane[l])
+            {
+                settled[l] = true;
+                continue;
+            }
+            if (ra_engine_family_flow[lanes->family])
+            {
+                any_running = true;
+                continue;
+            }
+
+            float p[3] = { lanes->x[l], lanes->y[l], lanes->z[l] };
+            for (int a = 0; a < 3; a++)
+            {
+                minimum[a][l] = fminf(minimum[a][l], p[a]);
+                maximum[a][l] = fmaxf(maximum[a][l], p[a]);
+            }
+
+            if (window)
+            {
+                float drift  = 0.0f;
+                float extent = 0.0f;
+                for (int a = 0; a < 3; a++)
+                {
+                    drift  = fmaxf(drift, fabsf(minimum[a][l] - settle_minimum[a][l]));
+                    drift  = fmaxf(drift, fabsf(maximum[a][l] - settle_maximum[a][l]));
+                    extent = fmaxf(extent,
+                        fmaxf(maximum[a][l], settle_maximum[a][l])
+                        - fminf(minimum[a][l], settle_minimum[a][l]));
+
+                    settle_minimum[a][l] = minimum[a][l];
+                    settle_maximum[a][l] = maximum[a][l];
+                    minimum[a][l]        = 1e10f;
+                    maximum[a][l]        = -1e10f;
+                }
+                settled[l] = drift <= params->warmup_tolerance * extent;
+            }
+
+            any_running |= !settled[l];
+        }
+
+        if (!any_running) break;
+    }
+}
+
+/**
+ * Mirrors seeded_attractor_is_suitable() for every lane at once, stage by
+ * stage. A lane which fails keeps computing (it's free in SIMD) but can never
+ * pass again, and the whole group stops as soon as every lane has failed.
+ */
+#if defined(RA_ENGINE_SIMD_BUILD)
+void ra_engine_test_lanes_simd(struct AttractorLanes *lanes,
+    const struct AttractorSearchParams *params)
+#else
+static void ra_engine_test_lanes_baseline(struct AttractorLanes *lanes,
+    const struct AttractorSearchParams *params)
+#endif
+{
+    float stretch[RA_ENGINE_LANES];
+    bool  alive[RA_ENGINE_LANES];
+
+    struct AttractorCycles cycles;
+
+    lanes->equations = params->equations;
+    lanes->steps     = 0;
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        alive[l] = true;
+
+        lanes->verdict[l].suitable   = false;
+        lanes->verdict[l].lyapunov   = 0.0f;
+        lanes->verdict[l].anisotropy = 1.0f;
+        lanes->verdict[l].iterations = 0;
+        lanes->verdict[l].warmup     = 0;
+    }
+
+    //
+    // Stage 0: pre-screen for attracting fixed points, then warm-up until
+    // the orbit settles
+    //
+    bool screened = false;
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        float p[3]  = { lanes->x[l], lanes->y[l], lanes->z[l] };
+        int   steps = 0;
+        alive[l]    = !ra_engine_has_attracting_fixed_point(
+            lanes->family, lanes->equations, &lanes->coeff[0][0][l], RA_ENGINE_LANES, p, &steps);
+        screened |= alive[l];
+
+        // The lanes screen side by side, so the slowest is what they all cost
+        if (steps > lanes->steps) lanes->steps = steps;
+    }
+    if (!screened) return;
+
+    ra_engine_warm_up_lanes(lanes, params, alive);
+
+    //
+    // Stage 1: divergence probe, which also starts looking for cycles
+    //
+    ra_engine_begin_cycles(lanes, &cycles);
+    for (int i = 0; i < params->probe_iterations; i++)
+    {
+        ra_engine_advance_lanes(lanes);
+        if (!ra_engine_check_lanes(lanes, alive)) return;
+        if (!ra_engine_check_cycles(lanes, &cycles, NULL, alive)) return;
+    }
+
+    //
+    // Stage 2: Lyapunov probe
+    //
+    if (params->lyapunov_probe_iterations > 0)
+    {
+        float probe[RA_ENGINE_LANES] = { 0 };
+
+        for (int i = 0; i < params->lyapunov_probe_iterations; i++)
+        {
+            ra_engine_renormalised_advance_lanes(lanes, alive, stretch);
+            if (!ra_engine_check_lanes(lanes, alive)) return;
+            if (!ra_engine_check_cycles(lanes, &cycles, NULL, alive)) return;
+
+            for (int l = 0; l < RA_ENGINE_LANES; l++) probe[l] += stretch[l];
+        }
+
+        bool any_alive = false;
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            probe[l] /= (float)params->lyapunov_probe_iterations;
+            alive[l] = alive[l] && probe[l] >= params->probe_min_lyapunov;
+            any_alive |= alive[l];
+        }
+        if (!any_alive) return;
+    }
+
+    //
+    // Stage 3: full test, until every lane's estimate has converged
+    //
+    float lyapunov[RA_ENGINE_LANES];
+    float window_lyapunov[RA_ENGINE_LANES];
+    int   samples[RA_ENGINE_LANES];
+    bool  running[RA_ENGINE_LANES];
+    float cov[3][3][RA_ENGINE_LANES];
+    float mean[3][RA_ENGINE_LANES];
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        lyapunov[l]        = 0.0f;
+        window_lyapunov[l] = 0.0f;
+        samples[l]         = 0;
+        running[l]         = true;
+        for (int a = 0; a < 3; a++)
+        {
+            mean[a][l] = 0.0f;
+            for (int b = 0; b < 3; b++) cov[a][b][l] = 0.0f;
+        }
+    }
+
+    for (int i = 0; i < params->test_iterations; i++)
+    {
+        ra_engine_renormalised_advance_lanes(lanes, alive, stretch);
+        if (!ra_engine_check_lanes(lanes, alive)) return;
+        if (!ra_engine_check_cycles(lanes, &cycles, running, alive)) return;
+
+        bool any_running = false;
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            // Lanes which have converged (or died) stop accumulating
+            float weight = (alive[l] && running[l]) ? 1.0f : 0.0f;
+            samples[l] += (int)weight;
+            float n = (float)(samples[l] > 0 ? samples[l] : 1);
+
+            // Accumulate data for eigenvalue estimation
+            float p[3] = { lanes->x[l], lanes->y[l], lanes->z[l] };
+            float d_mean[3];
+            for (int a = 0; a < 3; a++)
+            {
+                d_mean[a] = weight * (p[a] - mean[a][l]);
+                mean[a][l] += d_mean[a] / n;
+            }
+            for (int a = 0; a < 3; a++)
+            {
+                for (int b = 0; b < 3; b++) cov[a][b][l] += d_mean[a] * (p[b] - mean[b][l]);
+            }
+
+            // Sum of the stretches, which becomes the mean at the end
+            lyapunov[l] += weight * stretch[l];
+
+            // Mirrors lyapunov_has_converged()
+            if (weight > 0.0f && params->lyapunov_window > 0
+                && samples[l] % params->lyapunov_window == 0)
+            {
+                float estimate  = lyapunov[l] / n;
+                bool  converged = samples[l] >= 2 * params->lyapunov_window
+                              && fabsf(estimate - window_lyapunov[l]) < params->lyapunov_tolerance;
+                bool  decisive  = fabsf(estimate - RA_ENGINE_MIN_LYAPUNOV)
+                    > params->lyapunov_margin;
+
+                running[l]         = !(converged && decisive);
+                window_lyapunov[l] = estimate;
+            }
+
+            any_running |= alive[l] && running[l];
+        }
+
+        if (!any_running) break;
+    }
+
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        struct AttractorVerdict *verdict = &lanes->verdict[l];
+        verdict->lyapunov                = lyapunov[l] / (float)(samples[l] > 0 ? samples[l] : 1);
+        verdict->iterations              = samples[l];
+
+        if (!alive[l]) continue;
+
+        //
+        // Normalise the covariance and power iterate for the dominant
+        // Eigenvalue, exactly like the GLSL (cov[column][row])
+        //
+        float c[3][3];
+        for (int a = 0; a < 3; a++)
+        {
+            for (int b = 0; b < 3; b++) c[a][b] = cov[a][b][l] / (float)samples[l];
+        }
+
+        float v[3] = { 1.0f, 0.7f, 0.3f };
+        for (int i = 0; i < 9; i++)
+        {
+            // The first pass just normalises the starting vector
+            float w[3] = { v[0], v[1], v[2] };
+            if (i > 0)
+            {
+                for (int r = 0; r < 3; r++) w[r] = c[0][r] * v[0] + c[1][r] * v[1] + c[2][r] * v[2];
+            }
+            float length = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+            for (int r = 0; r < 3; r++) v[r] = w[r] / length;
+        }
+
+        float cv[3];
+        for (int r = 0; r < 3; r++) cv[r] = c[0][r] * v[0] + c[1][r] * v[1] + c[2][r] * v[2];
+        float lambda1   = v[0] * cv[0] + v[1] * cv[1] + v[2] * cv[2];
+        float trace_cov = c[0][0] + c[1][1] + c[2][2];
+
+        verdict->anisotropy = lambda1 / (trace_cov + 1e-6f);
+        verdict->suitable   = verdict->anisotropy <= RA_ENGINE_MAX_ANISOTROPY
+            && verdict->lyapunov >= RA_ENGINE_MIN_LYAPUNOV;
+    }
+}
+
+#if !defined(RA_ENGINE_SIMD_BUILD)
+
+#if defined(RA_ENGINE_SIMD_AVX512) || defined(RA_ENGINE_SIMD_AVX2)
+void ra_engine_test_lanes_simd(struct AttractorLanes *lanes,
+    const struct AttractorSearchParams *params);
+
+/**
+ * Whether this CPU, and the OS, can run ra_engine_test_lanes_simd()
+ */
+static bool ra_engine_simd_supported(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma     = info[2] & (1 << 12);
+    bool osxsave = info[2] & (1 << 27);
+    if (!fma || !osxsave) return false;
+
+    // The OS has to save the vector registers too, not just the CPU have them
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+#if defined(RA_ENGINE_SIMD_AVX512)
+    return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16));
+#else
+    return (xcr0 & 0x06) == 0x06 && (info[1] & (1 << 5));
+#endif
+#elif defined(RA_ENGINE_SIMD_AVX512)
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+/**
+ * The instruction set ra_engine_test_lanes() runs with on this CPU
+ */
+const char *ra_engine_simd(void)
+{
+#if defined(RA_ENGINE_SIMD_AVX512)
+    if (ra_engine_simd_supported()) return "AVX-512";
+#elif defined(RA_ENGINE_SIMD_AVX2)
+    if (ra_engine_simd_supported()) return "AVX2";
+#endif
+    return "baseline";
+}
+
+void ra_engine_test_lanes(struct AttractorLanes *lanes, const struct AttractorSearchParams *params)
+{
+#if defined(RA_ENGINE_SIMD_AVX512) || defined(RA_ENGINE_SIMD_AVX2)
+    if (ra_engine_simd_supported())
+    {
+        ra_engine_test_lanes_simd(lanes, params);
+        return;
+    }
+#endif
+    ra_engine_test_lanes_baseline(lanes, params);
+}
+
+//
+// Search and generation
+//
+
+/**
+ * Add a tested fresh draw to every slice of its family in the atlas counts
+ */
+static void ra_engine_count_atlas(struct AttractorAtlasCounts *counts,
+    const struct AttractorCandidate *candidate, bool suitable)
+{
+    enum RA_Family family  = (enum RA_Family)candidate->family;
+    int            scalars = 3 * ra_engine_proposal_count[family];
+
+    int cell[3 * RA_ENGINE_COEFF_LENGTH];
+    for (int a = 0; a < scalars; a++)
+        cell[a] = ra_engine_atlas_cell(family, candidate->coeff[a / 3][a % 3]);
+
+    int pair = ra_engine_atlas_pair_offset(family);
+    for (int a = 0; a < scalars; a++)
+    {
+        for (int b = a + 1; b < scalars; b++, pair++)
+        {
+            counts->tested[pair][cell[b]][cell[a]]++;
+            counts->suitable[pair][cell[b]][cell[a]] += suitable;
+        }
+    }
+}
+
+/**
+ * Seed and test one lane group of candidates, all of the same family. Lane
+ * l is the candidate mesh_cs.glsl would test for key first_key + l, except
+ * that every lane takes the family lane 0 picks.
+ *
+ * @param stats Totals to add this group to. If given, they also count
+ *              towards params->family_caps, and a group whose family is
+ *              already at its cap isn't tested at all.
+ * @param counts Atlas counts to add the group's fresh draws to, or NULL
+ * @returns How many were suitable, which are moved to the front of found
+ *          and verdicts.
+ */
+int ra_engine_test_group(const struct AttractorSearchParams *params, uint32_t seed,
+    uint32_t first_key, struct AttractorCandidate found[RA_ENGINE_LANES],
+    struct AttractorVerdict verdicts[RA_ENGINE_LANES], struct AttractorFamilyStats *stats,
+    struct AttractorAtlasCounts *counts)
+{
+    struct AttractorCandidate candidates[RA_ENGINE_LANES];
+    struct AttractorRng       rngs[RA_ENGINE_LANES];
+    struct AttractorLanes     lanes;
+
+    // Streams start at 1, as seed_candidate() does
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+        ra_engine_rng_init(&rngs[l], seed, first_key + (uint32_t)l + 1);
+
+    // Every lane in a group shares a family, so the factories never diverge.
+    // The others still step past the draw that would have picked their own.
+    enum RA_Family family = ra_engine_bind_family(&rngs[0], params);
+    for (int l = 1; l < RA_ENGINE_LANES; l++) ra_engine_rng_skip(&rngs[l], 1);
+
+    int cap = params->family_caps[family];
+    if (stats && cap > 0 && stats->tested[family] >= (uint64_t)cap) return 0;
+
+    // Mutations keep their family, so the lanes still share one
+    int parents[RA_ENGINE_LANES];
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        ra_engine_seed_candidate(&candidates[l], family, params, &rngs[l]);
+        parents[l] = ra_engine_mutate_candidate(&candidates[l], params, &rngs[l]);
+    }
+
+    ra_engine_pack_lanes(&lanes, candidates, rngs);
+    ra_engine_test_lanes(&lanes, params);
+    for (int l = 0; l < RA_ENGINE_LANES; l++) lanes.verdict[l].parent = parents[l];
+
+    int suitable = 0;
+    for (int l = 0; l < RA_ENGINE_LANES; l++)
+    {
+        if (!lanes.verdict[l].suitable) continue;
+
+        ra_engine_unpack_lane(&lanes, l, &found[suitable]);
+        verdicts[suitable] = lanes.verdict[l];
+        suitable++;
+    }
+
+    if (stats)
+    {
+        stats->tested[family] += RA_ENGINE_LANES;
+        stats->suitable[family] += (uint64_t)suitable;
+        stats->steps[family] += (uint64_t)lanes.steps * RA_ENGINE_LANES;
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+            stats->warmup[family] += (uint64_t)lanes.verdict[l].warmup;
+    }
+
+    for (int l = 0; counts && l < RA_ENGINE_LANES; l++)
+    {
+        if (parents[l] < 0)
+            ra_engine_count_atlas(counts, &candidates[l], lanes.verdict[l].suitable);
+    }
+
+    return suitable;
+}
+
+/**
+ * Test lane groups until one has a suitable candidate, or max_groups have
+ * been tested. params->family_caps apply to this search alone.
+ *
+ * @param next_key The first candidate key to test, which is moved past the
+ *                 keys this search used
+ * @param cancel   Checked between lane groups, so another thread can end the
+ *                 search early by setting it, or NULL
+ * @param stats    Totals to add this search to, or NULL
+ */
+bool ra_engine_search(const struct AttractorSearchParams *params, uint32_t seed, uint32_t *next_key,
+    int max_groups, const atomic_bool *cancel, struct AttractorCandidate *found,
+    struct AttractorVerdict *verdict, struct AttractorFamilyStats *stats)
+{
+    struct AttractorCandidate   survivors[RA_ENGINE_LANES];
+    struct AttractorVerdict     verdicts[RA_ENGINE_LANES];
+    struct AttractorFamilyStats search_stats = { 0 };
+
+    bool success = false;
+    for (int group = 0; group < max_groups && !success; group++)
+    {
+        if (cancel && atomic_load(cancel)) break;
+
+        uint32_t first_key = *next_key;
+        *next_key += RA_ENGINE_LANES;
+
+        if (ra_engine_test_group(params, seed, first_key, survivors, verdicts, &search_stats,
+            NULL) > 0)
+        {
+            *found   = survivors[0];
+            *verdict = verdicts[0];
+            success  = true;
+        }
+    }
+
+    if (stats) ra_engine_add_stats(stats, &search_stats);
+    return success;
+}
+
+void ra_engine_add_stats(struct AttractorFamilyStats *total,
+    const struct AttractorFamilyStats *stats)
+{
+    for (int family = 0; family < RA_FAMILY_COUNT; family++)
+    {
+        total->tested[family] += stats->tested[family];
+        total->suitable[family] += stats->suitable[family];
+        total->steps[family] += stats->steps[family];
+        total->warmup[family] += stats->warmup[family];
+    }
+}
+
+void ra_engine_add_atlas_counts(struct AttractorAtlasCounts *total,
+    const struct AttractorAtlasCounts *counts)
+{
+    for (int pair = 0; pair < RA_ENGINE_ATLAS_PAIRS; pair++)
+    {
+        for (int v = 0; v < RA_ENGINE_ATLAS_SIZE; v++)
+        {
+            for (int u = 0; u < RA_ENGINE_ATLAS_SIZE; u++)
+            {
+                total->tested[pair][v][u] += counts->tested[pair][v][u];
+                total->suitable[pair][v][u] += counts->suitable[pair][v][u];
+            }
+        }
+    }
+}
+
+/**
+ * Make an atlas of each family's most telling slice: the one where drawing
+ * in proportion to each cell's chance would pass the most draws. A cell's
+ * chance leans towards the family's overall chance until it has been
+ * tested a few times, and no cell is ever ruled out completely.
+ */
+void ra_engine_fit_atlas(struct AttractorAtlas *atlas, const struct AttractorAtlasCounts *counts)
+{
+    for (int family = 0; family < RA_FAMILY_COUNT; family++)
+    {
+        atlas->axes[family][0] = 0;
+        atlas->axes[family][1] = 1;
+        memset(atlas->cells[family], 255, sizeof(atlas->cells[family]));
+    }
+
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        int scalars = 3 * ra_engine_proposal_count[family];
+        int first   = ra_engine_atlas_pair_offset(family);
+        if (scalars < 2) continue;
+
+        // Every slice of a family saw the same draws
+        double tested   = 0.0;
+        double suitable = 0.0;
+        for (int v = 0; v < RA_ENGINE_ATLAS_SIZE; v++)
+        {
+            for (int u = 0; u < RA_ENGINE_ATLAS_SIZE; u++)
+            {
+                tested += counts->tested[first][v][u];
+                suitable += counts->suitable[first][v][u];
+            }
+        }
+        if (suitable <= 0.0) continue;
+
+        double rate      = suitable / tested;
+        double best_gain = 0.0;
+        int    best_pair = first;
+        int    pair      = first;
+        for (int a = 0; a < scalars; a++)
+        {
+            for (int b = a + 1; b < scalars; b++, pair++)
+            {
+                double passed = 0.0;
+                double drawn  = 0.0;
+                for (int v = 0; v < RA_ENGINE_ATLAS_SIZE; v++)
+                {
+                    for (int u = 0; u < RA_ENGINE_ATLAS_SIZE; u++)
+                    {
+                        double t      = counts->tested[pair][v][u];
+                        double s      = counts->suitable[pair][v][u];
+                        double chance = (s + RA_ENGINE_ATLAS_PRIOR_COUNT * rate)
+                            / (t + RA_ENGINE_ATLAS_PRIOR_COUNT);
+                        passed += s * chance;
+                        drawn += t * chance;
+                    }
+                }
+
+                double gain = passed / drawn / rate;
+                if (gain > best_gain)
+                {
+                    best_gain              = gain;
+                    best_pair              = pair;
+                    atlas->axes[family][0] = a;
+                    atlas->axes[family][1] = b;
+                }
+            }
+        }
+
+        double chances[RA_ENGINE_ATLAS_SIZE][RA_ENGINE_ATLAS_SIZE];
+        double most = 0.0;
+        for (int v = 0; v < RA_ENGINE_ATLAS_SIZE; v++)
+        {
+            for (int u = 0; u < RA_ENGINE_ATLAS_SIZE; u++)
+            {
+                double t      = counts->tested[best_pair][v][u];
+                double s      = counts->suitable[best_pair][v][u];
+                chances[v][u] = (s + RA_ENGINE_ATLAS_PRIOR_COUNT * rate)
+                    / (t + RA_ENGINE_ATLAS_PRIOR_COUNT);
+                most          = fmax(most, chances[v][u]);
+            }
+        }
+        for (int v = 0; v < RA_ENGINE_ATLAS_SIZE; v++)
+        {
+            for (int u = 0; u < RA_ENGINE_ATLAS_SIZE; u++)
+            {
+                atlas->cells[family][v][u] = (uint8_t)fmax(1.0,
+                    round(255.0 * chances[v][u] / most));
+            }
+        }
+    }
+}
+
+/**
+ * Guard against atlases from a damaged file, whose axes could be outside
+ * their family's coefficients.
+ */
+bool ra_engine_atlas_is_valid(const struct AttractorAtlas *atlas)
+{
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        int scalars = 3 * ra_engine_proposal_count[family];
+        if (scalars == 0) continue;
+
+        int u = atlas->axes[family][0];
+        int v = atlas->axes[family][1];
+        if (u < 0 || scalars <= u || v < 0 || scalars <= v || u == v) return false;
+    }
+
+    return true;
+}
+
+static void ra_engine_set_control(
+    float *controls, float bounds[2][4], int bezier, int ctrl, const float position[4],
+    float path_fraction)
+{
+    float *cp = &controls[(bezier * 4 + ctrl) * 8];
+
+    for (int i = 0; i < 4; i++)
+    {
+        cp[i]           = position[i];
+        bounds[0][i]    = fminf(bounds[0][i], position[i]);
+        bounds[1][i]    = fmaxf(bounds[1][i], position[i]);
+    }
+    cp[4] = path_fraction;
+    cp[5] = 0.0f;
+    cp[6] = 0.0f;
+    cp[7] = 0.0f;
+}
+
+/**
+ * Mirrors generate_controls() in mesh_cs.glsl for a known candidate, writing
+ * 8 floats per control point (struct ControlPoint), carrying on from the
+ * candidate's PREVIOUS.
+ *
+ * @param equations For a candidate of the custom family, see
+ *                  AttractorSearchParams
+ */
+void ra_engine_generate_controls(
+    const struct AttractorCandidate *candidate, const struct AttractorEquations *equations,
+    int path_count, int bezier_per_path, float *controls, float bounds[2][4])
+{
+    const int controls_per_bezier      = 4;
+    const int total_beziers            = path_count * bezier_per_path;
+    const int controls_per_path        = controls_per_bezier * bezier_per_path;
+    const int unique_controls_per_path = controls_per_path - bezier_per_path + 1;
+
+    struct AttractorCandidate c = *candidate;
+
+    for (int i = 0; i < 4; i++)
+    {
+        bounds[0][i] = 1e10f;
+        bounds[1][i] = -1e10f;
+    }
+
+    int unique_controls = 0;
+
+    for (int bez = 0; bez < total_beziers; bez++)
+    {
+        for (int ctrl = 0; ctrl < controls_per_bezier; ctrl++)
+        {
+            float position[4];
+
+            if (bez > 0 && ctrl == 0)
+            {
+                // Shared with the previous Bezier, so not unique
+                memcpy(position, &controls[((bez - 1) * 4 + 3) * 8], sizeof(position));
+            }
+            else if (bez > 0 && ctrl == 1)
+            {
+                const float *from = &controls[((bez - 1) * 4 + 2) * 8];
+                const float *to   = &controls[((bez - 1) * 4 + 3) * 8];
+                for (int i = 0; i < 4; i++) position[i] = to[i] + (to[i] - from[i]);
+                unique_controls++;
+            }
+            else
+            {
+                ra_engine_step_candidate(&c, equations);
+                memcpy(position, c.previous[0], sizeof(position));
+                unique_controls++;
+            }
+
+            float path_fraction = (float)(unique_controls - 1)
+                / (float)(unique_controls_per_path - 1);
+            ra_engine_set_control(controls, bounds, bez, ctrl, position, path_fraction);
+        }
+    }
+}
+
+#endif
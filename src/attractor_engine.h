@@ -0,0 +1,271 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "attractor_equations.h"
+#include "attractor_families.h"
+
+//
+// A CPU reimplementation of the attractor factories and suitability test in
+// mesh_cs.glsl. It has no OpenGL dependency, so it can run on worker threads
+// and on headless build machines.
+//
+// Candidates are tested in lane groups (structure-of-arrays), which the
+// compiler turns into AVX-512 (16 lanes) or AVX2 (8 lanes) code depending on
+// RA_ENGINE_SIMD in CMakeLists.txt. Without either, a lane group is a single
+// scalar candidate. CPUs without the instruction set still run the lane test,
+// just not vectorised as widely, see ra_engine_simd().
+//
+// RA_ENGINE_LANES sizes AttractorLanes, so CMakeLists.txt sets it for every
+// target rather than each file working it out from its own flags.
+//
+
+#if !defined(RA_ENGINE_LANES)
+#error "RA_ENGINE_LANES isn't defined, see RA_ENGINE_SIMD in CMakeLists.txt"
+#endif
+
+#define RA_ENGINE_PREVIOUS_LENGTH (10)  // PREVIOUS_LENGTH in mesh_cs.glsl
+#define RA_ENGINE_COEFF_LENGTH    (10)  // COEFF_LENGTH in mesh_cs.glsl
+#define RA_ENGINE_PARENT_MAX      (16)  // Most parents a search mutates, see AttractorSearchParams
+#define RA_ENGINE_ATLAS_SIZE      (32)  // ATLAS_SIZE in mesh_cs.glsl
+
+// PROPOSAL_LENGTH in mesh_cs.glsl: every coefficient of the Gaussian families
+#define RA_ENGINE_PROPOSAL_COEFFICIENTS(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    +(RA_DRAW_##DRAW * (COEFFICIENTS))
+#define RA_ENGINE_PROPOSAL_LENGTH (0 RA_FAMILIES(RA_ENGINE_PROPOSAL_COEFFICIENTS))
+
+// Pairs of scalar coefficients of the Gaussian families, any of which an
+// atlas could slice through
+#define RA_ENGINE_ATLAS_FAMILY_PAIRS(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    +(RA_DRAW_##DRAW * 3 * (COEFFICIENTS) * (3 * (COEFFICIENTS) - 1) / 2)
+#define RA_ENGINE_ATLAS_PAIRS (0 RA_FAMILIES(RA_ENGINE_ATLAS_FAMILY_PAIRS))
+
+/**
+ * Matches ATTRACTOR_FACTORY in mesh_cs.glsl, see attractor_families.h
+ */
+#define RA_ENGINE_FAMILY_ENUM(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) RA_FAMILY_##NAME,
+enum RA_Family
+{
+    RA_FAMILY_NONE = 0,
+    RA_FAMILIES(RA_ENGINE_FAMILY_ENUM)
+    RA_FAMILY_COUNT
+};
+
+// Families /weights and /caps take, which are all but RA_FAMILY_CUSTOM, as it
+// comes with /equations
+#define RA_FAMILY_BUILT_IN (RA_FAMILY_COUNT - 2)
+
+/**
+ * A single attractor, laid out like the candidate in the SearchResult buffer
+ * so it can be uploaded as-is.
+ */
+struct AttractorCandidate
+{
+    int32_t family;
+    float   coeff[RA_ENGINE_COEFF_LENGTH][4];
+    float   previous[RA_ENGINE_PREVIOUS_LENGTH][4];
+};
+
+/**
+ * What the suitability test thought of a candidate.
+ */
+struct AttractorVerdict
+{
+    bool  suitable;
+    float lyapunov;
+    float anisotropy;
+    // Stage 3 iterations before the Lyapunov estimate converged
+    int   iterations;
+    // Stage 0 iterations before the orbit settled
+    int   warmup;
+    // The parent it was mutated from, or -1 for a fresh draw
+    int   parent;
+};
+
+/**
+ * The chaos atlas: a 2D slice through each family's coefficient space, and
+ * how likely a fresh draw in each cell of it is to pass the suitability
+ * test, relative to the likeliest cell (255). ra_mine maps it, and fresh
+ * draws are then redrawn until the atlas accepts them, see next_atlas_pair()
+ * in mesh_cs.glsl.
+ *
+ * The slices span 3 fresh-draw sigmas either side of 0 (ATLAS_EXTENT).
+ * Indexed by family, so [RA_FAMILY_NONE] and uniform families are unused.
+ */
+struct AttractorAtlas
+{
+    // The coefficients along u and v, each as k * 3 + component
+    int32_t axes[RA_FAMILY_COUNT][2];
+    uint8_t cells[RA_FAMILY_COUNT][RA_ENGINE_ATLAS_SIZE][RA_ENGINE_ATLAS_SIZE];  // [v][u]
+};
+
+/**
+ * Fresh draws tested, and passed, in each cell of every 2D slice an atlas
+ * could use, for ra_engine_fit_atlas() to pick the most telling slice from.
+ */
+struct AttractorAtlasCounts
+{
+    uint32_t tested[RA_ENGINE_ATLAS_PAIRS][RA_ENGINE_ATLAS_SIZE][RA_ENGINE_ATLAS_SIZE];
+    uint32_t suitable[RA_ENGINE_ATLAS_PAIRS][RA_ENGINE_ATLAS_SIZE][RA_ENGINE_ATLAS_SIZE];
+};
+
+/**
+ * How candidates are picked and tested. The same values are passed to
+ * mesh_cs.glsl as uniforms, where the stages of the test are described.
+ */
+struct AttractorSearchParams
+{
+    // Iteration budgets for each stage of the suitability test
+    int   warmup_iterations;
+    int   probe_iterations;
+    int   lyapunov_probe_iterations;
+    float probe_min_lyapunov;
+    int   test_iterations;
+    // When stage 0 can stop early (see warmup_has_settled())
+    int   warmup_window;
+    float warmup_tolerance;
+    // When stage 3 can stop early (see lyapunov_has_converged())
+    int   lyapunov_window;
+    float lyapunov_tolerance;
+    float lyapunov_margin;
+    // FORCE_ATTRACTOR_FACTORY: RA_FAMILY_NONE picks a family by weight
+    int   family;
+    // FACTORY_WEIGHTS: relative chance of picking each family, 0 disables it
+    float family_weights[RA_FAMILY_COUNT];
+    // FACTORY_CAPS: most candidates of each family per search, 0 is no cap
+    int   family_caps[RA_FAMILY_COUNT];
+    // MUTATION_RATE: chance a candidate is a mutation of a parent of its
+    // family (if there is one) rather than a fresh draw, see
+    // mutate_attractor_factory()
+    float mutation_rate;
+    // MUTATION_SIGMA: how far a mutation moves each coefficient, relative to
+    // the spread of fresh draws
+    float mutation_sigma;
+    // The MutationParents buffer: recently found attractors, newest first
+    int   parent_count;
+    int   parent_family[RA_ENGINE_PARENT_MAX];
+    float parent_coeff[RA_ENGINE_PARENT_MAX][RA_ENGINE_COEFF_LENGTH][4];
+    // PROPOSAL_MEAN and PROPOSAL_SIGMA: the Gaussian each coefficient of the
+    // polynomial and trig maps is drawn from, see ra_engine_fit_proposal()
+    float proposal_mean[RA_ENGINE_PROPOSAL_LENGTH][4];
+    float proposal_sigma[RA_ENGINE_PROPOSAL_LENGTH][4];
+    // Least proposal sigma, relative to the fixed Gaussian it started as.
+    // 1 never learns at all.
+    float proposal_floor;
+    // ATLAS_LOADED and chaos_atlas, or NULL to draw without one
+    const struct AttractorAtlas *atlas;
+    // The custom family's equations (/equations), which are spliced into
+    // mesh_cs.glsl, or NULL, in which case it's never bound
+    const struct AttractorEquations *equations;
+};
+
+/**
+ * Statistics of every coefficient that has passed the suitability test, to
+ * fit the proposal to. Each is weighted by how much likelier the fixed
+ * Gaussian was to draw it than the proposal which did, so they describe
+ * what passes out of fresh draws, and don't just narrow down on whatever
+ * the proposal already favours.
+ */
+struct AttractorProposalStats
+{
+    uint64_t accepted[RA_FAMILY_COUNT];
+    double   weight[RA_ENGINE_PROPOSAL_LENGTH][3];
+    double   mean[RA_ENGINE_PROPOSAL_LENGTH][3];
+    double   m2[RA_ENGINE_PROPOSAL_LENGTH][3];
+};
+
+/**
+ * Running totals for each family, like the FactoryStats buffer in
+ * mesh_cs.glsl. Indexed by family, so [RA_FAMILY_NONE] is unused.
+ */
+struct AttractorFamilyStats
+{
+    uint64_t tested[RA_FAMILY_COUNT];
+    uint64_t suitable[RA_FAMILY_COUNT];
+    // Factory steps spent testing, which is what a candidate costs
+    uint64_t steps[RA_FAMILY_COUNT];
+    // Stage 0 iterations, of which warmup_iterations is the most per candidate
+    uint64_t warmup[RA_FAMILY_COUNT];
+};
+
+/**
+ * A position in a Philox4x32-10 stream, like RNG_KEY and RNG_COUNTER in
+ * mesh_cs.glsl. A number depends only on (seed, stream, counter), so the
+ * CPU and GPU draw the same ones for the same candidate key.
+ */
+struct AttractorRng
+{
+    uint32_t seed;
+    uint32_t stream;
+    uint32_t counter;
+};
+
+/**
+ * RA_ENGINE_LANES candidates of the same family, structure-of-arrays.
+ */
+struct AttractorLanes
+{
+    int32_t family;
+    // From AttractorSearchParams, for the custom family
+    const struct AttractorEquations *equations;
+    float   coeff[RA_ENGINE_COEFF_LENGTH][4][RA_ENGINE_LANES];
+    // PREVIOUS[0] and PREVIOUS[1], which are all the factories ever look at
+    float   x[RA_ENGINE_LANES], y[RA_ENGINE_LANES], z[RA_ENGINE_LANES];
+    float   px[RA_ENGINE_LANES], py[RA_ENGINE_LANES], pz[RA_ENGINE_LANES];
+    // Unit tangent vector (TANGENT in mesh_cs.glsl)
+    float   tangent[3][RA_ENGINE_LANES];
+    struct AttractorVerdict verdict[RA_ENGINE_LANES];
+    // Factory steps the last test took, which every lane paid for
+    int     steps;
+};
+
+void     ra_engine_default_params(struct AttractorSearchParams *params);
+void     ra_engine_rng_init(struct AttractorRng *rng, uint32_t seed, uint32_t stream);
+void     ra_engine_rng_skip(struct AttractorRng *rng, uint32_t count);
+uint32_t ra_engine_next_uint(struct AttractorRng *rng);
+float    ra_engine_next_float(struct AttractorRng *rng);
+float    ra_engine_next_gaussian(struct AttractorRng *rng, float mean, float sigma);
+
+enum RA_Family ra_engine_bind_family(struct AttractorRng *rng,
+    const struct AttractorSearchParams *params);
+void           ra_engine_seed_candidate(struct AttractorCandidate *candidate, enum RA_Family family,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng);
+int            ra_engine_mutate_candidate(struct AttractorCandidate *candidate,
+    const struct AttractorSearchParams *params, struct AttractorRng *rng);
+void           ra_engine_add_parent(struct AttractorSearchParams *params,
+    const struct AttractorCandidate *parent);
+void           ra_engine_learn_proposal(struct AttractorProposalStats *stats,
+    const struct AttractorSearchParams *params, const struct AttractorCandidate *accepted);
+void           ra_engine_fit_proposal(struct AttractorSearchParams *params,
+    const struct AttractorProposalStats *stats);
+void           ra_engine_seed_key(struct AttractorCandidate *candidate,
+    const struct AttractorSearchParams *params, uint32_t seed, uint32_t key);
+void           ra_engine_step_candidate(struct AttractorCandidate *candidate,
+    const struct AttractorEquations *equations);
+
+void ra_engine_pack_lanes(struct AttractorLanes *lanes, const struct AttractorCandidate *candidates,
+    struct AttractorRng *rngs);
+void ra_engine_unpack_lane(const struct AttractorLanes *lanes, int lane,
+    struct AttractorCandidate *candidate);
+void ra_engine_test_lanes(struct AttractorLanes *lanes, const struct AttractorSearchParams *params);
+
+const char *ra_engine_simd(void);
+
+int  ra_engine_test_group(const struct AttractorSearchParams *params, uint32_t seed,
+    uint32_t first_key, struct AttractorCandidate found[RA_ENGINE_LANES],
+    struct AttractorVerdict verdicts[RA_ENGINE_LANES], struct AttractorFamilyStats *stats,
+    struct AttractorAtlasCounts *counts);
+bool ra_engine_search(const struct AttractorSearchParams *params, uint32_t seed, uint32_t *next_key,
+    int max_groups, const atomic_bool *cancel, struct AttractorCandidate *found,
+    struct AttractorVerdict *verdict, struct AttractorFamilyStats *stats);
+void ra_engine_add_stats(struct AttractorFamilyStats *total,
+    const struct AttractorFamilyStats *stats);
+void ra_engine_add_atlas_counts(struct AttractorAtlasCounts *total,
+    const struct AttractorAtlasCounts *counts);
+void ra_engine_fit_atlas(struct AttractorAtlas *atlas, const struct AttractorAtlasCounts *counts);
+bool ra_engine_atlas_is_valid(const struct AttractorAtlas *atlas);
+void ra_engine_generate_controls(
+    const struct AttractorCandidate *candidate, const struct AttractorEquations *equations,
+    int path_count, int bezier_per_path, float *controls, float bounds[2][4]);
@@ -0,0 +1,10 @@
+//
+// The lane test again, built with the instruction set RA_ENGINE_SIMD picks
+// (see CMakeLists.txt). attractor_engine.c only calls into it on CPUs that
+// have it, so nothing else may be built here.
+//
+
+#if defined(RA_ENGINE_SIMD_AVX512) || defined(RA_ENGINE_SIMD_AVX2)
+#define RA_ENGINE_SIMD_BUILD
+#include "attractor_engine.c"
+#endif
@@ -0,0 +1,1313 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attractor_equations.h"
+
+#define RA_EQUATIONS_MAX_CONSTANTS (64)
+#define RA_EQUATIONS_NAME_LENGTH   (32)
+#define RA_EQUATIONS_MAX_SOURCE    (64 * 1024)  // Largest file ra_equations_load() reads
+#define RA_EQUATIONS_MAX_POWER     (8)          // Integer exponents up to this are multiplied out
+#define RA_EQUATIONS_PI            (3.14159265358979323846)
+
+static const char ra_equations_variables[3] = { 'x', 'y', 'z' };
+
+static const struct
+{
+    const char *name;
+    int32_t     op;
+} ra_equations_functions[] = {
+    { "sin", RA_EQUATION_SIN },   { "cos", RA_EQUATION_COS },   { "tan", RA_EQUATION_TAN },
+    { "tanh", RA_EQUATION_TANH }, { "exp", RA_EQUATION_EXP },   { "log", RA_EQUATION_LOG },
+    { "sqrt", RA_EQUATION_SQRT }, { "abs", RA_EQUATION_ABS },
+};
+
+/**
+ * Everything the parser needs besides the equations it's building
+ */
+struct AttractorEquationParser
+{
+    struct AttractorEquations *equations;
+    // The rest of the line being parsed
+    const char *c;
+    const char *end;
+    int         line;
+    // Factors being parsed, one inside the other
+    int depth;
+    // Parsing a constant, which can't depend on x, y, z or a coefficient
+    bool constant_only;
+    int     constant_count;
+    char    constant_names[RA_EQUATIONS_MAX_CONSTANTS][RA_EQUATIONS_NAME_LENGTH];
+    int32_t constant_nodes[RA_EQUATIONS_MAX_CONSTANTS];
+    // Only the first error is kept, as the rest tend to follow from it
+    char  *error;
+    size_t error_size;
+    bool   failed;
+};
+
+/**
+ * Record an error, if it's the first.
+ *
+ * @returns -1, which every node builder passes on
+ */
+static int32_t ra_equations_fail(struct AttractorEquationParser *parser, const char *format, ...)
+{
+    if (parser->failed) return -1;
+    parser->failed = true;
+
+    int length = 0;
+    if (parser->line > 0)
+        length = snprintf(parser->error, parser->error_size, "Line %d: ", parser->line);
+    if (length < 0 || (size_t)length >= parser->error_size) return -1;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(parser->error + length, parser->error_size - (size_t)length, format, args);
+    va_end(args);
+    return -1;
+}
+
+static int ra_equations_operands(int32_t op)
+{
+    switch (op)
+    {
+        case RA_EQUATION_CONST:
+        case RA_EQUATION_VAR:
+        case RA_EQUATION_COEFF:
+            return 0;
+        case RA_EQUATION_ADD:
+        case RA_EQUATION_SUB:
+        case RA_EQUATION_MUL:
+        case RA_EQUATION_DIV:
+        case RA_EQUATION_POW:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * What an operation gives for the given operands. Folding and both
+ * evaluators use this, so a folded constant is exactly what the CPU would
+ * have worked out at run time.
+ */
+static float ra_equations_apply(int32_t op, float a, float b)
+{
+    switch (op)
+    {
+        case RA_EQUATION_NEG:  return -a;
+        case RA_EQUATION_ADD:  return a + b;
+        case RA_EQUATION_SUB:  return a - b;
+        case RA_EQUATION_MUL:  return a * b;
+        case RA_EQUATION_DIV:  return a / b;
+        case RA_EQUATION_POW:  return powf(a, b);
+        case RA_EQUATION_SIN:  return sinf(a);
+        case RA_EQUATION_COS:  return cosf(a);
+        case RA_EQUATION_TAN:  return tanf(a);
+        case RA_EQUATION_TANH: return tanhf(a);
+        case RA_EQUATION_EXP:  return expf(a);
+        case RA_EQUATION_LOG:  return logf(a);
+        case RA_EQUATION_SQRT: return sqrtf(a);
+        case RA_EQUATION_ABS:  return fabsf(a);
+        case RA_EQUATION_SIGN: return (float)((a > 0.0f) - (a < 0.0f));
+        default:               return 0.0f;
+    }
+}
+
+//
+// Building
+//
+// Every node is made through ra_equations_node(), which hands back an
+// existing node if there's an identical one, so shared subexpressions
+// (including those the derivatives share with the equations) are only
+// computed once. The builders above it fold constants and drop the
+// identities (x + 0, x * 1, ...) that differentiating leaves everywhere.
+//
+
+static int32_t ra_equations_node(struct AttractorEquationParser *parser, int32_t op, int32_t a,
+    int32_t b, int32_t index, float value)
+{
+    struct AttractorEquations *equations = parser->equations;
+
+    for (int32_t n = 0; n < equations->node_count; n++)
+    {
+        const struct AttractorEquationNode *node = &equations->nodes[n];
+        if (node->op == op && node->a == a && node->b == b && node->index == index
+            && node->value == value)
+            return n;
+    }
+
+    if (equations->node_count >= RA_EQUATIONS_MAX_NODES)
+    {
+        return ra_equations_fail(parser, "the equations are too long (over %d steps)",
+            RA_EQUATIONS_MAX_NODES);
+    }
+
+    equations->nodes[equations->node_count] = (struct AttractorEquationNode){
+        .op = op, .a = a, .b = b, .index = index, .value = value,
+    };
+    return equations->node_count++;
+}
+
+static int32_t ra_equations_constant(struct AttractorEquationParser *parser, float value)
+{
+    if (!isfinite(value)) return ra_equations_fail(parser, "a constant works out as %f", value);
+    return ra_equations_node(parser, RA_EQUATION_CONST, -1, -1, 0, value);
+}
+
+static bool ra_equations_is(const struct AttractorEquationParser *parser, int32_t n, float value)
+{
+    const struct AttractorEquationNode *node = &parser->equations->nodes[n];
+    return node->op == RA_EQUATION_CONST && node->value == value;
+}
+
+static int32_t ra_equations_unary(struct AttractorEquationParser *parser, int32_t op, int32_t a)
+{
+    if (a < 0) return -1;
+
+    const struct AttractorEquationNode *node = &parser->equations->nodes[a];
+    if (node->op == RA_EQUATION_CONST)
+        return ra_equations_constant(parser, ra_equations_apply(op, node->value, 0.0f));
+    if (op == RA_EQUATION_NEG && node->op == RA_EQUATION_NEG) return node->a;
+
+    return ra_equations_node(parser, op, a, -1, 0, 0.0f);
+}
+
+static int32_t ra_equations_binary(struct AttractorEquationParser *parser, int32_t op, int32_t a,
+    int32_t b)
+{
+    if (a < 0 || b < 0) return -1;
+
+    const struct AttractorEquationNode *nodes = parser->equations->nodes;
+    if (nodes[a].op == RA_EQUATION_CONST && nodes[b].op == RA_EQUATION_CONST)
+    {
+        return ra_equations_constant(parser,
+            ra_equations_apply(op, nodes[a].value, nodes[b].value));
+    }
+
+    switch (op)
+    {
+        case RA_EQUATION_ADD:
+            if (ra_equations_is(parser, a, 0.0f)) return b;
+            if (ra_equations_is(parser, b, 0.0f)) return a;
+            break;
+        case RA_EQUATION_SUB:
+            if (ra_equations_is(parser, b, 0.0f)) return a;
+            if (ra_equations_is(parser, a, 0.0f))
+                return ra_equations_unary(parser, RA_EQUATION_NEG, b);
+            break;
+        case RA_EQUATION_MUL:
+            if (ra_equations_is(parser, a, 0.0f) || ra_equations_is(parser, b, 0.0f))
+                return ra_equations_constant(parser, 0.0f);
+            if (ra_equations_is(parser, a, 1.0f)) return b;
+            if (ra_equations_is(parser, b, 1.0f)) return a;
+            if (ra_equations_is(parser, a, -1.0f))
+                return ra_equations_unary(parser, RA_EQUATION_NEG, b);
+            if (ra_equations_is(parser, b, -1.0f))
+                return ra_equations_unary(parser, RA_EQUATION_NEG, a);
+            break;
+        case RA_EQUATION_DIV:
+            if (ra_equations_is(parser, a, 0.0f)) return ra_equations_constant(parser, 0.0f);
+            if (ra_equations_is(parser, b, 1.0f)) return a;
+            break;
+        case RA_EQUATION_POW:
+            if (ra_equations_is(parser, b, 0.0f)) return ra_equations_constant(parser, 1.0f);
+            if (ra_equations_is(parser, b, 1.0f)) return a;
+            break;
+    }
+
+    // One order for commutative operations, so a * b and b * a are shared
+    if ((op == RA_EQUATION_ADD || op == RA_EQUATION_MUL) && a > b)
+    {
+        int32_t swap = a;
+        a            = b;
+        b            = swap;
+    }
+
+    return ra_equations_node(parser, op, a, b, 0, 0.0f);
+}
+
+/**
+ * base ^ exponent. Small integer powers are multiplied out by squaring, as
+ * GLSL's pow() is undefined for negative bases.
+ */
+static int32_t ra_equations_raise(struct AttractorEquationParser *parser, int32_t base,
+    float exponent)
+{
+    if (exponent != truncf(exponent) || fabsf(exponent) > RA_EQUATIONS_MAX_POWER)
+    {
+        return ra_equations_binary(parser, RA_EQUATION_POW, base,
+            ra_equations_constant(parser, exponent));
+    }
+
+    int32_t result = ra_equations_constant(parser, 1.0f);
+    int32_t square = base;
+    for (int n = abs((int)exponent); n > 0; n >>= 1)
+    {
+        if (n & 1) result = ra_equations_binary(parser, RA_EQUATION_MUL, result, square);
+        if (n > 1) square = ra_equations_binary(parser, RA_EQUATION_MUL, square, square);
+    }
+
+    if (exponent < 0.0f)
+        result = ra_equations_binary(parser, RA_EQUATION_DIV, ra_equations_constant(parser, 1.0f),
+            result);
+    return result;
+}
+
+/**
+ * d node / d variable, built from the nodes that are already there
+ */
+static int32_t ra_equations_derive(struct AttractorEquationParser *parser, int32_t n, int variable,
+    int32_t *memo)
+{
+    if (n < 0 || parser->failed) return -1;
+    if (memo[n] >= 0) return memo[n];
+
+    const struct AttractorEquationNode node = parser->equations->nodes[n];
+
+    int32_t da = 0, db = 0;
+    if (ra_equations_operands(node.op) >= 1)
+        da = ra_equations_derive(parser, node.a, variable, memo);
+    if (ra_equations_operands(node.op) >= 2)
+        db = ra_equations_derive(parser, node.b, variable, memo);
+
+    int32_t zero = ra_equations_constant(parser, 0.0f);
+    int32_t one  = ra_equations_constant(parser, 1.0f);
+
+    int32_t d = -1;
+    switch (node.op)
+    {
+        case RA_EQUATION_CONST:
+        case RA_EQUATION_COEFF:
+        case RA_EQUATION_SIGN:
+            d = zero;
+            break;
+        case RA_EQUATION_VAR:
+            d = (node.index == variable) ? one : zero;
+            break;
+        case RA_EQUATION_NEG:
+            d = ra_equations_unary(parser, RA_EQUATION_NEG, da);
+            break;
+        case RA_EQUATION_ADD:
+        case RA_EQUATION_SUB:
+            d = ra_equations_binary(parser, node.op, da, db);
+            break;
+        case RA_EQUATION_MUL:
+            d = ra_equations_binary(parser, RA_EQUATION_ADD,
+                ra_equations_binary(parser, RA_EQUATION_MUL, da, node.b),
+                ra_equations_binary(parser, RA_EQUATION_MUL, node.a, db));
+            break;
+        case RA_EQUATION_DIV:
+            // (da - n * db) / b, which is just da / b if b is constant
+            d = ra_equations_binary(parser, RA_EQUATION_DIV,
+                ra_equations_binary(parser, RA_EQUATION_SUB, da,
+                    ra_equations_binary(parser, RA_EQUATION_MUL, n, db)),
+                node.b);
+            break;
+        case RA_EQUATION_POW:
+        {
+            float exponent = parser->equations->nodes[node.b].value;
+            d = ra_equations_binary(parser, RA_EQUATION_MUL,
+                ra_equations_binary(parser, RA_EQUATION_MUL,
+                    ra_equations_constant(parser, exponent),
+                    ra_equations_raise(parser, node.a, exponent - 1.0f)),
+                da);
+            break;
+        }
+        case RA_EQUATION_SIN:
+            d = ra_equations_binary(parser, RA_EQUATION_MUL,
+                ra_equations_unary(parser, RA_EQUATION_COS, node.a), da);
+            break;
+        case RA_EQUATION_COS:
+            d = ra_equations_unary(parser, RA_EQUATION_NEG,
+                ra_equations_binary(parser, RA_EQUATION_MUL,
+                    ra_equations_unary(parser, RA_EQUATION_SIN, node.a), da));
+            break;
+        case RA_EQUATION_TAN:
+            d = ra_equations_binary(parser, RA_EQUATION_MUL,
+                ra_equations_binary(parser, RA_EQUATION_ADD, one,
+                    ra_equations_binary(parser, RA_EQUATION_MUL, n, n)),
+                da);
+            break;
+        case RA_EQUATION_TANH:
+            d = ra_equations_binary(parser, RA_EQUATION_MUL,
+                ra_equations_binary(parser, RA_EQUATION_SUB, one,
+                    ra_equations_binary(parser, RA_EQUATION_MUL, n, n)),
+                da);
+            break;
+        case RA_EQUATION_EXP:
+            d = ra_equations_binary(parser, RA_EQUATION_MUL, n, da);
+            break;
+        case RA_EQUATION_LOG:
+            d = ra_equations_binary(parser, RA_EQUATION_DIV, da, node.a);
+            break;
+        case RA_EQUATION_SQRT:
+            d = ra_equations_binary(parser, RA_EQUATION_DIV, da,
+                ra_equations_binary(parser, RA_EQUATION_MUL, ra_equations_constant(parser, 2.0f),
+                    n));
+            break;
+        case RA_EQUATION_ABS:
+            d = ra_equations_binary(parser, RA_EQUATION_MUL,
+                ra_equations_unary(parser, RA_EQUATION_SIGN, node.a), da);
+            break;
+    }
+
+    memo[n] = d;
+    return d;
+}
+
+/**
+ * List the nodes the given roots depend on, in order
+ */
+static int32_t ra_equations_program(const struct AttractorEquations *equations,
+    const int32_t *roots, int root_count, int32_t *program)
+{
+    bool live[RA_EQUATIONS_MAX_NODES] = { false };
+    for (int i = 0; i < root_count; i++) live[roots[i]] = true;
+
+    // Operands always come first, so one pass backwards finds them all
+    for (int32_t n = equations->node_count - 1; n >= 0; n--)
+    {
+        if (!live[n]) continue;
+
+        const struct AttractorEquationNode *node = &equations->nodes[n];
+        if (ra_equations_operands(node->op) >= 1) live[node->a] = true;
+        if (ra_equations_operands(node->op) >= 2) live[node->b] = true;
+    }
+
+    int32_t length = 0;
+    for (int32_t n = 0; n < equations->node_count; n++)
+    {
+        if (live[n]) program[length++] = n;
+    }
+    return length;
+}
+
+//
+// Parsing
+//
+// expression := term (('+' | '-') term)*
+// term       := factor (('*' | '/') factor)*
+// factor     := ('-' | '+') factor | power
+// power      := primary ('^' factor)?
+// primary    := number | name | function '(' expression ')' | '(' expression ')'
+//
+
+static int32_t ra_equations_expression(struct AttractorEquationParser *parser);
+static int32_t ra_equations_factor(struct AttractorEquationParser *parser);
+
+static void ra_equations_skip_space(struct AttractorEquationParser *parser)
+{
+    while (parser->c < parser->end && isspace((unsigned char)*parser->c)) parser->c++;
+}
+
+static bool ra_equations_accept(struct AttractorEquationParser *parser, char c)
+{
+    ra_equations_skip_space(parser);
+    if (parser->c == parser->end || *parser->c != c) return false;
+
+    parser->c++;
+    return true;
+}
+
+static bool ra_equations_is_name(const char *c, const char *end)
+{
+    if (c == end || !(isalpha((unsigned char)*c) || *c == '_')) return false;
+    for (; c < end; c++)
+    {
+        if (!(isalnum((unsigned char)*c) || *c == '_')) return false;
+    }
+    return true;
+}
+
+/**
+ * Copy the name at the parser into name, and move past it
+ */
+static bool ra_equations_read_name(struct AttractorEquationParser *parser,
+    char name[RA_EQUATIONS_NAME_LENGTH])
+{
+    const char *start = parser->c;
+    while (parser->c < parser->end && (isalnum((unsigned char)*parser->c) || *parser->c == '_'))
+        parser->c++;
+
+    int length = (int)(parser->c - start);
+    if (length >= RA_EQUATIONS_NAME_LENGTH)
+    {
+        ra_equations_fail(parser, "'%.*s' is too long a name", length, start);
+        return false;
+    }
+
+    memcpy(name, start, (size_t)length);
+    name[length] = '\0';
+    return true;
+}
+
+static int32_t ra_equations_function(const char *name)
+{
+    for (size_t i = 0; i < sizeof(ra_equations_functions) / sizeof(ra_equations_functions[0]); i++)
+    {
+        if (strcmp(name, ra_equations_functions[i].name) == 0) return ra_equations_functions[i].op;
+    }
+    return -1;
+}
+
+static int32_t ra_equations_coefficient(struct AttractorEquationParser *parser, int coefficient,
+    const char *name)
+{
+    if (parser->constant_only)
+    {
+        return ra_equations_fail(parser,
+            "a constant can't depend on %s, which is searched (give it a value first)", name);
+    }
+    return ra_equations_node(parser, RA_EQUATION_COEFF, -1, -1, coefficient, 0.0f);
+}
+
+/**
+ * A name that isn't a function: a constant, x, y, z or a coefficient
+ */
+static int32_t ra_equations_name(struct AttractorEquationParser *parser, const char *name)
+{
+    for (int i = 0; i < parser->constant_count; i++)
+    {
+        if (strcmp(name, parser->constant_names[i]) == 0) return parser->constant_nodes[i];
+    }
+
+    if (strcmp(name, "pi") == 0) return ra_equations_constant(parser, (float)RA_EQUATIONS_PI);
+
+    if (name[0] != '\0' && name[1] == '\0')
+    {
+        const char *variable = memchr(ra_equations_variables, name[0],
+            sizeof(ra_equations_variables));
+        if (variable)
+        {
+            if (parser->constant_only)
+                return ra_equations_fail(parser, "a constant can't depend on %s", name);
+            return ra_equations_node(parser, RA_EQUATION_VAR, -1, -1,
+                (int32_t)(variable - ra_equations_variables), 0.0f);
+        }
+
+        int coefficient = name[0] - 'a';
+        if (0 <= coefficient && coefficient < RA_EQUATIONS_LETTERS)
+            return ra_equations_coefficient(parser, coefficient, name);
+    }
+
+    return ra_equations_fail(parser, "unknown name '%s'", name);
+}
+
+/**
+ * COEFF[k].x, .y or .z, after the COEFF
+ */
+static int32_t ra_equations_indexed_coefficient(struct AttractorEquationParser *parser)
+{
+    ra_equations_skip_space(parser);
+    if (parser->c == parser->end || !isdigit((unsigned char)*parser->c))
+        return ra_equations_fail(parser, "expected COEFF[k].x, .y or .z");
+
+    int k = 0;
+    while (parser->c < parser->end && isdigit((unsigned char)*parser->c) && k < 100)
+        k = k * 10 + (*parser->c++ - '0');
+
+    if (!ra_equations_accept(parser, ']') || !ra_equations_accept(parser, '.')
+        || parser->c == parser->end)
+        return ra_equations_fail(parser, "expected COEFF[k].x, .y or .z");
+
+    const char *component = memchr(ra_equations_variables, *parser->c,
+        sizeof(ra_equations_variables));
+    int coefficient = k * 3 + (component ? (int)(component - ra_equations_variables) : 0);
+    if (!component || coefficient >= RA_EQUATIONS_MAX_COEFFICIENTS)
+    {
+        return ra_equations_fail(parser, "COEFF only goes from COEFF[0].x to COEFF[%d].z",
+            RA_EQUATIONS_MAX_COEFFICIENTS / 3 - 1);
+    }
+    parser->c++;
+
+    char name[RA_EQUATIONS_NAME_LENGTH];
+    snprintf(name, sizeof(name), "COEFF[%d].%c", k, ra_equations_variables[coefficient % 3]);
+    return ra_equations_coefficient(parser, coefficient, name);
+}
+
+static int32_t ra_equations_primary(struct AttractorEquationParser *parser)
+{
+    ra_equations_skip_space(parser);
+    if (parser->c == parser->end)
+        return ra_equations_fail(parser, "expected a number, name or '('");
+
+    if (isdigit((unsigned char)*parser->c) || *parser->c == '.')
+    {
+        char *after = NULL;
+        float value = strtof(parser->c, &after);
+        if (after == parser->c || after > parser->end)
+            return ra_equations_fail(parser, "couldn't read a number");
+
+        parser->c = after;
+        return ra_equations_constant(parser, value);
+    }
+
+    if (ra_equations_accept(parser, '('))
+    {
+        int32_t n = ra_equations_expression(parser);
+        if (!ra_equations_accept(parser, ')')) return ra_equations_fail(parser, "expected ')'");
+        return n;
+    }
+
+    if (isalpha((unsigned char)*parser->c) || *parser->c == '_')
+    {
+        char name[RA_EQUATIONS_NAME_LENGTH];
+        if (!ra_equations_read_name(parser, name)) return -1;
+
+        if (strcmp(name, "COEFF") == 0 && ra_equations_accept(parser, '['))
+            return ra_equations_indexed_coefficient(parser);
+        if (!ra_equations_accept(parser, '(')) return ra_equations_name(parser, name);
+
+        int32_t op = ra_equations_function(name);
+        if (op < 0) return ra_equations_fail(parser, "unknown function '%s'", name);
+
+        int32_t n = ra_equations_expression(parser);
+        if (!ra_equations_accept(parser, ')'))
+            return ra_equations_fail(parser, "expected ')' after %s's argument", name);
+        return ra_equations_unary(parser, op, n);
+    }
+
+    return ra_equations_fail(parser, "unexpected '%c'", *parser->c);
+}
+
+static int32_t ra_equations_power(struct AttractorEquationParser *parser)
+{
+    int32_t base = ra_equations_primary(parser);
+    if (!ra_equations_accept(parser, '^')) return base;
+
+    int32_t exponent = ra_equations_factor(parser);
+    if (base < 0 || exponent < 0) return -1;
+
+    const struct AttractorEquationNode *node = &parser->equations->nodes[exponent];
+    if (node->op != RA_EQUATION_CONST)
+        return ra_equations_fail(parser, "exponents must be constant");
+
+    return ra_equations_raise(parser, base, node->value);
+}
+
+static int32_t ra_equations_factor(struct AttractorEquationParser *parser)
+{
+    // Every kind of nesting recurses through here, so this bounds the stack
+    if (parser->depth >= RA_EQUATIONS_MAX_DEPTH)
+    {
+        return ra_equations_fail(parser, "nested more than %d deep", RA_EQUATIONS_MAX_DEPTH);
+    }
+
+    parser->depth++;
+    int32_t n;
+    if (ra_equations_accept(parser, '-'))
+    {
+        n = ra_equations_unary(parser, RA_EQUATION_NEG, ra_equations_factor(parser));
+    }
+    else if (ra_equations_accept(parser, '+'))
+    {
+        n = ra_equations_factor(parser);
+    }
+    else
+    {
+        n = ra_equations_power(parser);
+    }
+    parser->depth--;
+    return n;
+}
+
+static int32_t ra_equations_term(struct AttractorEquationParser *parser)
+{
+    int32_t n = ra_equations_factor(parser);
+    while (!parser->failed)
+    {
+        if (ra_equations_accept(parser, '*'))
+        {
+            n = ra_equations_binary(parser, RA_EQUATION_MUL, n, ra_equations_factor(parser));
+        }
+        else if (ra_equations_accept(parser, '/'))
+        {
+            n = ra_equations_binary(parser, RA_EQUATION_DIV, n, ra_equations_factor(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+    return n;
+}
+
+static int32_t ra_equations_expression(struct AttractorEquationParser *parser)
+{
+    int32_t n = ra_equations_term(parser);
+    while (!parser->failed)
+    {
+        if (ra_equations_accept(parser, '+'))
+        {
+            n = ra_equations_binary(parser, RA_EQUATION_ADD, n, ra_equations_term(parser));
+        }
+        else if (ra_equations_accept(parser, '-'))
+        {
+            n = ra_equations_binary(parser, RA_EQUATION_SUB, n, ra_equations_term(parser));
+        }
+        else
+        {
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * Parse the right-hand side of a line, which must be all that's left of it
+ */
+static int32_t ra_equations_line_expression(struct AttractorEquationParser *parser)
+{
+    int32_t n = ra_equations_expression(parser);
+    ra_equations_skip_space(parser);
+    if (n >= 0 && parser->c != parser->end)
+        return ra_equations_fail(parser, "unexpected '%c'", *parser->c);
+    return n;
+}
+
+/**
+ * Parse one line. Constants are defined on the first pass, so that the
+ * equations can use them wherever they are in the file, and the equations
+ * on the second.
+ */
+static void ra_equations_parse_line(struct AttractorEquationParser *parser, const char *line,
+    const char *end, int pass)
+{
+    const char *comment = memchr(line, '#', (size_t)(end - line));
+    if (comment) end = comment;
+
+    while (line < end && isspace((unsigned char)*line)) line++;
+    while (line < end && isspace((unsigned char)end[-1])) end--;
+    if (line == end) return;
+
+    const char *equals = memchr(line, '=', (size_t)(end - line));
+    if (equals == NULL)
+    {
+        ra_equations_fail(parser, "expected <name> = <expression>");
+        return;
+    }
+
+    const char *lhs_end = equals;
+    while (lhs_end > line && isspace((unsigned char)lhs_end[-1])) lhs_end--;
+
+    int         variable = -1;
+    const char *prime    = (lhs_end - line == 2 && line[1] == '\'') ?
+        memchr(ra_equations_variables, line[0], sizeof(ra_equations_variables)) : NULL;
+    if (prime) variable = (int)(prime - ra_equations_variables);
+
+    parser->c   = equals + 1;
+    parser->end = end;
+
+    if (pass == 0 && variable < 0)
+    {
+        char name[RA_EQUATIONS_NAME_LENGTH];
+        parser->c   = line;
+        parser->end = lhs_end;
+        if (!ra_equations_is_name(line, lhs_end))
+        {
+            ra_equations_fail(parser, "'%.*s' isn't x', y', z' or a name", (int)(lhs_end - line),
+                line);
+            return;
+        }
+        if (!ra_equations_read_name(parser, name)) return;
+
+        bool reserved = ra_equations_function(name) >= 0 || strcmp(name, "pi") == 0
+            || strcmp(name, "COEFF") == 0
+            || (name[1] == '\0'
+                && memchr(ra_equations_variables, name[0], sizeof(ra_equations_variables)));
+        if (reserved)
+        {
+            ra_equations_fail(parser, "%s can't be given a value", name);
+            return;
+        }
+        for (int i = 0; i < parser->constant_count; i++)
+        {
+            if (strcmp(name, parser->constant_names[i]) == 0)
+            {
+                ra_equations_fail(parser, "%s is given a value twice", name);
+                return;
+            }
+        }
+        if (parser->constant_count >= RA_EQUATIONS_MAX_CONSTANTS)
+        {
+            ra_equations_fail(parser, "too many constants (over %d)", RA_EQUATIONS_MAX_CONSTANTS);
+            return;
+        }
+
+        parser->c             = equals + 1;
+        parser->end           = end;
+        parser->constant_only = true;
+        int32_t n             = ra_equations_line_expression(parser);
+        parser->constant_only = false;
+        if (n < 0) return;
+
+        snprintf(parser->constant_names[parser->constant_count], RA_EQUATIONS_NAME_LENGTH, "%s",
+            name);
+        parser->constant_nodes[parser->constant_count++] = n;
+    }
+    else if (pass == 1 && variable >= 0)
+    {
+        if (parser->equations->next[variable] >= 0)
+        {
+            ra_equations_fail(parser, "%c' is given twice", ra_equations_variables[variable]);
+            return;
+        }
+
+        parser->equations->next[variable] = ra_equations_line_expression(parser);
+    }
+}
+
+/**
+ * Compile the equations in source (see attractor_equations.h).
+ *
+ * @returns false, with a message in error, if they couldn't be
+ */
+bool ra_equations_parse(struct AttractorEquations *equations, const char *source, char *error,
+    size_t error_size)
+{
+    memset(equations, 0, sizeof(*equations));
+    for (int i = 0; i < 3; i++) equations->next[i] = -1;
+
+    struct AttractorEquationParser *parser = calloc(1, sizeof(*parser));
+    if (parser == NULL)
+    {
+        snprintf(error, error_size, "Out of memory");
+        return false;
+    }
+    parser->equations  = equations;
+    parser->error      = error;
+    parser->error_size = error_size;
+
+    for (int pass = 0; pass < 2 && !parser->failed; pass++)
+    {
+        parser->line = 0;
+        for (const char *line = source; *line != '\0' && !parser->failed;)
+        {
+            const char *end = strchr(line, '\n');
+            if (end == NULL) end = line + strlen(line);
+
+            parser->line++;
+            ra_equations_parse_line(parser, line, end, pass);
+            line = (*end == '\n') ? end + 1 : end;
+        }
+    }
+
+    parser->line = 0;
+    for (int i = 0; i < 3 && !parser->failed; i++)
+    {
+        if (equations->next[i] < 0)
+            ra_equations_fail(parser, "%c' is missing", ra_equations_variables[i]);
+    }
+
+    for (int column = 0; column < 3 && !parser->failed; column++)
+    {
+        int32_t memo[RA_EQUATIONS_MAX_NODES];
+        for (int n = 0; n < RA_EQUATIONS_MAX_NODES; n++) memo[n] = -1;
+
+        for (int row = 0; row < 3; row++)
+        {
+            equations->partial[row][column] = ra_equations_derive(parser, equations->next[row],
+                column, memo);
+        }
+    }
+
+    bool ok = !parser->failed;
+    free(parser);
+    if (!ok) return false;
+
+    int32_t roots[12];
+    for (int i = 0; i < 3; i++)
+    {
+        roots[i] = equations->next[i];
+        for (int j = 0; j < 3; j++) roots[3 + i * 3 + j] = equations->partial[i][j];
+    }
+    equations->next_length    = ra_equations_program(equations, roots, 3, equations->next_program);
+    equations->tangent_length = ra_equations_program(equations, roots, 12,
+        equations->tangent_program);
+
+    for (int i = 0; i < equations->tangent_length; i++)
+    {
+        const struct AttractorEquationNode *node = &equations->nodes[equations->tangent_program[i]];
+        if (node->op == RA_EQUATION_COEFF) equations->coefficients |= 1u << node->index;
+    }
+
+    return true;
+}
+
+/**
+ * Read and compile an equations file.
+ */
+bool ra_equations_load(struct AttractorEquations *equations, const char *path, char *error,
+    size_t error_size)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        snprintf(error, error_size, "Couldn't open %s", path);
+        return false;
+    }
+
+    char  *source = malloc(RA_EQUATIONS_MAX_SOURCE + 1);
+    size_t length = source ? fread(source, 1, RA_EQUATIONS_MAX_SOURCE + 1, file) : 0;
+    fclose(file);
+
+    if (source == NULL || length > RA_EQUATIONS_MAX_SOURCE)
+    {
+        snprintf(error, error_size, "%s is too big to be equations", path);
+        free(source);
+        return false;
+    }
+    source[length] = '\0';
+
+    bool ok = ra_equations_parse(equations, source, error, error_size);
+    free(source);
+
+    // The custom family only draws COEFF[0] to COEFF[3]
+    if (ok && (equations->coefficients >> RA_EQUATIONS_LETTERS) != 0)
+    {
+        snprintf(error, error_size, "%s can only use the coefficients a to l (COEFF[3].z)", path);
+        ok = false;
+    }
+    return ok;
+}
+
+//
+// Code
+//
+// A program is written out statement by statement, in the order
+// ra_equations_run() takes it, as GLSL for mesh_cs.glsl or as C for the CPU
+// engine, so the GPU, the generated C and the CPU's own evaluation all do
+// the same float operations.
+//
+
+enum RA_EquationsLanguage
+{
+    RA_EQUATIONS_GLSL,
+    RA_EQUATIONS_C,
+};
+
+/**
+ * snprintf() onto the end of out, keeping count of the whole length even
+ * once it's run out of room, like snprintf() itself
+ */
+static void ra_equations_print(char *out, size_t size, size_t *length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(*length < size ? out + *length : NULL,
+        *length < size ? size - *length : 0, format, args);
+    va_end(args);
+
+    if (written > 0) *length += (size_t)written;
+}
+
+/**
+ * How an operand reads: a name, a temporary or a literal
+ */
+static void ra_equations_operand(const struct AttractorEquations *equations, int32_t n,
+    enum RA_EquationsLanguage language, char *text, size_t size)
+{
+    const struct AttractorEquationNode *node = &equations->nodes[n];
+    switch (node->op)
+    {
+        case RA_EQUATION_CONST:
+        {
+            // %.9g round-trips a float, and GLSL needs a '.' or exponent to
+            // read it as one
+            char number[32];
+            snprintf(number, sizeof(number), "%.9g", node->value);
+            if (strpbrk(number, ".e") == NULL) strcat(number, ".0");
+            if (language == RA_EQUATIONS_C) strcat(number, "f");
+            snprintf(text, size, node->value < 0.0f ? "(%s)" : "%s", number);
+            break;
+        }
+        case RA_EQUATION_VAR:
+            snprintf(text, size, "%c", ra_equations_variables[node->index]);
+            break;
+        case RA_EQUATION_COEFF:
+            snprintf(text, size, "k%d%c", node->index / 3, ra_equations_variables[node->index % 3]);
+            break;
+        default:
+            snprintf(text, size, "t%d", n);
+            break;
+    }
+}
+
+static const char *ra_equations_call(int32_t op, enum RA_EquationsLanguage language)
+{
+    bool glsl = language == RA_EQUATIONS_GLSL;
+    switch (op)
+    {
+        case RA_EQUATION_POW:  return glsl ? "pow" : "powf";
+        case RA_EQUATION_SIN:  return glsl ? "sin" : "sinf";
+        case RA_EQUATION_COS:  return glsl ? "cos" : "cosf";
+        case RA_EQUATION_TAN:  return glsl ? "tan" : "tanf";
+        case RA_EQUATION_TANH: return glsl ? "tanh" : "tanhf";
+        case RA_EQUATION_EXP:  return glsl ? "exp" : "expf";
+        case RA_EQUATION_LOG:  return glsl ? "log" : "logf";
+        case RA_EQUATION_SQRT: return glsl ? "sqrt" : "sqrtf";
+        case RA_EQUATION_ABS:  return glsl ? "abs" : "fabsf";
+        default:               return "";
+    }
+}
+
+/**
+ * The start of a function: the coefficients and variables the program
+ * reads (from point, in GLSL), and then every step of it as a temporary.
+ *
+ * @returns whether the program reads x, y or z at all
+ */
+static bool ra_equations_print_program(
+    const struct AttractorEquations *equations, const int32_t *program, int32_t length,
+    enum RA_EquationsLanguage language, const char *point, char *out, size_t size, size_t *written)
+{
+    uint32_t coefficients = 0;
+    bool     variables[3] = { false, false, false };
+    for (int32_t i = 0; i < length; i++)
+    {
+        const struct AttractorEquationNode *node = &equations->nodes[program[i]];
+        if (node->op == RA_EQUATION_COEFF) coefficients |= 1u << node->index;
+        if (node->op == RA_EQUATION_VAR) variables[node->index] = true;
+    }
+
+    for (int i = 0; i < RA_EQUATIONS_MAX_COEFFICIENTS; i++)
+    {
+        if (!(coefficients & (1u << i))) continue;
+
+        int  k = i / 3;
+        char c = ra_equations_variables[i % 3];
+        if (language == RA_EQUATIONS_GLSL)
+            ra_equations_print(out, size, written, "    const float k%d%c = COEFF[%d].%c;\n", k, c,
+                k, c);
+        else
+            ra_equations_print(out, size, written, "    const float k%d%c = coeff[%d * stride];\n",
+                k, c, k * 4 + i % 3);
+    }
+    if (coefficients == 0 && language == RA_EQUATIONS_C)
+        ra_equations_print(out, size, written, "    (void)coeff;\n    (void)stride;\n");
+    ra_equations_print(out, size, written, "\n");
+
+    bool any = false;
+    for (int i = 0; i < 3; i++)
+    {
+        if (!variables[i]) continue;
+
+        char c = ra_equations_variables[i];
+        if (language == RA_EQUATIONS_GLSL)
+            ra_equations_print(out, size, written, "    float %c = %s.%c;\n", c, point, c);
+        else
+            ra_equations_print(out, size, written, "    const float %c = p[%d];\n", c, i);
+        any = true;
+    }
+    if (any) ra_equations_print(out, size, written, "\n");
+
+    const char *type = language == RA_EQUATIONS_GLSL ? "float" : "const float";
+    for (int32_t i = 0; i < length; i++)
+    {
+        const struct AttractorEquationNode *node = &equations->nodes[program[i]];
+        if (ra_equations_operands(node->op) == 0) continue;
+
+        char a[48], b[48];
+        ra_equations_operand(equations, node->a, language, a, sizeof(a));
+        if (ra_equations_operands(node->op) == 2)
+            ra_equations_operand(equations, node->b, language, b, sizeof(b));
+
+        ra_equations_print(out, size, written, "    %s t%d = ", type, program[i]);
+        switch (node->op)
+        {
+            case RA_EQUATION_NEG: ra_equations_print(out, size, written, "-%s;\n", a); break;
+            case RA_EQUATION_ADD: ra_equations_print(out, size, written, "%s + %s;\n", a, b); break;
+            case RA_EQUATION_SUB: ra_equations_print(out, size, written, "%s - %s;\n", a, b); break;
+            case RA_EQUATION_MUL: ra_equations_print(out, size, written, "%s * %s;\n", a, b); break;
+            case RA_EQUATION_DIV: ra_equations_print(out, size, written, "%s / %s;\n", a, b); break;
+            case RA_EQUATION_POW:
+                ra_equations_print(out, size, written, "%s(%s, %s);\n",
+                    ra_equations_call(node->op, language), a, b);
+                break;
+            case RA_EQUATION_SIGN:
+                if (language == RA_EQUATIONS_GLSL)
+                    ra_equations_print(out, size, written, "sign(%s);\n", a);
+                else
+                    ra_equations_print(out, size, written, "(float)((%s > 0.0f) - (%s < 0.0f));\n",
+                        a, a);
+                break;
+            default:
+                ra_equations_print(out, size, written, "%s(%s);\n",
+                    ra_equations_call(node->op, language), a);
+                break;
+        }
+    }
+
+    return any;
+}
+
+/**
+ * Row of the Jacobian applied to the vector v, leaving out the partials
+ * that are 0, or "0.0" if they all are.
+ *
+ * @returns whether v was read
+ */
+static bool ra_equations_print_row(const struct AttractorEquations *equations, int row,
+    enum RA_EquationsLanguage language, const char *v, char *out, size_t size, size_t *written)
+{
+    bool first = true;
+    for (int column = 0; column < 3; column++)
+    {
+        int32_t partial = equations->partial[row][column];
+        if (equations->nodes[partial].op == RA_EQUATION_CONST
+            && equations->nodes[partial].value == 0.0f)
+            continue;
+
+        char text[48];
+        ra_equations_operand(equations, partial, language, text, sizeof(text));
+        if (language == RA_EQUATIONS_GLSL)
+            ra_equations_print(out, size, written, "%s%s * %s.%c", first ? "" : " + ", text, v,
+                ra_equations_variables[column]);
+        else
+            ra_equations_print(out, size, written, "%s%s * %s[%d]", first ? "" : " + ", text, v,
+                column);
+        first = false;
+    }
+
+    if (first)
+        ra_equations_print(out, size, written, language == RA_EQUATIONS_GLSL ? "0.0" : "0.0f");
+    return !first;
+}
+
+/**
+ * Write the equations out as the functions of the kernel called name (see
+ * ra_equations_glsl_kernel() and ra_equations_c_kernel())
+ */
+static void ra_equations_print_kernel(const struct AttractorEquations *equations,
+    const char *name, bool flow, enum RA_EquationsLanguage language, char *out, size_t size,
+    size_t *written)
+{
+    // The Jacobian on its own, as the C compiler would warn about the
+    // unused temporaries of the whole tangent program
+    int32_t jacobian[RA_EQUATIONS_MAX_NODES];
+    int32_t jacobian_length = ra_equations_program(equations, &equations->partial[0][0], 9,
+        jacobian);
+
+    char operand[3][48];
+    for (int i = 0; i < 3; i++)
+    {
+        ra_equations_operand(equations, equations->next[i], language, operand[i],
+            sizeof(operand[i]));
+    }
+
+    const char *point = flow ? "p" : "PREVIOUS[0]";
+    if (language == RA_EQUATIONS_GLSL)
+    {
+        ra_equations_print(out, size, written, flow ? "vec3 derivative_%s(vec3 p)\n{\n"
+                                                    : "vec4 factory_%s()\n{\n", name);
+        ra_equations_print_program(equations, equations->next_program, equations->next_length,
+            language, point, out, size, written);
+        ra_equations_print(out, size, written,
+            flow ? "\n    return vec3(%s, %s, %s);\n}\n\n"
+                 : "\n    return vec4(%s, %s, %s, 1.0);\n}\n\n",
+            operand[0], operand[1], operand[2]);
+
+        ra_equations_print(out, size, written,
+            "/**\n * The Jacobian of %s_%s() at %s, applied to v\n */\n",
+            flow ? "derivative" : "factory", name, point);
+        ra_equations_print(out, size, written,
+            flow ? "vec3 tangent_%s(vec3 p, vec3 v)\n{\n" : "vec3 tangent_%s(vec3 v)\n{\n", name);
+        ra_equations_print_program(equations, jacobian, jacobian_length, language, point, out,
+            size, written);
+        ra_equations_print(out, size, written, "\n    return vec3(\n");
+        for (int row = 0; row < 3; row++)
+        {
+            ra_equations_print(out, size, written, "        ");
+            ra_equations_print_row(equations, row, language, "v", out, size, written);
+            ra_equations_print(out, size, written, row < 2 ? ",\n" : "\n");
+        }
+        ra_equations_print(out, size, written, "    );\n}\n");
+        return;
+    }
+
+    ra_equations_print(out, size, written,
+        "static inline void ra_kernel_%s(const float *coeff, int stride, const float p[3],\n"
+        "    float %c[3])\n{\n", name, flow ? 'd' : 'n');
+    if (!ra_equations_print_program(equations, equations->next_program, equations->next_length,
+            language, point, out, size, written))
+        ra_equations_print(out, size, written, "    (void)p;\n");
+    ra_equations_print(out, size, written, "\n");
+    for (int i = 0; i < 3; i++)
+        ra_equations_print(out, size, written, "    %c[%d] = %s;\n", flow ? 'd' : 'n', i,
+            operand[i]);
+    ra_equations_print(out, size, written, "}\n\n");
+
+    if (flow)
+    {
+        ra_equations_print(out, size, written,
+            "// The Jacobian of ra_kernel_%s() at p, applied to w\n"
+            "static inline void ra_kernel_%s_tangent(const float *coeff, int stride,\n"
+            "    const float p[3], const float w[3], float d[3])\n{\n", name, name);
+        if (!ra_equations_print_program(equations, jacobian, jacobian_length, language, point, out,
+                size, written))
+            ra_equations_print(out, size, written, "    (void)p;\n");
+        ra_equations_print(out, size, written, "\n");
+        bool read = false;
+        for (int row = 0; row < 3; row++)
+        {
+            ra_equations_print(out, size, written, "    d[%d] = ", row);
+            read |= ra_equations_print_row(equations, row, language, "w", out, size, written);
+            ra_equations_print(out, size, written, ";\n");
+        }
+        if (!read) ra_equations_print(out, size, written, "    (void)w;\n");
+        ra_equations_print(out, size, written, "}\n");
+        return;
+    }
+
+    ra_equations_print(out, size, written,
+        "// ra_kernel_%s(), also replacing v with the Jacobian at p applied to it\n"
+        "static inline void ra_kernel_%s_tangent(const float *coeff, int stride,\n"
+        "    const float p[3], float v[3], float n[3])\n{\n", name, name);
+    if (!ra_equations_print_program(equations, equations->tangent_program,
+            equations->tangent_length, language, point, out, size, written))
+        ra_equations_print(out, size, written, "    (void)p;\n");
+    ra_equations_print(out, size, written, "\n");
+    for (int row = 0; row < 3; row++)
+    {
+        ra_equations_print(out, size, written, "    const float jv%d = ", row);
+        ra_equations_print_row(equations, row, language, "v", out, size, written);
+        ra_equations_print(out, size, written, ";\n");
+    }
+    for (int i = 0; i < 3; i++)
+        ra_equations_print(out, size, written, "    n[%d] = %s;\n", i, operand[i]);
+    for (int i = 0; i < 3; i++) ra_equations_print(out, size, written, "    v[%d] = jv%d;\n", i, i);
+    ra_equations_print(out, size, written, "}\n");
+}
+
+/**
+ * Write the equations out as GLSL for mesh_cs.glsl: for a map,
+ * factory_<name>(), the next point from PREVIOUS[0], and tangent_<name>(v),
+ * its Jacobian there applied to v; for a flow, derivative_<name>(p) and
+ * tangent_<name>(p, v), the derivative at p and its Jacobian applied to v.
+ * Coefficients are read from COEFF.
+ *
+ * @returns the length of the whole GLSL, like snprintf(), so a size of 0
+ *          measures it
+ */
+size_t ra_equations_glsl_kernel(const struct AttractorEquations *equations, const char *name,
+    bool flow, char *glsl, size_t size)
+{
+    size_t length = 0;
+    if (size > 0) glsl[0] = '\0';
+    ra_equations_print_kernel(equations, name, flow, RA_EQUATIONS_GLSL, glsl, size, &length);
+    return length;
+}
+
+/**
+ * Likewise, as C for the CPU engine: ra_kernel_<name>() and
+ * ra_kernel_<name>_tangent(), which take their coefficients with a stride
+ * like the engine's factories. A map's tangent also gives the next point,
+ * and replaces v with J * v, while a flow's gives J * w.
+ */
+size_t ra_equations_c_kernel(const struct AttractorEquations *equations, const char *name,
+    bool flow, char *c, size_t size)
+{
+    size_t length = 0;
+    if (size > 0) c[0] = '\0';
+    ra_equations_print_kernel(equations, name, flow, RA_EQUATIONS_C, c, size, &length);
+    return length;
+}
+
+/**
+ * Write factory_custom() and tangent_custom() for mesh_cs.glsl, to replace
+ * RA_EQUATIONS_PRAGMA with. Without equations, they're stubs, as the custom
+ * family is never bound.
+ *
+ * @returns the length of the whole GLSL, like snprintf(), so a size of 0
+ *          measures it
+ */
+size_t ra_equations_glsl(const struct AttractorEquations *equations, char *glsl, size_t size)
+{
+    size_t length = 0;
+    if (size > 0) glsl[0] = '\0';
+
+    if (equations == NULL)
+    {
+        ra_equations_print(glsl, size, &length,
+            "// No /equations, so the custom family is never bound\n"
+            "vec4 factory_custom()\n{\n    return PREVIOUS[0];\n}\n\n"
+            "vec3 tangent_custom(vec3 v)\n{\n    return v;\n}\n");
+        return length;
+    }
+
+    ra_equations_print(glsl, size, &length,
+        "// From /equations on the host, see attractor_equations.c\n");
+    ra_equations_print_kernel(equations, "custom", false, RA_EQUATIONS_GLSL, glsl, size, &length);
+    return length;
+}
+
+//
+// CPU evaluation
+//
+// Takes its coefficients with a stride, like the engine's factories.
+//
+
+static void ra_equations_run(
+    const struct AttractorEquations *equations, const int32_t *program, int32_t length,
+    const float *coeff, int stride, const float p[3], float *r)
+{
+    for (int32_t i = 0; i < length; i++)
+    {
+        const struct AttractorEquationNode *node = &equations->nodes[program[i]];
+        switch (node->op)
+        {
+            case RA_EQUATION_CONST:
+                r[program[i]] = node->value;
+                break;
+            case RA_EQUATION_VAR:
+                r[program[i]] = p[node->index];
+                break;
+            case RA_EQUATION_COEFF:
+                r[program[i]] = coeff[((node->index / 3) * 4 + node->index % 3) * stride];
+                break;
+            default:
+                r[program[i]] = ra_equations_apply(node->op, r[node->a],
+                    node->b >= 0 ? r[node->b] : 0.0f);
+                break;
+        }
+    }
+}
+
+/**
+ * factory_custom() at p
+ */
+void ra_equations_next(const struct AttractorEquations *equations, const float *coeff, int stride,
+    const float p[3], float n[3])
+{
+    float r[RA_EQUATIONS_MAX_NODES];
+    ra_equations_run(equations, equations->next_program, equations->next_length, coeff, stride, p,
+        r);
+
+    for (int i = 0; i < 3; i++) n[i] = r[equations->next[i]];
+}
+
+/**
+ * tangent_custom() at p, replacing v with J * v, along with factory_custom()
+ */
+void ra_equations_tangent(
+    const struct AttractorEquations *equations, const float *coeff, int stride, const float p[3],
+    float v[3], float n[3])
+{
+    float r[RA_EQUATIONS_MAX_NODES];
+    ra_equations_run(equations, equations->tangent_program, equations->tangent_length, coeff,
+        stride, p, r);
+
+    float w[3];
+    for (int row = 0; row < 3; row++)
+    {
+        n[row] = r[equations->next[row]];
+        w[row] = 0.0f;
+        for (int column = 0; column < 3; column++)
+            w[row] += r[equations->partial[row][column]] * v[column];
+    }
+    for (int i = 0; i < 3; i++) v[i] = w[i];
+}
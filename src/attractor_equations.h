@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Attractor equations written by hand, for the custom family (/equations).
+// They're read from a text file like
+//
+//     # Clifford-style map: a and b are searched, c is fixed
+//     c  = 1.5
+//     x' = sin(a*y) + c*cos(a*x)
+//     y' = sin(b*x) + c*cos(b*y)
+//     z' = sin(x*y)
+//
+// where x' is x[n+1]. Any letter from a to l that isn't given a value is a
+// coefficient, drawn and searched like those of the built-in maps (a is
+// COEFF[0].x, b is [0].y, ... l is [3].z). Any coefficient can also be
+// written as it is in mesh_cs.glsl, as COEFF[k].x, .y or .z, which is how
+// the built-in families in attractor_families.h get at all 10. Everything
+// else is folded down to constants as the file is read. Supports + - * / ^
+// (with constant exponents), unary minus, pi, and sin cos tan tanh exp log
+// sqrt abs.
+//
+// The equations and their partial derivatives, which the Lyapunov estimate
+// needs, are compiled into one straight-line program with every shared
+// subexpression computed once. The host writes it out as factory_custom()
+// and tangent_custom(), and splices those into mesh_cs.glsl before it's
+// compiled, so a custom family is as fast as a built-in one. The CPU engine
+// runs the same program, so ra_mine can try out (and mine) the equations
+// without a GPU. The built-in families are compiled the same way, but when
+// the project is configured, into both GLSL and C (see tools/ra_families.c).
+// Like the engine, this has no OpenGL dependency.
+//
+
+#define RA_EQUATIONS_MAX_NODES        (1024)
+#define RA_EQUATIONS_MAX_DEPTH        (64)     // Brackets, signs and exponents nested in each other
+#define RA_EQUATIONS_MAX_COEFFICIENTS (30)     // Every component of COEFF in mesh_cs.glsl
+#define RA_EQUATIONS_LETTERS          (12)     // a to l, all the custom family draws
+#define RA_EQUATIONS_ERROR_LENGTH     (256)
+#define RA_EQUATIONS_PRAGMA           "#pragma attractor_equations"  // MUST MATCH mesh_cs.glsl
+
+enum RA_EquationOp
+{
+    RA_EQUATION_CONST = 0,
+    RA_EQUATION_VAR,    // x, y or z (index 0 to 2)
+    RA_EQUATION_COEFF,  // COEFF[index / 3], component index % 3
+    RA_EQUATION_NEG,
+    RA_EQUATION_ADD,
+    RA_EQUATION_SUB,
+    RA_EQUATION_MUL,
+    RA_EQUATION_DIV,
+    RA_EQUATION_POW,    // Constant exponent, which isn't a small integer
+    RA_EQUATION_SIN,
+    RA_EQUATION_COS,
+    RA_EQUATION_TAN,
+    RA_EQUATION_TANH,
+    RA_EQUATION_EXP,
+    RA_EQUATION_LOG,
+    RA_EQUATION_SQRT,
+    RA_EQUATION_ABS,
+    RA_EQUATION_SIGN,   // Only ever made by differentiating abs()
+};
+
+/**
+ * One step of the program. Operands are always earlier nodes, so the nodes
+ * can be run in order.
+ */
+struct AttractorEquationNode
+{
+    int32_t op;
+    int32_t a, b;
+    int32_t index;  // Of the variable or coefficient
+    float   value;  // Of the constant
+};
+
+struct AttractorEquations
+{
+    int32_t                      node_count;
+    struct AttractorEquationNode nodes[RA_EQUATIONS_MAX_NODES];
+    // x', y' and z'
+    int32_t next[3];
+    // d next[row] / d (x, y, z)[column]
+    int32_t partial[3][3];
+    // The nodes each of ra_equations_next() and ra_equations_tangent() runs,
+    // in order, leaving out any that were folded away
+    int32_t next_program[RA_EQUATIONS_MAX_NODES];
+    int32_t next_length;
+    int32_t tangent_program[RA_EQUATIONS_MAX_NODES];
+    int32_t tangent_length;
+    // Bit i is set if coefficient i (COEFF[i / 3], component i % 3) is used
+    uint32_t coefficients;
+};
+
+bool   ra_equations_parse(struct AttractorEquations *equations, const char *source, char *error,
+    size_t error_size);
+bool   ra_equations_load(struct AttractorEquations *equations, const char *path, char *error,
+    size_t error_size);
+size_t ra_equations_glsl(const struct AttractorEquations *equations, char *glsl, size_t size);
+size_t ra_equations_glsl_kernel(const struct AttractorEquations *equations, const char *name,
+    bool flow, char *glsl, size_t size);
+size_t ra_equations_c_kernel(const struct AttractorEquations *equations, const char *name,
+    bool flow, char *c, size_t size);
+void   ra_equations_next(const struct AttractorEquations *equations, const float *coeff, int stride,
+    const float p[3], float n[3]);
+void   ra_equations_tangent(
+    const struct AttractorEquations *equations, const float *coeff, int stride, const float p[3],
+    float v[3], float n[3]);
@@ -0,0 +1,106 @@
+#pragma once
+
+//
+// Every attractor family, in ATTRACTOR_FACTORY order (the first is 1, as 0
+// is unseeded). This is the one place families are declared, update
+// equations and all. When the project is configured, tools/ra_families.c
+// compiles the equations below (see attractor_equations.h) into
+// straight-line GLSL for mesh_cs.glsl and C for the CPU engine, along with
+// the FACTORY_* constants at "#pragma attractor_families", so the two can't
+// drift apart. The CPU engine also builds its tables from the X-macros.
+//
+// FAMILY(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME)
+// - COEFFICIENTS: vec4 coefficients the family uses
+// - COMPONENTS:   components of each that are drawn (and mutated)
+// - SPREAD:       sigma of fresh Gaussian draws, or about the width of the
+//                 ranges of uniform ones
+// - DRAW:         GAUSSIAN if all 3 components of every coefficient are
+//                 drawn from PROPOSAL_*, which can be learned and mapped
+//                 by an atlas, or UNIFORM if they're drawn from the fixed
+//                 ranges in RA_UNIFORM_DRAWS
+// - TIME:         MAP if each step is one application of the map, or FLOW
+//                 if it integrates a differential equation over
+//                 FLOW_OUTPUT_STEP (see integrate_flow() in mesh_cs.glsl)
+//
+// Add new families at the end, as caches record families by number.
+//
+
+#define RA_DRAW_UNIFORM  (0)
+#define RA_DRAW_GAUSSIAN (1)
+#define RA_TIME_MAP      (0)
+#define RA_TIME_FLOW     (1)
+
+#define RA_FAMILIES(FAMILY)                         \
+    FAMILY(3D_QUADRATIC, 10, 3, 0.5, GAUSSIAN, MAP) \
+    FAMILY(2D_QUADRATIC, 6, 3, 0.5, GAUSSIAN, MAP)  \
+    FAMILY(TRIG_COUPLED, 2, 3, 2.0, GAUSSIAN, MAP)  \
+    FAMILY(LORENZ, 3, 1, 4.0, UNIFORM, FLOW)        \
+    FAMILY(CUSTOM, 4, 3, 1.0, GAUSSIAN, MAP)        \
+    FAMILY(SPROTT, 10, 3, 1.2, UNIFORM, MAP)
+
+//
+// Update equations, as RA_EQUATIONS_<NAME>, in the syntax of /equations: x'
+// is the next x of a map, or dx/dt of a flow. Families with the same
+// equations share one kernel, so they only differ in how they're drawn.
+// CUSTOM's come from /equations at run time, and it's only ever bound when
+// they're given.
+//
+
+// x[n+1] = A + Bx + Cy + Dz + Exx + Fyy + Gzz + Hxy + Ixz + Jyz, and
+// likewise for y and z with the other components of each coefficient
+#define RA_EQUATIONS_3D_QUADRATIC                                                                 \
+    "x' = (COEFF[0].x) + (COEFF[1].x*x + COEFF[2].x*y + COEFF[3].x*z)"                            \
+    " + (COEFF[4].x*x*x + COEFF[5].x*y*y + COEFF[6].x*z*z)"                                       \
+    " + (COEFF[7].x*x*y + COEFF[8].x*x*z + COEFF[9].x*y*z)\n"                                     \
+    "y' = (COEFF[0].y) + (COEFF[1].y*x + COEFF[2].y*y + COEFF[3].y*z)"                            \
+    " + (COEFF[4].y*x*x + COEFF[5].y*y*y + COEFF[6].y*z*z)"                                       \
+    " + (COEFF[7].y*x*y + COEFF[8].y*x*z + COEFF[9].y*y*z)\n"                                     \
+    "z' = (COEFF[0].z) + (COEFF[1].z*x + COEFF[2].z*y + COEFF[3].z*z)"                            \
+    " + (COEFF[4].z*x*x + COEFF[5].z*y*y + COEFF[6].z*z*z)"                                       \
+    " + (COEFF[7].z*x*y + COEFF[8].z*x*z + COEFF[9].z*y*z)\n"
+
+// x[n+1] = A + Bx + Cxx + Dxy + Ey + Fyy, which ignores z
+#define RA_EQUATIONS_2D_QUADRATIC                                                                 \
+    "x' = COEFF[0].x + COEFF[1].x*x + COEFF[2].x*x*x + COEFF[3].x*x*y + COEFF[4].x*y"             \
+    " + COEFF[5].x*y*y\n"                                                                         \
+    "y' = COEFF[0].y + COEFF[1].y*x + COEFF[2].y*x*x + COEFF[3].y*x*y + COEFF[4].y*y"             \
+    " + COEFF[5].y*y*y\n"                                                                         \
+    "z' = COEFF[0].z + COEFF[1].z*x + COEFF[2].z*x*x + COEFF[3].z*x*y + COEFF[4].z*y"             \
+    " + COEFF[5].z*y*y\n"
+
+#define RA_EQUATIONS_TRIG_COUPLED                                                                 \
+    "x' = z*sin(COEFF[0].x*y) + y*cos(COEFF[1].x*z)\n"                                            \
+    "y' = x*sin(COEFF[0].y*z) + z*cos(COEFF[1].y*x)\n"                                            \
+    "z' = y*sin(COEFF[0].z*x) + x*cos(COEFF[1].z*y)\n"
+
+#define RA_EQUATIONS_LORENZ                                                                       \
+    "x' = COEFF[0].x*(y - x)\n"                                                                   \
+    "y' = x*(COEFF[1].x - z) - y\n"                                                               \
+    "z' = x*y - COEFF[2].x*z\n"
+
+#define RA_EQUATIONS_CUSTOM NULL
+
+// Sprott's quadratic maps are the 3D quadratic map, with its coefficients
+// drawn from his 25 values (see RA_UNIFORM_DRAWS) rather than a Gaussian
+#define RA_EQUATIONS_SPROTT RA_EQUATIONS_3D_QUADRATIC
+
+//
+// How the coefficients of UNIFORM families are drawn, as rows of
+// UNIFORM(NAME, FIRST, LAST, LOW, HIGH, STEPS): each drawn component of
+// coefficients FIRST to LAST is drawn from LOW to HIGH, either evenly, or
+// from STEPS evenly spaced values if it's over 1. Each family's rows cover
+// its coefficients in order.
+//
+
+#define RA_UNIFORM_DRAWS(UNIFORM)             \
+    UNIFORM(LORENZ, 0, 0, 8.0, 12.0, 0)       \
+    UNIFORM(LORENZ, 1, 1, 24.0, 32.0, 0)      \
+    UNIFORM(LORENZ, 2, 2, 2.0, 3.5, 0)        \
+    UNIFORM(SPROTT, 0, 9, -1.2, 1.2, 25)
+
+//
+// Where orbits start, as START(NAME, LOW_X, LOW_Y, LOW_Z, HIGH_X, HIGH_Y,
+// HIGH_Z), for families that don't start within 0.5 of the origin
+//
+
+#define RA_STARTS(START) START(LORENZ, -1.0, -1.0, 0.5, 1.0, 1.0, 1.5)
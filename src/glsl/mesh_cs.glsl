@@ -1,6 +1,12 @@
 #version 460 core
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+/**
+ * The search stage runs one candidate stream per invocation, so we want lots
+ * of them. The generate stage is serial and only uses invocation 0.
+ *
+ * MUST MATCH RA_SEARCH_LOCAL_SIZE ON THE HOST!
+ */
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
 
 /**
  * The control points of the random attractor cubic bezier curve.
@@ -70,19 +76,6 @@ layout(std430, binding = 1) buffer MeshBoundingBox
     BoundingBox mesh_bounding_box;
 };
 
-void expand_bounds(vec4 expand)
-{
-    mesh_bounding_box.minimum.x = min(mesh_bounding_box.minimum.x, expand.x);
-    mesh_bounding_box.minimum.y = min(mesh_bounding_box.minimum.y, expand.y);
-    mesh_bounding_box.minimum.z = min(mesh_bounding_box.minimum.z, expand.z);
-    mesh_bounding_box.minimum.w = min(mesh_bounding_box.minimum.w, expand.w);
-
-    mesh_bounding_box.maximum.x = max(mesh_bounding_box.maximum.x, expand.x);
-    mesh_bounding_box.maximum.y = max(mesh_bounding_box.maximum.y, expand.y);
-    mesh_bounding_box.maximum.z = max(mesh_bounding_box.maximum.z, expand.z);
-    mesh_bounding_box.maximum.w = max(mesh_bounding_box.maximum.w, expand.w);
-}
-
 //                                                                                              
 //        mmmm     mmmm    mmm   mm    mmmm    mmmmmmmm     mm     mmm   mm  mmmmmmmm    mmmm   
 //      ##""""#   ##""##   ###   ##  m#""""#   """##"""    ####    ###   ##  """##"""  m#""""#  
@@ -189,16 +182,90 @@ vec4 mirrored_control_position(vec4 p1, vec4 p2)
 //                                                                
 //                                                                
 
+/**
+ * The seed of the current cycle, written by the host before every dispatch.
+ * Everything random about a cycle derives from it, so a cycle can be
+ * reproduced from its seed alone.
+ */
 layout(std430, binding = 2) buffer SeedRandom
 {
     uint srand;
 };
 
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3"), a counter-based generator: it turns a counter and a key into four
+ * random numbers, with no state carried from one call to the next.
+ */
+uvec4 philox4x32(uvec4 counter, uvec2 key)
+{
+    for (int round = 0; round < 10; round++)
+    {
+        uint hi0, lo0, hi1, lo1;
+        umulExtended(0xD2511F53u, counter.x, hi0, lo0);
+        umulExtended(0xCD9E8D57u, counter.z, hi1, lo1);
+
+        counter = uvec4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+        key += uvec2(0x9E3779B9u, 0xBB67AE85u);
+    }
+
+    return counter;
+}
+
+/**
+ * Private random stream. The n-th number of a stream is a pure function of
+ * (srand, stream, n), so invocations never fight over (or repeat) each
+ * other's numbers, a stream can jump ahead in O(1), and the CPU engine
+ * (ra_engine_next_uint) draws exactly the same numbers.
+ */
+uvec2 RNG_KEY     = uvec2(0u);
+uint  RNG_COUNTER = 0u;
+// The last block generated, which the next three numbers come from
+uvec4 RNG_BLOCK       = uvec4(0u);
+uint  RNG_BLOCK_INDEX = 0xFFFFFFFFu;
+
+/**
+ * Start (or return to) the given position of a stream.
+ */
+void seek_random_stream(uint stream, uint counter)
+{
+    RNG_KEY         = uvec2(srand, stream);
+    RNG_COUNTER     = counter;
+    RNG_BLOCK_INDEX = 0xFFFFFFFFu;
+}
+
+/**
+ * Start an independent random stream for the given stream index.
+ */
+void seed_random_stream(uint stream)
+{
+    seek_random_stream(stream, 0u);
+}
+
+/**
+ * Skip the next n numbers of the stream, without generating them.
+ */
+void skip_random(uint n)
+{
+    RNG_COUNTER += n;
+}
+
+uint next_uint()
+{
+    uint block = RNG_COUNTER >> 2u;
+    if (block != RNG_BLOCK_INDEX)
+    {
+        RNG_BLOCK       = philox4x32(uvec4(block, 0u, 0u, 0u), RNG_KEY);
+        RNG_BLOCK_INDEX = block;
+    }
+
+    return RNG_BLOCK[RNG_COUNTER++ & 3u];
+}
+
 float next_float()
 {
-    srand = srand * 747796405u + 2891336453u;
-    srand = ((srand >> ((srand >> 28u) + 4u)) ^ srand) * 277803737u;
-    return float((srand >> 22u) ^ srand) / 4294967295.0;
+    // 24 bits fill a float's mantissa exactly, so this is [0, 1)
+    return float(next_uint() >> 8u) * (1.0 / 16777216.0);
 }
 
 // Box-Muller Gaussian
@@ -226,6 +293,29 @@ float next_gaussian(float mean, float sigma)
 //                                                                                              
 //                                                                                              
 
+/**
+ * Generated by CMake from RA_FAMILIES in attractor_families.h, which is where
+ * a factory's shape is declared:
+ * - FACTORY_COUNT, and FACTORY_<NAME> for each factory's ATTRACTOR_FACTORY
+ * - FACTORY_COEFFICIENTS and FACTORY_COMPONENTS: the coefficients each
+ *   factory's seed draws, and how many components of each
+ * - FACTORY_SPREAD: the spread of each factory's fresh coefficients
+ * - FACTORY_GAUSSIAN: whether each factory draws its coefficients from
+ *   PROPOSAL_*, rather than from UNIFORM_*
+ * - FACTORY_PROPOSAL_OFFSET and PROPOSAL_LENGTH: where each factory's
+ *   coefficients are in PROPOSAL_MEAN and PROPOSAL_SIGMA
+ * - FACTORY_UNIFORM_OFFSET, UNIFORM_LENGTH, UNIFORM_LOW, UNIFORM_HIGH and
+ *   UNIFORM_STEPS: the range each uniform coefficient is drawn from, and
+ *   how many evenly spaced values it's drawn from, if over 1
+ * - FACTORY_FLOW: whether each factory integrates a flow (see Flows) rather
+ *   than stepping a map
+ * - FACTORY_START_LOW and FACTORY_START_HIGH: the box each factory's orbits
+ *   start in
+ * - COEFF_LENGTH: the most coefficients any factory has
+ * FACTORY_* arrays are indexed by ATTRACTOR_FACTORY - 1.
+ */
+#pragma attractor_families
+
 const int PREVIOUS_LENGTH = 10;
 /**
  * The 10 most recent points generated by the attractor factory, used to check
@@ -234,270 +324,238 @@ const int PREVIOUS_LENGTH = 10;
  */
 vec4 PREVIOUS[PREVIOUS_LENGTH];
 
-//
-// 3D Quadratic Polynomial Map
-// x[n+1] ​​​= A ​+ B​x + C​y + D​z + E​xx + F​yy + Gzz + H​xy + I​xz + J​yz
-// ... and cyclic permutations for Y and Z
-//
+/**
+ * The Gaussian each coefficient of the FACTORY_GAUSSIAN factories is drawn
+ * from, from FACTORY_PROPOSAL_OFFSET on. The host fits these to the
+ * attractors found so far, so draws land where attractors tend to be, but
+ * never narrows them past a floor, so every coefficient can still turn up.
+ */
+uniform vec4 PROPOSAL_MEAN[PROPOSAL_LENGTH];
+uniform vec4 PROPOSAL_SIGMA[PROPOSAL_LENGTH];
 
-vec4 COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[10];
-void seed_3d_quadratic_polynomial_map()
+vec4 next_coefficient(int k)
 {
-    for (int i = 0; i < 10; i++)
-    {
-        COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[i] = vec4(
-            next_gaussian(0.0, 0.5),
-            next_gaussian(0.0, 0.5),
-            next_gaussian(0.0, 0.5),
-            0.0
-        );
-    }
-
-    for (int i = 0; i < PREVIOUS.length(); i++)
-    {
-        PREVIOUS[i] = vec4(
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            1.0
-        );
-    }
+    return vec4(
+        next_gaussian(PROPOSAL_MEAN[k].x, PROPOSAL_SIGMA[k].x),
+        next_gaussian(PROPOSAL_MEAN[k].y, PROPOSAL_SIGMA[k].y),
+        next_gaussian(PROPOSAL_MEAN[k].z, PROPOSAL_SIGMA[k].z),
+        0.0
+    );
 }
 
-vec4 factory_3d_quadratic_polynomial_map()
-{
-    const float ax0 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[0].x;
-    const float ay0 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[0].y;
-    const float az0 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[0].z;
-
-    const float ax1 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[1].x;
-    const float ay1 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[1].y;
-    const float az1 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[1].z;
-
-    const float ax2 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[2].x;
-    const float ay2 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[2].y;
-    const float az2 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[2].z;
-
-    const float ax3 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[3].x;
-    const float ay3 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[3].y;
-    const float az3 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[3].z;
-
-    const float ax4 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[4].x;
-    const float ay4 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[4].y;
-    const float az4 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[4].z;
-
-    const float ax5 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[5].x;
-    const float ay5 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[5].y;
-    const float az5 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[5].z;
-
-    const float ax6 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[6].x;
-    const float ay6 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[6].y;
-    const float az6 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[6].z;
-
-    const float ax7 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[7].x;
-    const float ay7 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[7].y;
-    const float az7 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[7].z;
-
-    const float ax8 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[8].x;
-    const float ay8 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[8].y;
-    const float az8 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[8].z;
-
-    const float ax9 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[9].x;
-    const float ay9 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[9].y;
-    const float az9 = COEFF_3D_QUADRATIC_POLYNOMIAL_MAP[9].z;
-
-    float x = PREVIOUS[0].x;
-    float y = PREVIOUS[0].y;
-    float z = PREVIOUS[0].z;
-    float nx = (ax0) + (ax1*x + ax2*y + ax3*z) + (ax4*x*x + ax5*y*y + ax6*z*z) + (ax7*x*y + ax8*x*z + ax9*y*z);
-    float ny = (ay0) + (ay1*x + ay2*y + ay3*z) + (ay4*x*x + ay5*y*y + ay6*z*z) + (ay7*x*y + ay8*x*z + ay9*y*z);
-    float nz = (az0) + (az1*x + az2*y + az3*z) + (az4*x*x + az5*y*y + az6*z*z) + (az7*x*y + az8*x*z + az9*y*z);
+const int ATLAS_SIZE = 32;
+/** The atlas slices span this many fresh-draw sigmas either side of 0 */
+const float ATLAS_EXTENT = 3.0;
+const int ATLAS_ATTEMPTS = 16;
+/**
+ * The chaos atlas from ra_mine (see /atlas): a 2D slice through the
+ * coefficients of each factory, and how likely a fresh draw in
+ * each cell of it is to pass the suitability test, relative to the
+ * likeliest cell. Layer ATTRACTOR_FACTORY - 1 is each map's, and those of
+ * factories which don't draw from PROPOSAL_* are unused.
+ * MUST MATCH ra_engine_atlas_* IN attractor_engine.c
+ */
+uniform bool ATLAS_LOADED = false;
+/** The coefficients along each layer's u and v, each as k * 3 + component */
+uniform ivec2 ATLAS_AXES[FACTORY_COUNT];
+layout(binding = 1, r8) readonly uniform image2DArray chaos_atlas;
 
-    return vec4(nx, ny, nz, 1.0);
+int atlas_cell(float x, float spread)
+{
+    float u = x / (ATLAS_EXTENT * spread) * 0.5 + 0.5;
+    return clamp(int(floor(u * float(ATLAS_SIZE))), 0, ATLAS_SIZE - 1);
 }
 
-//
-// 2D Quadratic Polynomial Map
-// x[n+1] ​= A + B​x + C​xx + D​xy + E​y + F​y2
-// ... and cyclic permutations for Y and Z
-//
-
-vec4 COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[6];
-void seed_2d_quadratic_polynomial_map()
+/**
+ * Redraw a fresh draw's pair of atlas coefficients (PROPOSAL_* index k,
+ * component c) until the atlas accepts them, so draws land in the cells
+ * where attractors are in proportion to how likely they are to be there.
+ * Gives up after ATLAS_ATTEMPTS, so a search never stalls on the atlas.
+ */
+vec2 next_atlas_pair(int layer, ivec2 k, ivec2 c, float spread, vec2 pair)
 {
-    for (int i = 0; i < 6; i++)
+    for (int attempt = 1; attempt < ATLAS_ATTEMPTS; attempt++)
     {
-        COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[i] = vec4(
-            next_gaussian(0.0, 0.5),
-            next_gaussian(0.0, 0.5),
-            next_gaussian(0.0, 0.5),
-            0.0
-        );
-    }
+        ivec3 cell = ivec3(atlas_cell(pair.x, spread), atlas_cell(pair.y, spread), layer);
+        if (next_float() < imageLoad(chaos_atlas, cell).r) break;
 
-    for (int i = 0; i < PREVIOUS.length(); i++)
-    {
-        PREVIOUS[i] = vec4(
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            1.0
+        pair = vec2(
+            next_gaussian(PROPOSAL_MEAN[k.x][c.x], PROPOSAL_SIGMA[k.x][c.x]),
+            next_gaussian(PROPOSAL_MEAN[k.y][c.y], PROPOSAL_SIGMA[k.y][c.y])
         );
     }
-}
-
-vec4 factory_2d_quadratic_polynomial_map()
-{
-    const float ax0 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[0].x;
-    const float ay0 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[0].y;
-    const float az0 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[0].z;
-
-    const float ax1 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[1].x;
-    const float ay1 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[1].y;
-    const float az1 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[1].z;
-
-    const float ax2 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[2].x;
-    const float ay2 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[2].y;
-    const float az2 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[2].z;
-
-    const float ax3 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[3].x;
-    const float ay3 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[3].y;
-    const float az3 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[3].z;
-
-    const float ax4 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[4].x;
-    const float ay4 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[4].y;
-    const float az4 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[4].z;
-
-    const float ax5 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[5].x;
-    const float ay5 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[5].y;
-    const float az5 = COEFF_2D_QUADRATIC_POLYNOMIAL_MAP[5].z;
-
-    float x = PREVIOUS[0].x;
-    float y = PREVIOUS[0].y;
-
-    float nx = (ax0) + (ax1*x) + (ax2*x*x) + (ax3*x*y) + (ax4*y) + (ax5*y*y);
-    float ny = (ay0) + (ay1*x) + (ay2*x*x) + (ay3*x*y) + (ay4*y) + (ay5*y*y);
-    float nz = (az0) + (az1*x) + (az2*x*x) + (az3*x*y) + (az4*y) + (az5*y*y);
-
-    return vec4(nx, ny, nz, 1.0);
+    return pair;
 }
 
 //
-// Trigonometric Coupled Map
-// x[n+1] ​= z​*sin(Ay) + y*​cos(Bz)
-// ... and cyclic permutations for Y and Z
+// Factories
+//
+// Each factory's update equations are declared once, in
+// attractor_families.h, from which CMake generates straight-line
+// factory_<name>() and tangent_<name>() functions (derivative_<name>() and
+// tangent_<name>() for flows), reading the coefficients from COEFF, and
+// the dispatch between them, at the attractor_kernels pragma further down,
+// after ATTRACTOR_FACTORY. Factories with the same equations share their
+// functions, and their case of the dispatch.
 //
 
-vec4 COEFF_TRIG_COUPLED_MAP[2];
-void seed_trig_coupled_map()
-{
-    for (int i = 0; i < 2; i++)
-    {
-        COEFF_TRIG_COUPLED_MAP[i] = vec4(
-            next_gaussian(0.0, 2.0),
-            next_gaussian(0.0, 2.0),
-            next_gaussian(0.0, 2.0),
-            0.0
-        );
-    }
+/**
+ * The coefficients of the bound factory, padded with zeros.
+ * COEFF_LENGTH MUST MATCH RA_ENGINE_COEFF_LENGTH IN attractor_engine.h
+ */
+vec4 COEFF[COEFF_LENGTH];
 
-    for (int i = 0; i < PREVIOUS.length(); i++)
+/**
+ * The coefficients of a uniform factory, UNIFORM_* index k onwards. Each
+ * drawn component is drawn from UNIFORM_LOW to UNIFORM_HIGH, or from
+ * UNIFORM_STEPS evenly spaced values in that range.
+ */
+void next_uniform_coefficients(int k, int count, int components)
+{
+    for (int i = 0; i < count; i++)
     {
-        PREVIOUS[i] = vec4(
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            mix(-0.5, 0.5, next_float()),
-            1.0
-        );
+        for (int c = 0; c < components; c++)
+        {
+            float u = next_float();
+            int steps = UNIFORM_STEPS[k + i];
+            if (steps > 1) u = float(min(int(u * float(steps)), steps - 1)) / float(steps - 1);
+            COEFF[i][c] = mix(UNIFORM_LOW[k + i], UNIFORM_HIGH[k + i], u);
+        }
     }
 }
 
-vec4 factory_trig_coupled_map()
-{
-    const float ax = COEFF_TRIG_COUPLED_MAP[0].x;
-    const float ay = COEFF_TRIG_COUPLED_MAP[0].y;
-    const float az = COEFF_TRIG_COUPLED_MAP[0].z;
-
-    const float bx = COEFF_TRIG_COUPLED_MAP[1].x;
-    const float by = COEFF_TRIG_COUPLED_MAP[1].y;
-    const float bz = COEFF_TRIG_COUPLED_MAP[1].z;
-
-    float x = PREVIOUS[0].x;
-    float y = PREVIOUS[0].y;
-    float z = PREVIOUS[0].z;
-
-    float nx = z * sin(ax * y) + y * cos(bx * z);
-    float ny = x * sin(ay * z) + z * cos(by * x);
-    float nz = y * sin(az * x) + x * cos(bz * y);
-
-    return vec4(nx, ny, nz, 1.0);
-}
-
 //
-// Lorenz-Style Random Attractor
+// Flows
 //
-// dx/dt = A(y - x)
-// dy/dt = x(B - z) - y
-// dz/dt = xy - Cz
+// Continuous-time factories (FACTORY_FLOW) are sampled every FLOW_OUTPUT_STEP
+// by an embedded Dormand-Prince 5(4) integrator, whose steps adapt to keep
+// each one's error estimate under FLOW_TOLERANCE of the orbit's scale: one
+// long step on calm stretches of the orbit, several short ones on fast
+// stretches. A flow is marked FLOW in attractor_families.h, where its
+// equations give its derivative, and its factories integrate_flow() and
+// integrate_flow_tangent() with its FACTORY_<NAME>. That's a constant, so
+// the dispatch in flow_derivative() and flow_tangent() folds away.
 //
 
-vec4 COEFF_LORENZ_ATTRACTOR[3];
-void seed_lorenz()
+const float FLOW_OUTPUT_STEP = 0.05;                     // MUST MATCH attractor_engine.c
+const float FLOW_TOLERANCE   = 1e-3;                     // MUST MATCH attractor_engine.c
+const float FLOW_MIN_STEP    = FLOW_OUTPUT_STEP / 64.0;
+const int   FLOW_MAX_STEPS   = 64;                       // Tried steps, the last of which is forced
+
+// Dormand-Prince tableau, row by row. The last row of A is also the 5th
+// order weights, so the last stage is the derivative at the next point,
+// which is reused as the first stage of the step after.
+const float FLOW_A[7 * 6] = float[](
+    0.0,               0.0,               0.0,               0.0,            0.0,                0.0,
+    1.0 / 5.0,         0.0,               0.0,               0.0,            0.0,                0.0,
+    3.0 / 40.0,        9.0 / 40.0,        0.0,               0.0,            0.0,                0.0,
+    44.0 / 45.0,       -56.0 / 15.0,      32.0 / 9.0,        0.0,            0.0,                0.0,
+    19372.0 / 6561.0,  -25360.0 / 2187.0, 64448.0 / 6561.0,  -212.0 / 729.0, 0.0,                0.0,
+    9017.0 / 3168.0,   -355.0 / 33.0,     46732.0 / 5247.0,  49.0 / 176.0,   -5103.0 / 18656.0,  0.0,
+    35.0 / 384.0,      0.0,               500.0 / 1113.0,    125.0 / 192.0,  -2187.0 / 6784.0,   11.0 / 84.0
+);
+// 5th order weights less the 4th order's, for the error estimate
+const float FLOW_E[7] = float[](
+    71.0 / 57600.0, 0.0, -71.0 / 16695.0, 71.0 / 1920.0, -17253.0 / 339200.0, 22.0 / 525.0, -1.0 / 40.0
+);
+
+// The flow's derivative at p, and its Jacobian at p applied to w, which
+// are generated along with the flows' functions (see Factories)
+vec3 flow_derivative(int flow, vec3 p);
+vec3 flow_tangent(int flow, vec3 p, vec3 w);
+
+/**
+ * Integrate the flow from PREVIOUS[0] for FLOW_OUTPUT_STEP. With
+ * carry_tangent, the variational equation is integrated through the same
+ * steps, replacing v with J * v. The steps only depend on the orbit, so the
+ * next point is the same either way.
+ */
+vec4 dormand_prince(int flow, bool carry_tangent, inout vec3 v)
 {
-    float sigma = mix(8.0, 12.0, next_float());
-    float rho   = mix(24.0, 32.0, next_float());
-    float beta  = mix(2.0, 3.5, next_float());
+    vec3 p = PREVIOUS[0].xyz;
+    vec3 k[7];
+    vec3 l[7];
 
-    COEFF_LORENZ_ATTRACTOR[0] = vec4(sigma, 0.0, 0.0, 0.0);
-    COEFF_LORENZ_ATTRACTOR[1] = vec4(rho,   0.0, 0.0, 0.0);
-    COEFF_LORENZ_ATTRACTOR[2] = vec4(beta,  0.0, 0.0, 0.0);
+    k[0] = flow_derivative(flow, p);
+    if (carry_tangent) l[0] = flow_tangent(flow, p, v);
 
-    for (int i = 0; i < PREVIOUS.length(); i++)
+    // Left to integrate, which the last step takes exactly to 0
+    float remaining = FLOW_OUTPUT_STEP;
+    float h = FLOW_OUTPUT_STEP;
+    for (int step = 0; step < FLOW_MAX_STEPS && remaining > 0.0; step++)
     {
-        PREVIOUS[i] = vec4(
-            mix(-1.0, 1.0, next_float()),
-            mix(-1.0, 1.0, next_float()),
-            mix( 0.5, 1.5, next_float()),
-            1.0
-        );
+        // The last try takes whatever is left in one step, error or not, so
+        // that the orbit never falls short of FLOW_OUTPUT_STEP
+        bool last = step == FLOW_MAX_STEPS - 1;
+        h = last ? remaining : min(h, remaining);
+
+        vec3 t;
+        vec3 w;
+        for (int stage = 1; stage < 7; stage++)
+        {
+            t = p;
+            for (int j = 0; j < stage; j++) t += h * FLOW_A[stage * 6 + j] * k[j];
+            k[stage] = flow_derivative(flow, t);
+
+            if (!carry_tangent) continue;
+            w = v;
+            for (int j = 0; j < stage; j++) w += h * FLOW_A[stage * 6 + j] * l[j];
+            l[stage] = flow_tangent(flow, t, w);
+        }
+
+        // The largest error, relative to the orbit's scale
+        vec3 e = vec3(0.0);
+        for (int j = 0; j < 7; j++) e += FLOW_E[j] * k[j];
+        vec3 relative = abs(h * e) / (FLOW_TOLERANCE * (1.0 + max(abs(p), abs(t))));
+        float error = max(relative.x, max(relative.y, relative.z));
+
+        // Steps already as short as they can be are taken regardless, which
+        // bounds the work for orbits that are flying apart, and so are NaN
+        // errors, so that those orbits finish at once and fail the checks
+        if (!(error > 1.0) || h <= FLOW_MIN_STEP || last)
+        {
+            remaining -= h;
+            p = t;
+            k[0] = k[6];
+            if (carry_tangent)
+            {
+                v = w;
+                l[0] = l[6];
+            }
+        }
+
+        // error^-1/4 rather than the usual -1/5, as on the CPU
+        float factor = error > 0.0 ? clamp(0.9 / sqrt(sqrt(error)), 0.2, 5.0) : 5.0;
+        h = max(h * factor, FLOW_MIN_STEP);
     }
+
+    return vec4(p, 1.0);
 }
 
-// Single Lorenz derivative evaluation
-vec3 lorenz_eval_derivative(vec3 p)
+vec4 integrate_flow(int flow)
 {
-    const float a = COEFF_LORENZ_ATTRACTOR[0].x;
-    const float b = COEFF_LORENZ_ATTRACTOR[1].x;
-    const float c = COEFF_LORENZ_ATTRACTOR[2].x;
-
-    return vec3(
-        a * (p.y - p.x),
-        p.x * (b - p.z) - p.y,
-        p.x * p.y - c * p.z
-    );
+    vec3 v = vec3(0.0);
+    return dormand_prince(flow, false, v);
 }
 
-vec4 factory_lorenz()
+vec4 integrate_flow_tangent(int flow, inout vec3 v)
 {
-    vec3 p = PREVIOUS[0].xyz;
-
-    // Sample coursely with accurate integration
-    const float dt_eff = 0.05;
-    const int iterations = 5;
-
-    const float dt = dt_eff / iterations;
-    for (int i = 0; i < iterations; i++)
-    {
-        vec3 k1 = lorenz_eval_derivative(p);
-        vec3 k2 = lorenz_eval_derivative(p + 0.5 * dt * k1);
-        vec3 k3 = lorenz_eval_derivative(p + 0.5 * dt * k2);
-        vec3 k4 = lorenz_eval_derivative(p + dt * k3);
+    return dormand_prince(flow, true, v);
+}
 
-        p += (dt / 6.0) * (k1 + 2.0*k2 + 2.0*k3 + k4);
-    }
+//
+// Custom Equations
+// x[n+1] = x' from /equations on the host
+// ... and likewise for Y and Z
+//
 
-    return vec4(p, 1.0);
-}
+/**
+ * factory_custom(), and tangent_custom(v), its Jacobian at PREVIOUS[0]
+ * applied to v. The host compiles them from the equations into straight-line
+ * code, and splices them in here before this shader is compiled, see
+ * attractor_equations.c.
+ */
+#pragma attractor_equations
 
 //                                                                                              
 //        mm     mmmmmmmm  mmmmmmmm  mmmmmm       mm        mmmm   mmmmmmmm    mmmm    mmmmmm   
@@ -515,190 +573,623 @@ vec4 factory_lorenz()
  *  2: 2D Quadratic Polynomial Map
  *  3: Trigonometric Coupled Map
  *  4: Lorenz
- *  5: Sprott
+ *  5: Custom equations
+ *  6: Sprott's quadratic maps
  */
 int ATTRACTOR_FACTORY = 0;
 
+/** Factory steps (with or without a tangent) since the last seed_attractor_factory() */
+uint FACTORY_STEPS = 0u;
+
+/** If set (/family on the host), every candidate uses this factory */
+uniform int FORCE_ATTRACTOR_FACTORY = 0;
+
+/**
+ * Relative chance of binding each factory (indexed by ATTRACTOR_FACTORY - 1).
+ * A weight of 0 disables that factory. The host scales these by how many
+ * steps each factory spends per suitable candidate (see FactoryStats), so
+ * that factories which rarely pass don't take over the search.
+ */
+uniform float FACTORY_WEIGHTS[FACTORY_COUNT];
+
 void bind_attractor_factory()
 {
     float f = next_float();
 
-    // x%
-    if (f <= 1.0) ATTRACTOR_FACTORY = 1;
-    // y%
-    else if (f < 1.0) ATTRACTOR_FACTORY = 1;
-    // y%
-    else if (f < 1.0) ATTRACTOR_FACTORY = 1;
-    // y%
-    else if (f < 1.0) ATTRACTOR_FACTORY = 1;
-    // y%
-    else if (f < 1.0) ATTRACTOR_FACTORY = 1;
-    // 
-    else ATTRACTOR_FACTORY = 1;
+    // Still draw f, so forcing doesn't shift the rest of the stream
+    if (FORCE_ATTRACTOR_FACTORY > 0)
+    {
+        ATTRACTOR_FACTORY = FORCE_ATTRACTOR_FACTORY;
+        return;
+    }
+
+    float total = 0.0;
+    for (int i = 0; i < FACTORY_COUNT; i++) total += max(FACTORY_WEIGHTS[i], 0.0);
+
+    // Rounding can leave a little of f * total over, which goes to the last
+    // enabled factory rather than a disabled one
+    ATTRACTOR_FACTORY = 0;
+    float remaining = f * total;
+    for (int i = 0; i < FACTORY_COUNT; i++)
+    {
+        if (FACTORY_WEIGHTS[i] <= 0.0) continue;
+
+        ATTRACTOR_FACTORY = i + 1;
+        remaining -= FACTORY_WEIGHTS[i];
+        if (remaining < 0.0) break;
+    }
+
+    // Every factory disabled
+    if (ATTRACTOR_FACTORY == 0) ATTRACTOR_FACTORY = 1;
 }
 
+/**
+ * Every factory's functions but the custom one's, generated from
+ * attractor_families.h, and factory_next() and factory_tangent_next(), which
+ * step the bound factory (see Factories)
+ */
+#pragma attractor_kernels
+
+/**
+ * Draw the bound factory's coefficients, from PROPOSAL_* (and the atlas),
+ * or UNIFORM_*, and the points its orbit starts from
+ */
 void seed_attractor_factory()
 {
     float f = next_float();
+    FACTORY_STEPS = 0u;
 
-    // Reset the PREVIOUS buffer in case it's corrupted
-    // Should be reset by the seed function anyway
-    for (int i = 0; i < PREVIOUS.length(); i++)
+    if (ATTRACTOR_FACTORY < 1 || ATTRACTOR_FACTORY > FACTORY_COUNT)
     {
-        PREVIOUS[i] = vec4(0);
+        ATTRACTOR_FACTORY = FACTORY_3D_QUADRATIC;
     }
+    int factory = ATTRACTOR_FACTORY - 1;
 
-    switch(ATTRACTOR_FACTORY)
+    for (int i = 0; i < COEFF.length(); i++)
     {
-        default:
-        case 1:
-            seed_3d_quadratic_polynomial_map();
-            break;
-        case 2:
-            seed_2d_quadratic_polynomial_map();
-            break;
-        case 3:
-            seed_trig_coupled_map();
-            break;
-        case 4:
-            seed_lorenz();
-            break;
+        COEFF[i] = vec4(0);
     }
-}
 
-vec4 attractor_factory_next(bool store)
-{
-    vec4 p;
+    if (FACTORY_GAUSSIAN[factory])
+    {
+        for (int i = 0; i < FACTORY_COEFFICIENTS[factory]; i++)
+        {
+            COEFF[i] = next_coefficient(FACTORY_PROPOSAL_OFFSET[factory] + i);
+        }
 
-    switch(ATTRACTOR_FACTORY)
+        if (ATLAS_LOADED)
+        {
+            ivec2 k = ATLAS_AXES[factory] / 3;
+            ivec2 c = ATLAS_AXES[factory] % 3;
+            vec2 pair = vec2(COEFF[k.x][c.x], COEFF[k.y][c.y]);
+            pair = next_atlas_pair(factory, ivec2(FACTORY_PROPOSAL_OFFSET[factory]) + k, c, FACTORY_SPREAD[factory], pair);
+            COEFF[k.x][c.x] = pair.x;
+            COEFF[k.y][c.y] = pair.y;
+        }
+    }
+    else
     {
-        default:
-        case 1:
-            p = factory_3d_quadratic_polynomial_map();
-            break;
-        case 2:
-            p = factory_2d_quadratic_polynomial_map();
-            break;
-        case 3:
-            p = factory_trig_coupled_map();
-            break;
-        case 4:
-            p = factory_lorenz();
-            break;
+        next_uniform_coefficients(FACTORY_UNIFORM_OFFSET[factory], FACTORY_COEFFICIENTS[factory], FACTORY_COMPONENTS[factory]);
     }
 
-    if (store)
+    vec3 low = FACTORY_START_LOW[factory];
+    vec3 high = FACTORY_START_HIGH[factory];
+    for (int i = 0; i < PREVIOUS.length(); i++)
     {
-        // Shift the previous points back by one, and add the new point to the front
-        for (int i = PREVIOUS.length() - 1; i > 0; i--)
-        {
-            PREVIOUS[i] = PREVIOUS[i-1];
-        }
-        PREVIOUS[0] = p;
+        PREVIOUS[i] = vec4(
+            mix(low.x, high.x, next_float()),
+            mix(low.y, high.y, next_float()),
+            mix(low.z, high.z, next_float()),
+            1.0
+        );
+    }
+}
+
+/**
+ * Shift the previous points back by one, and add the new point to the front
+ */
+void push_previous(vec4 p)
+{
+    for (int i = PREVIOUS.length() - 1; i > 0; i--)
+    {
+        PREVIOUS[i] = PREVIOUS[i-1];
     }
+    PREVIOUS[0] = p;
+}
+
+vec4 attractor_factory_next(bool store)
+{
+    FACTORY_STEPS++;
+    vec4 p = factory_next();
+
+    if (store) push_previous(p);
+
+    return p;
+}
+
+/**
+ * Like attractor_factory_next(true), but also carries a tangent vector
+ * through the step, replacing it with J * tangent, where J is the
+ * factory's Jacobian at PREVIOUS[0]. This stands in for a shadow orbit
+ * an infinitesimal distance away, at the cost of one factory step, not two.
+ */
+vec4 attractor_factory_tangent_next(inout vec3 tangent)
+{
+    FACTORY_STEPS++;
+    vec4 p = factory_tangent_next(tangent);
+
+    push_previous(p);
 
     return p;
 }
 
+/** Newton steps has_attracting_fixed_point() takes */
+const int NEWTON_STEPS = 8;
+/** How close F(x) must be to x, relative to x, for x to be a fixed point */
+const float FIXED_POINT_TOLERANCE = 1e-4;
+/** A fixed point attracts if |J^16| is below this */
+const float FIXED_POINT_CONTRACTION = 0.5;
+
 /**
- * Using the attractor factory seeded in 
+ * The bound factory's Jacobian at p, found one column at a time by carrying
+ * each axis through the tangent step, along with the factory's next point.
  */
-bool seeded_attractor_is_suitable()
+mat3 factory_jacobian(vec3 p, out vec3 next)
 {
-    // Skip the first 1000 points to let behaviour emerge
-    // PREVIOUS is now filled with 100 values
-    for (int i = 0; i < 1000; i++)
+    vec4 previous = PREVIOUS[0];
+    PREVIOUS[0] = vec4(p, 1.0);
+    FACTORY_STEPS++;
+
+    mat3 j = mat3(1.0);
+    for (int column = 0; column < 3; column++)
     {
-        attractor_factory_next(true);
+        next = factory_tangent_next(j[column]).xyz;
     }
 
-    // Perturbing factory for Lyapunov calculation
-    // Random 4D direction, normalised, and scaled to be a small perturbation
-    const vec4 D0 = 0.00005 * normalize(
-        vec4(
-            mix(-1, +1, next_float()),
-            mix(-1, +1, next_float()),
-            mix(-1, +1, next_float()),
-            mix(-1, +1, next_float())
-        )
-    );
+    PREVIOUS[0] = previous;
+    return j;
+}
 
-    /** Lyapunov exponent to quanify chaos */
-    float lyapunov = 0;
-    /** Covariance tracker for estimating Eigenvalues */
-    mat3 cov = mat3(0);
-    vec3 mean = vec3(0);
-    int n_cov = 0;
+/**
+ * Newton's method from PREVIOUS[0] for a fixed point of the map, then
+ * whether the Jacobian there is a contraction. If |J^16| is small enough,
+ * every Eigenvalue is well inside the unit circle, so the orbit would
+ * settle on the point, and only be rejected by newest_point_is_sane()
+ * after the whole warm-up.
+ */
+bool has_attracting_fixed_point()
+{
+    // A flow's fixed points are the flow's, whose Eigenvalues say nothing
+    // about one step of the map
+    if (FACTORY_FLOW[ATTRACTOR_FACTORY - 1]) return false;
 
-    // We check the next 10000 points to:
-    // - Check the series doesn't explode to infinity
-    // - Check the series doesn't tend to a point
-    // - Check the series' Lyapunov exponent is positive
-    const int ITERATIONS = 10000;
-    for (int i = 0; i < ITERATIONS; i++)
-    {
-        //
-        // Calculate the parallel path
-        // (1) Perturb the previous points in-place
-        // (2) Calculate the next point the parallel path, without shuffing the PREVIOUS buffer
-        // (3) Un-perturb the previous points 
-        // (4) Calculate the next point of the original path, which *will* shuffle the PREVIOUS buffer
-        //
-        for (int i = 0; i < PREVIOUS.length(); i++) PREVIOUS[i] += D0;
-        vec4 xe = attractor_factory_next(false);
-        for (int i = 0; i < PREVIOUS.length(); i++) PREVIOUS[i] -= D0;
-        vec4 x = attractor_factory_next(true);
+    vec3 x = PREVIOUS[0].xyz;
+    vec3 next;
+    mat3 j;
 
-        //
-        // Check for irrationalities
-        //
+    for (int i = 0; i < NEWTON_STEPS; i++)
+    {
+        j = factory_jacobian(x, next);
+
+        // Solve (J - I) d = x - F(x) by Cramer's rule
+        mat3 a = j - mat3(1.0);
+        vec3 c12 = cross(a[1], a[2]);
+        vec3 c20 = cross(a[2], a[0]);
+        vec3 c01 = cross(a[0], a[1]);
+        float det = dot(a[0], c12);
+        if (!(abs(det) > 1e-12)) return false;
+
+        vec3 r = x - next;
+        x += vec3(dot(c12, r), dot(c20, r), dot(c01, r)) / det;
         if (any(isnan(x)) || any(isinf(x))) return false;
-        if (any(isnan(xe)) || any(isinf(xe))) return false;
+    }
 
-        //
-        // Accumulate data for eigenvlaue estimation
-        //
-        vec3 dMean = PREVIOUS[0].xyz - mean;
-        mean += dMean / float(n_cov + 1);
-        //
-        cov[0][0] += dMean.x * (PREVIOUS[0].x - mean.x);
-        cov[0][1] += dMean.x * (PREVIOUS[0].y - mean.y);
-        cov[0][2] += dMean.x * (PREVIOUS[0].z - mean.z);
-        //
-        cov[1][0] += dMean.y * (PREVIOUS[0].x - mean.x);
-        cov[1][1] += dMean.y * (PREVIOUS[0].y - mean.y);
-        cov[1][2] += dMean.y * (PREVIOUS[0].z - mean.z);
-        //
-        cov[2][0] += dMean.z * (PREVIOUS[0].x - mean.x);
-        cov[2][1] += dMean.z * (PREVIOUS[0].y - mean.y);
-        cov[2][2] += dMean.z * (PREVIOUS[0].z - mean.z);
-        //
-        n_cov++;
+    j = factory_jacobian(x, next);
 
-        //
-        // Calculate the Lyapunov exponent contribution from this step
-        //
-        float dd = distance(xe, PREVIOUS[0]);
-        float d0 = length(D0);
-        lyapunov += log( abs(dd/d0) ) / float(ITERATIONS);
+    // Out of reach of the bounds checks, or not a fixed point after all
+    if (!all(lessThanEqual(abs(x), vec3(1e3)))) return false;
+    if (!all(lessThanEqual(abs(next - x), FIXED_POINT_TOLERANCE * (1.0 + abs(x))))) return false;
 
-        //
-        // If the bounds explode, also unsuitable
-        //
-        if (PREVIOUS[0].x < -1e3 || +1e3 < PREVIOUS[0].x) return false;
-        if (PREVIOUS[0].y < -1e3 || +1e3 < PREVIOUS[0].y) return false;
-        if (PREVIOUS[0].z < -1e3 || +1e3 < PREVIOUS[0].z) return false;
-        if (PREVIOUS[0].w < -1e3 || +1e3 < PREVIOUS[0].w) return false;
+    // J^16, by squaring
+    for (int i = 0; i < 4; i++) j = j * j;
 
-        //
-        // If this tends to a point, also unsuitable
-        //
-        float dx = PREVIOUS[0].x - PREVIOUS[1].x;
-        float dy = PREVIOUS[0].y - PREVIOUS[1].y;
-        float dz = PREVIOUS[0].z - PREVIOUS[1].z;
-        float dw = PREVIOUS[0].w - PREVIOUS[1].w;
-        if (abs(dx) < 1e-6 && abs(dy) < 1e-6 && abs(dz) < 1e-6 && abs(dw) < 1e-6) return false;
-    }
+    float norm = sqrt(dot(j[0], j[0]) + dot(j[1], j[1]) + dot(j[2], j[2]));
+    return norm < FIXED_POINT_CONTRACTION;
+}
+
+//
+// Suitability is tested in stages of increasing cost, so that most bad seeds
+// are thrown away long before the expensive covariance test:
+//
+// (0) Warm-up: let behaviour emerge, no checks at all, unless Newton's
+//     method finds an attracting fixed point first, in which case there's
+//     no behaviour to wait for. Ends early once the orbit has settled,
+//     see warmup_has_settled()
+// (1) Divergence probe: plain steps, checking for NaN/Inf, explosions,
+//     collapse to a point, and (from here on) cycles
+// (2) Lyapunov probe: a short, noisy Lyapunov estimate, which rejects
+//     anything that clearly isn't chaotic
+// (3) Full test: the Lyapunov estimate plus covariance/anisotropy, which
+//     stops as soon as the Lyapunov estimate has converged
+//
+// Both Lyapunov estimates use Benettin's method with a tangent vector
+// carried through each factory's analytic Jacobian, see renormalised_step().
+//
+// Every budget is set by the host (see struct AttractorSearchParams).
+//
+
+/** Stage 0 budget, if the orbit never settles */
+uniform int WARMUP_ITERATIONS = 1000;
+/** Stage 0 checks whether the orbit has settled this often. Set to 0 to always use the whole budget. */
+uniform int WARMUP_WINDOW = 100;
+/** Settled: the bounding box moves less than this (relative to its size) over a window */
+uniform float WARMUP_TOLERANCE = 0.1;
+/** Stage 1 budget */
+uniform int PROBE_ITERATIONS = 200;
+/** Stage 2 budget. Set to 0 to skip stage 2 entirely. */
+uniform int LYAPUNOV_PROBE_ITERATIONS = 500;
+/** Stage 2 rejects anything with a shorter-term Lyapunov exponent below this */
+uniform float PROBE_MIN_LYAPUNOV = 0.0;
+/** Stage 3 budget, if the Lyapunov estimate never converges */
+uniform int TEST_ITERATIONS = 10000;
+/** Stage 3 checks whether the Lyapunov estimate has converged this often */
+uniform int LYAPUNOV_WINDOW = 250;
+/** Stop: converged once the estimate moves less than this over a window */
+uniform float LYAPUNOV_TOLERANCE = 0.005;
+/** Continue: never stop while the estimate is this close to MIN_LYAPUNOV */
+uniform float LYAPUNOV_MARGIN = 0.01;
+
+/** What stage 3 measured for the last candidate to reach the end of it */
+float SEEDED_LYAPUNOV = 0.0;
+float SEEDED_ANISOTROPY = 0.0;
+/** How good it looks, see attractor_score() */
+float SEEDED_SCORE = 0.0;
+/** How much of its bounding box's area on screen it covers, see coverage_ratio() */
+float SEEDED_COVERAGE = 0.0;
+/** Its correlation dimension, measured by the dimension pass */
+float SEEDED_DIMENSION = 0.0;
+/** Stage 0 iterations before its orbit settled */
+int SEEDED_WARMUP = 0;
+/** The parent it was mutated from, or -1 for a fresh draw */
+int SEEDED_PARENT = -1;
+
+/** Stage 3 rejects anything with a Lyapunov exponent below this */
+const float MIN_LYAPUNOV = 0.001;
+/** Stage 3 rejects anything more anisotropic than this */
+const float MAX_ANISOTROPY = 0.75;
+/**
+ * Stage 3 rejects anything with a coverage_ratio() below this, which is set
+ * by the host. 0 skips the coverage test entirely.
+ */
+uniform float MIN_COVERAGE = 0.1;
+/** Side of the image stage 3 splats its orbit into. MUST MATCH THE HOST! */
+const int COVERAGE_RESOLUTION = 128;
+/**
+ * The dimension pass rejects anything with a correlation dimension below
+ * this, which is set by the host. Dust and the odd point the orbit cycles
+ * between measure close to 0, curves close to 1. 0 skips the pass.
+ */
+uniform float MIN_DIMENSION = 1.0;
+
+/**
+ * The checks shared by every stage:
+ * - Check the series doesn't explode to infinity
+ * - Check the series doesn't tend to a point
+ */
+bool newest_point_is_sane()
+{
+    //
+    // Check for irrationalities
+    //
+    if (any(isnan(PREVIOUS[0])) || any(isinf(PREVIOUS[0]))) return false;
+
+    //
+    // If the bounds explode, also unsuitable
+    //
+    if (PREVIOUS[0].x < -1e3 || +1e3 < PREVIOUS[0].x) return false;
+    if (PREVIOUS[0].y < -1e3 || +1e3 < PREVIOUS[0].y) return false;
+    if (PREVIOUS[0].z < -1e3 || +1e3 < PREVIOUS[0].z) return false;
+    if (PREVIOUS[0].w < -1e3 || +1e3 < PREVIOUS[0].w) return false;
+
+    //
+    // If this tends to a point, also unsuitable
+    //
+    float dx = PREVIOUS[0].x - PREVIOUS[1].x;
+    float dy = PREVIOUS[0].y - PREVIOUS[1].y;
+    float dz = PREVIOUS[0].z - PREVIOUS[1].z;
+    float dw = PREVIOUS[0].w - PREVIOUS[1].w;
+    if (abs(dx) < 1e-6 && abs(dy) < 1e-6 && abs(dz) < 1e-6 && abs(dw) < 1e-6) return false;
+
+    return true;
+}
+
+/** Direction the orbit is being stretched along, always unit length */
+vec3 TANGENT = vec3(0);
+
+/**
+ * One step of Benettin's method: step the orbit, see how far the Jacobian
+ * stretched the tangent, then renormalise it. The tangent is the limit of
+ * a shadow orbit as its distance goes to zero, so unlike a real shadow it
+ * never saturates at the size of the attractor.
+ *
+ * @returns log of the stretch, which averages to the Lyapunov exponent. Not
+ *          finite if the tangent broke (or collapsed to nothing).
+ */
+float renormalised_step()
+{
+    vec3 v = TANGENT;
+    attractor_factory_tangent_next(v);
+
+    float stretch = length(v);
+    TANGENT = v / stretch;
+    return log(stretch);
+}
+
+/**
+ * Check the running Lyapunov estimate every LYAPUNOV_WINDOW iterations.
+ * It has converged once it moved less than LYAPUNOV_TOLERANCE since the
+ * last window, but carry on anyway if it's too close to MIN_LYAPUNOV to
+ * call.
+ */
+bool lyapunov_has_converged(float lyapunov_sum, int n, inout float window_lyapunov)
+{
+    if (LYAPUNOV_WINDOW <= 0 || n % LYAPUNOV_WINDOW != 0) return false;
+
+    float estimate = lyapunov_sum / float(n);
+    bool converged = n >= 2 * LYAPUNOV_WINDOW && abs(estimate - window_lyapunov) < LYAPUNOV_TOLERANCE;
+    bool decisive = abs(estimate - MIN_LYAPUNOV) > LYAPUNOV_MARGIN;
+
+    window_lyapunov = estimate;
+    return converged && decisive;
+}
+//
+// The test can be paused after any iteration and resumed later (even by a
+// later dispatch, see SearchState), so everything it has measured so far
+// lives in these globals rather than in locals.
+//
+
+/** How far the candidate has got through the test */
+int TEST_STAGE = 0;
+const int TEST_WARMUP          = 0;
+const int TEST_PROBE           = 1;
+const int TEST_LYAPUNOV_PROBE  = 2;
+const int TEST_FULL            = 3;
+const int TEST_SUITABLE        = 4;
+const int TEST_UNSUITABLE      = 5;
+/** Never tested, because its factory had reached its cap */
+const int TEST_SKIPPED         = 6;
+/** Passed everything else, and waiting for the dimension pass (see dimension_pass()) */
+const int TEST_DIMENSION       = 7;
+/** Given up on undecided, see abandon_candidate() */
+const int TEST_ABANDONED       = 8;
+
+/** Iterations so far in TEST_STAGE */
+int TEST_ITERATION = 0;
+/** Sum of the stretches in stage 2 or 3 */
+float TEST_LYAPUNOV = 0.0;
+/** Stage 3 estimate at the end of the last window */
+float TEST_WINDOW_LYAPUNOV = 0.0;
+/** Stage 3 covariance tracker for estimating Eigenvalues */
+mat3 TEST_COV = mat3(0);
+vec3 TEST_MEAN = vec3(0);
+/**
+ * Bounding box of stages 1 and 2, which stage 3's occupancy is measured in.
+ * Stage 0 uses it for the current window.
+ */
+vec3 TEST_MINIMUM = vec3(1e10);
+vec3 TEST_MAXIMUM = vec3(-1e10);
+/** Bounding box of stage 0's previous window */
+vec3 TEST_SETTLE_MINIMUM = vec3(1e10);
+vec3 TEST_SETTLE_MAXIMUM = vec3(-1e10);
+/** Which cells of a 4x4x4 grid over that box stage 3 has visited, one bit each */
+uvec2 TEST_OCCUPANCY = uvec2(0u);
+/**
+ * Brent's cycle detection, from the start of stage 1: the point the orbit
+ * is compared against, which moves up to the newest point every time
+ * TEST_CYCLE_LENGTH reaches TEST_CYCLE_POWER, which then doubles. A cycle
+ * of period p is caught within about 2p steps of the orbit settling on it.
+ */
+vec3 TEST_CYCLE_POINT = vec3(0);
+int TEST_CYCLE_POWER = 1;
+int TEST_CYCLE_LENGTH = 0;
+/** Where that box lands on screen (minimum in xy, maximum in zw) */
+vec4 TEST_WINDOW = vec4(0);
+/** Pixels of the coverage image stage 3 has lit */
+uint TEST_COVERAGE = 0u;
+
+void expand_test_box(vec3 p)
+{
+    TEST_MINIMUM = min(TEST_MINIMUM, p);
+    TEST_MAXIMUM = max(TEST_MAXIMUM, p);
+}
+
+void occupy_test_cell(vec3 p)
+{
+    // Points outside the box count towards the cells on its edge
+    ivec3 cell = clamp(ivec3(4.0 * (p - TEST_MINIMUM) / max(TEST_MAXIMUM - TEST_MINIMUM, 1e-6)), 0, 3);
+    int bit = cell.x + 4 * cell.y + 16 * cell.z;
+    TEST_OCCUPANCY[bit / 32] |= 1u << uint(bit % 32);
+}
+
+/** Clear and light pixels of this invocation's coverage image, defined with the search */
+void clear_coverage_image();
+bool cover_pixel(ivec2 pixel);
+
+/**
+ * Where a point would land on screen at the start of a cycle, in normalised
+ * device coordinates: scaled into the stage 1 and 2 bounding box as
+ * mesh_vs.glsl does with the mesh's, then seen from the camera pitch in
+ * mesh_tes.glsl, before the camera has started to turn.
+ * MUST MATCH mesh_vs.glsl AND mesh_tes.glsl!
+ */
+vec2 project_to_screen(vec3 p)
+{
+    vec3 extent = max(TEST_MAXIMUM - TEST_MINIMUM, vec3(0.0));
+    float normal_scale = max(max(extent.x, max(extent.y, extent.z)), 1e-6);
+    float up_scale = 1.5;
+    vec3 mesh = (p - TEST_MINIMUM - 0.5 * extent) * (up_scale / normal_scale) + vec3(0.0, 0.5 * up_scale, 0.0);
+
+    // x_rotation(PITCH_RADS), then translate(vec3(0.0, 0.0, -2))
+    float pitch = 6.2831853 * 0.125;
+    float c = cos(pitch);
+    float s = sin(pitch);
+    vec3 view = vec3(mesh.x, c * mesh.y - s * mesh.z, s * mesh.y + c * mesh.z - 2.0);
+
+    // perspective(FOV_RADS, ASPECT_RATIO, ...), where a quarter turn FOV is f = 1
+    float aspect = 1.7777;
+    return vec2(view.x / aspect, view.y) / max(-view.z, 1e-6);
+}
+
+/**
+ * Side of the grid stage 3 splats into, in pixels of the coverage image.
+ * Sized so that even the fewest points the test can stop after (two
+ * Lyapunov windows, see lyapunov_has_converged()) land about twice in each
+ * cell of a box they fill evenly, so coverage_ratio() measures the area,
+ * not how many points there were.
+ */
+int coverage_side()
+{
+    int points = LYAPUNOV_WINDOW > 0 ? min(2 * LYAPUNOV_WINDOW, TEST_ITERATIONS) : TEST_ITERATIONS;
+    return clamp(int(sqrt(float(points) / 2.0)), 8, COVERAGE_RESOLUTION);
+}
+
+/**
+ * Start stage 3's coverage test: fit the coverage grid to where the
+ * bounding box lands on screen, and clear it.
+ */
+void begin_coverage_test()
+{
+    if (MIN_COVERAGE <= 0.0) return;
+
+    vec2 corner = project_to_screen(TEST_MINIMUM);
+    TEST_WINDOW = vec4(corner, corner);
+    for (int i = 1; i < 8; i++)
+    {
+        vec3 p = mix(TEST_MINIMUM, TEST_MAXIMUM, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        corner = project_to_screen(p);
+        TEST_WINDOW = vec4(min(TEST_WINDOW.xy, corner), max(TEST_WINDOW.zw, corner));
+    }
+
+    TEST_COVERAGE = 0u;
+    clear_coverage_image();
+}
+
+/**
+ * Splat a stage 3 point into the coverage image. The orbit is inside the
+ * box, so its projection is inside the window, except for the odd point
+ * which wanders out, which counts towards the pixel on the edge.
+ */
+void cover_screen_point(vec3 p)
+{
+    if (MIN_COVERAGE <= 0.0) return;
+
+    vec2 uv = (project_to_screen(p) - TEST_WINDOW.xy) / max(TEST_WINDOW.zw - TEST_WINDOW.xy, vec2(1e-6));
+    int side = coverage_side();
+    ivec2 pixel = clamp(ivec2(uv * float(side)), 0, side - 1);
+    if (cover_pixel(pixel)) TEST_COVERAGE++;
+}
+
+/**
+ * The share of the coverage grid which stage 3's points lit, which is the
+ * share of the bounding box's area on screen that the attractor covers.
+ * Thin clumps and curves light a cell or two across, and score close to
+ * 0, however well they fill the 4x4x4 grid or spread their points out.
+ */
+float coverage_ratio()
+{
+    int side = coverage_side();
+    return float(TEST_COVERAGE) / float(side * side);
+}
+
+/**
+ * Higher is better looking. Each term is roughly 0 to 1:
+ * - Chaos: saturates, so wildly chaotic noise earns no more than an
+ *   attractor which is clearly chaotic
+ * - Anisotropy: from MAX_ANISOTROPY (flat) to 1/3 (evenly 3D)
+ * - Spread: RMS distance from the mean, relative to the bounding box. A
+ *   few outliers stretch the box and squash everything else into a blob
+ * - Fill: how many cells of the grid over the box the orbit visits
+ */
+float attractor_score(float lyapunov, float anisotropy, float trace_cov)
+{
+    float chaos = 1.0 - exp(-max(lyapunov, 0.0) / 0.25);
+    float flatness = clamp((MAX_ANISOTROPY - anisotropy) / (MAX_ANISOTROPY - 1.0 / 3.0), 0.0, 1.0);
+
+    // An evenly filled box scores 1
+    float diagonal = length(max(TEST_MAXIMUM - TEST_MINIMUM, vec3(0.0)));
+    float spread = clamp(2.0 * sqrt(3.0) * sqrt(max(trace_cov, 0.0)) / max(diagonal, 1e-6), 0.0, 1.0);
+
+    float fill = float(bitCount(TEST_OCCUPANCY.x) + bitCount(TEST_OCCUPANCY.y)) / 64.0;
+
+    return chaos + flatness + spread + fill;
+}
+
+void begin_cycle_detection()
+{
+    TEST_CYCLE_POINT = PREVIOUS[0].xyz;
+    TEST_CYCLE_POWER = 1;
+    TEST_CYCLE_LENGTH = 0;
+}
+
+/**
+ * Check whether the orbit has come back to TEST_CYCLE_POINT, as closely as
+ * newest_point_is_sane() checks consecutive points, which is the same
+ * thing for a cycle of period 1. Only one comparison per step, however
+ * long the cycle.
+ */
+bool orbit_is_periodic()
+{
+    bool periodic = all(lessThan(abs(PREVIOUS[0].xyz - TEST_CYCLE_POINT), vec3(1e-6)));
+
+    if (++TEST_CYCLE_LENGTH == TEST_CYCLE_POWER)
+    {
+        TEST_CYCLE_POINT = PREVIOUS[0].xyz;
+        TEST_CYCLE_POWER *= 2;
+        TEST_CYCLE_LENGTH = 0;
+    }
+
+    return periodic;
+}
+
+void begin_suitability_test()
+{
+    TEST_STAGE = TEST_WARMUP;
+    TEST_ITERATION = 0;
+    TEST_LYAPUNOV = 0.0;
+    TEST_WINDOW_LYAPUNOV = 0.0;
+    TEST_COV = mat3(0);
+    TEST_MEAN = vec3(0);
+    TEST_MINIMUM = vec3(1e10);
+    TEST_MAXIMUM = vec3(-1e10);
+    TEST_SETTLE_MINIMUM = vec3(1e10);
+    TEST_SETTLE_MAXIMUM = vec3(-1e10);
+    TEST_OCCUPANCY = uvec2(0u);
+    TEST_WINDOW = vec4(0);
+    TEST_COVERAGE = 0u;
+    SEEDED_DIMENSION = 0.0;
+    SEEDED_WARMUP = 0;
+}
+
+void begin_test_stage(int stage)
+{
+    TEST_STAGE = stage;
+    TEST_ITERATION = 0;
+    TEST_LYAPUNOV = 0.0;
+}
+
+bool fail_suitability_test()
+{
+    TEST_STAGE = TEST_UNSUITABLE;
+    return true;
+}
+
+/**
+ * Stage 3 has finished: measure the anisotropy and make the final decision.
+ */
+void finish_suitability_test()
+{
+    int n_cov = TEST_ITERATION;
+    float lyapunov = TEST_LYAPUNOV / float(max(n_cov, 1));
 
     //
     // (1) Normalise the covarariance
@@ -708,7 +1199,7 @@ bool seeded_attractor_is_suitable()
     // (5) Estimate the anisotropy of the attractor
     // (6) Reject isotropic attractors which form boring lines
     //
-    cov /= float(n_cov);
+    mat3 cov = TEST_COV / float(n_cov);
     //
     vec3 v = normalize(vec3(1.0, 0.7, 0.3));
     for (int i = 0; i < 8; i++) v = normalize(cov * v);
@@ -719,32 +1210,947 @@ bool seeded_attractor_is_suitable()
     //
     float anisotropy = lambda1 / (trace_cov + 1e-6);
     //
-    if (anisotropy > 0.75) return false;
+    SEEDED_LYAPUNOV = lyapunov;
+    SEEDED_ANISOTROPY = anisotropy;
+    SEEDED_SCORE = attractor_score(lyapunov, anisotropy, trace_cov);
+    SEEDED_COVERAGE = MIN_COVERAGE > 0.0 ? coverage_ratio() : 0.0;
+    //
+    TEST_STAGE = TEST_UNSUITABLE;
+    if (anisotropy > MAX_ANISOTROPY) return;
 
     //
     // If Lyapunov exponent is small or negative, also unsuitable
     //
-    if (lyapunov < 0.001) return false;
+    if (lyapunov < MIN_LYAPUNOV) return;
+
+    //
+    // If it would be a thin clump on screen, also unsuitable
+    //
+    if (MIN_COVERAGE > 0.0 && SEEDED_COVERAGE < MIN_COVERAGE) return;
 
     //
-    // YAY!!
+    // YAY!! (unless it's dust, see dimension_pass())
     //
+    TEST_STAGE = MIN_DIMENSION > 0.0 ? TEST_DIMENSION : TEST_SUITABLE;
+}
+
+/**
+ * Stage 0 can stop once the bounding boxes of two windows in a row agree to
+ * within WARMUP_TOLERANCE of their size, which for most maps is long before
+ * WARMUP_ITERATIONS. An orbit which is no longer sane has settled too, as
+ * stage 1 will reject it straight away.
+ *
+ * @param iterations Stage 0 iterations so far, including the newest point
+ */
+bool warmup_has_settled(int iterations)
+{
+    if (WARMUP_WINDOW <= 0) return false;
+    if (!newest_point_is_sane()) return true;
+    // For a flow, a window is only a short arc of its orbit, and the arcs
+    // of two windows in a row can agree long before it has settled
+    if (FACTORY_FLOW[ATTRACTOR_FACTORY - 1]) return false;
+
+    expand_test_box(PREVIOUS[0].xyz);
+    if (iterations % WARMUP_WINDOW != 0) return false;
+
+    // Never settled after the first window, whose previous box is empty
+    vec3 drift = max(abs(TEST_MINIMUM - TEST_SETTLE_MINIMUM), abs(TEST_MAXIMUM - TEST_SETTLE_MAXIMUM));
+    vec3 extent = max(TEST_MAXIMUM, TEST_SETTLE_MAXIMUM) - min(TEST_MINIMUM, TEST_SETTLE_MINIMUM);
+    bool settled = max(drift.x, max(drift.y, drift.z)) <= WARMUP_TOLERANCE * max(extent.x, max(extent.y, extent.z));
+
+    TEST_SETTLE_MINIMUM = TEST_MINIMUM;
+    TEST_SETTLE_MAXIMUM = TEST_MAXIMUM;
+    TEST_MINIMUM = vec3(1e10);
+    TEST_MAXIMUM = vec3(-1e10);
+    return settled;
+}
+
+/** Keep stage 3's orbit for generate_controls(), defined with the search */
+void record_orbit_sample(int sample_index, vec4 position);
+
+/**
+ * Using the attractor factory seeded in seed_attractor_factory(), decide
+ * whether the attractor is interesting enough to draw, carrying on from
+ * wherever the test was paused.
+ *
+ * @param budget Iterations to spend at most, reduced by however many were
+ * @returns true once the test has finished, when TEST_STAGE is the verdict
+ */
+bool continue_suitability_test(inout int budget)
+{
+    if (TEST_STAGE >= TEST_SUITABLE) return true;
+
+    //
+    // Stage 0
+    // Skip the first points to let behaviour emerge, unless it's clear the
+    // orbit will just settle on a fixed point
+    //
+    if (TEST_STAGE == TEST_WARMUP)
+    {
+        if (TEST_ITERATION == 0 && has_attracting_fixed_point()) return fail_suitability_test();
+
+        bool settled = false;
+        for (; !settled && TEST_ITERATION < WARMUP_ITERATIONS && budget > 0; TEST_ITERATION++, budget--)
+        {
+            attractor_factory_next(true);
+            settled = warmup_has_settled(TEST_ITERATION + 1);
+        }
+        if (!settled && TEST_ITERATION < WARMUP_ITERATIONS) return false;
+
+        SEEDED_WARMUP = TEST_ITERATION;
+        begin_test_stage(TEST_PROBE);
+        begin_cycle_detection();
+        TEST_MINIMUM = vec3(1e10);
+        TEST_MAXIMUM = vec3(-1e10);
+    }
+
+    //
+    // Stage 1
+    //
+    if (TEST_STAGE == TEST_PROBE)
+    {
+        for (; TEST_ITERATION < PROBE_ITERATIONS && budget > 0; TEST_ITERATION++, budget--)
+        {
+            attractor_factory_next(true);
+            if (!newest_point_is_sane()) return fail_suitability_test();
+            if (orbit_is_periodic()) return fail_suitability_test();
+            expand_test_box(PREVIOUS[0].xyz);
+        }
+        if (TEST_ITERATION < PROBE_ITERATIONS) return false;
+
+        // Start the tangent for Lyapunov calculation
+        // Random 3D direction (W is drawn but ignored, as factories don't read
+        // it), normalised
+        vec4 direction = vec4(
+            mix(-1, +1, next_float()),
+            mix(-1, +1, next_float()),
+            mix(-1, +1, next_float()),
+            mix(-1, +1, next_float())
+        );
+        TANGENT = normalize(direction.xyz);
+
+        begin_test_stage(TEST_LYAPUNOV_PROBE);
+    }
+
+    //
+    // Stage 2
+    //
+    if (TEST_STAGE == TEST_LYAPUNOV_PROBE)
+    {
+        for (; TEST_ITERATION < LYAPUNOV_PROBE_ITERATIONS && budget > 0; TEST_ITERATION++, budget--)
+        {
+            float stretch = renormalised_step();
+
+            if (isnan(stretch) || isinf(stretch)) return fail_suitability_test();
+            if (!newest_point_is_sane()) return fail_suitability_test();
+            if (orbit_is_periodic()) return fail_suitability_test();
+            expand_test_box(PREVIOUS[0].xyz);
+
+            TEST_LYAPUNOV += stretch;
+        }
+        if (TEST_ITERATION < LYAPUNOV_PROBE_ITERATIONS) return false;
+
+        if (LYAPUNOV_PROBE_ITERATIONS > 0 && TEST_LYAPUNOV / float(LYAPUNOV_PROBE_ITERATIONS) < PROBE_MIN_LYAPUNOV)
+        {
+            return fail_suitability_test();
+        }
+
+        begin_test_stage(TEST_FULL);
+        TEST_WINDOW_LYAPUNOV = 0.0;
+        TEST_COV = mat3(0);
+        TEST_MEAN = vec3(0);
+        begin_coverage_test();
+    }
+
+    //
+    // Stage 3
+    //
+
+    // We check up to TEST_ITERATIONS points, or until the Lyapunov exponent
+    // converges, to:
+    // - Repeat the checks from the earlier stages
+    // - Check the series' Lyapunov exponent is positive
+    // - Check the series isn't too anisotropic
+    bool converged = false;
+    while (!converged && TEST_ITERATION < TEST_ITERATIONS && budget > 0)
+    {
+        float stretch = renormalised_step();
+        budget--;
+
+        //
+        // Check for irrationalities, explosions and collapse
+        //
+        if (isnan(stretch) || isinf(stretch)) return fail_suitability_test();
+        if (!newest_point_is_sane()) return fail_suitability_test();
+        if (orbit_is_periodic()) return fail_suitability_test();
+
+        //
+        // Accumulate data for eigenvlaue estimation
+        //
+        vec3 dMean = PREVIOUS[0].xyz - TEST_MEAN;
+        TEST_MEAN += dMean / float(TEST_ITERATION + 1);
+        //
+        TEST_COV[0][0] += dMean.x * (PREVIOUS[0].x - TEST_MEAN.x);
+        TEST_COV[0][1] += dMean.x * (PREVIOUS[0].y - TEST_MEAN.y);
+        TEST_COV[0][2] += dMean.x * (PREVIOUS[0].z - TEST_MEAN.z);
+        //
+        TEST_COV[1][0] += dMean.y * (PREVIOUS[0].x - TEST_MEAN.x);
+        TEST_COV[1][1] += dMean.y * (PREVIOUS[0].y - TEST_MEAN.y);
+        TEST_COV[1][2] += dMean.y * (PREVIOUS[0].z - TEST_MEAN.z);
+        //
+        TEST_COV[2][0] += dMean.z * (PREVIOUS[0].x - TEST_MEAN.x);
+        TEST_COV[2][1] += dMean.z * (PREVIOUS[0].y - TEST_MEAN.y);
+        TEST_COV[2][2] += dMean.z * (PREVIOUS[0].z - TEST_MEAN.z);
+        //
+        occupy_test_cell(PREVIOUS[0].xyz);
+        cover_screen_point(PREVIOUS[0].xyz);
+        record_orbit_sample(TEST_ITERATION, PREVIOUS[0]);
+        TEST_ITERATION++;
+
+        //
+        // Calculate the Lyapunov exponent contribution from this step
+        //
+        TEST_LYAPUNOV += stretch;
+        converged = lyapunov_has_converged(TEST_LYAPUNOV, TEST_ITERATION, TEST_WINDOW_LYAPUNOV);
+    }
+    if (!converged && TEST_ITERATION < TEST_ITERATIONS) return false;
+
+    finish_suitability_test();
     return true;
 }
 
+/**
+ * main() always binds a suitable attractor before generation starts
+ */
 vec4 generate_next_attractor_point()
 {
-    if (0 == ATTRACTOR_FACTORY)
+    return attractor_factory_next(true);
+}
+
+//                                                                
+//       mmmm    mmmmmmmm     mm     mmmmmm       mmmm   mm    mm 
+//     m#""""#   ##""""""    ####    ##""""##   ##""""#  ##    ## 
+//     ##m       ##          ####    ##    ##   ##"      ##    ## 
+//      "####m   #######    ##  ##   #######   ##        ######## 
+//          "##  ##         ######   ##  "##m  ##m       ##    ## 
+//     #mmmmm#"  ##mmmmmm  m##  ##m  ##    ##   ##mmmm#  ##    ## 
+//      """""    """"""""  ""    ""  ""    """    """"   ""    "" 
+//                                                                
+
+/**
+ *  0: Search. Every invocation tests its own candidates, and the suitable
+ *     one with the lowest key is elected into the SearchResult buffer.
+ *     The search is split into slices of SLICE_ITERATIONS, one dispatch
+ *     each, so that no single dispatch (or frame) pays for all of it.
+ *  1: Generate. One workgroup lays the elected candidate's orbit out as
+ *     control points.
+ *  2: Dimension. Run after every search slice. One workgroup per search
+ *     invocation measures the correlation dimension of any candidate which
+ *     passed the rest of the test in that slice, and elects it if it's
+ *     high enough.
+ *
+ * Each candidate has a key (attempt * invocations + invocation), and its own
+ * random stream derived from that key. Electing the lowest key, rather than
+ * whoever finishes first, means the same seed always elects the same
+ * candidate, however the invocations happen to be scheduled, and however
+ * the search is sliced.
+ */
+uniform int COMPUTE_STAGE;
+const int STAGE_SEARCH   = 0;
+const int STAGE_GENERATE = 1;
+const int STAGE_DIMENSION = 2;
+
+/** Invocations taking part in the search, 1 for a serial search. */
+uniform uint SEARCH_INVOCATIONS;
+
+/** Suitability test iterations each invocation runs per search slice. */
+uniform int SLICE_ITERATIONS;
+
+/** Set for the first slice of a search, which starts every invocation afresh. */
+uniform bool SEARCH_FIRST_SLICE;
+
+/** search_winner before anybody has been elected. MUST MATCH THE HOST! */
+const uint NO_WINNER = 0xFFFFFFFFu;
+/** search_winner when the host has already filled in the candidate. MUST MATCH THE HOST! */
+const uint KNOWN_WINNER = 0xFFFFFFFEu;
+
+/**
+ * Best-of-N. The invocations are split into BEST_OF teams (invocation %
+ * BEST_OF), and each team elects its own lowest suitable key, exactly like
+ * a whole search does with BEST_OF = 1. Once every team has a winner, the
+ * generate stage elects the one with the highest attractor_score() (see
+ * elect_best_team_winner()). The teams search side by side, so N
+ * candidates take about as long to find as the slowest of them, not N
+ * times as long, and the result still only depends on the seed.
+ */
+uniform uint BEST_OF = 1u;
+/** One team per invocation of the electing workgroup. MUST MATCH THE HOST! */
+const uint BEST_OF_MAX = gl_WorkGroupSize.x;
+
+/** BEST_OF, as far as there are invocations to make up the teams */
+uint search_teams()
+{
+    return clamp(BEST_OF, 1u, min(SEARCH_INVOCATIONS, BEST_OF_MAX));
+}
+
+/**
+ * The candidate elected by the search stage. The host resets search_winner
+ * to NO_WINNER before every search, or fills in a known candidate itself
+ * and sets it to KNOWN_WINNER.
+ *
+ * search_previous holds PREVIOUS *after* the suitability test, so generation
+ * carries on from exactly where the search left off.
+ */
+layout(std430, binding = 3) volatile buffer SearchResult
+{
+    /** Key of the elected candidate */
+    uint search_winner;
+    /** ATTRACTOR_FACTORY of the elected candidate */
+    int  search_factory;
+    /** Total candidates tested by every invocation */
+    uint search_attempts;
+    /** What the suitability test measured, so the host can cache it */
+    float search_lyapunov;
+    float search_anisotropy;
+    /**
+     * Invocations still part way through a candidate that could beat the
+     * winner at the end of the last slice. The host clears it before every
+     * slice, and the search is over once it stays 0 with a winner elected.
+     */
+    uint search_live;
+    /** attractor_score(), coverage_ratio() and dimension of the elected candidate */
+    float search_score;
+    float search_coverage;
+    float search_dimension;
+    /** Stage 0 iterations the elected candidate needed */
+    int  search_warmup;
+    /** The parent it was mutated from, or -1 for a fresh draw */
+    int  search_parent;
+    uint _search_padding[1];
+    /** Candidates of each factory tested by this search, for FACTORY_CAPS */
+    uint search_factory_attempts[FACTORY_COUNT];
+    vec4 search_coeff[COEFF_LENGTH];
+    vec4 search_previous[PREVIOUS_LENGTH];
+    /** Key of each team's elected candidate, see BEST_OF */
+    uint search_team_winner[BEST_OF_MAX];
+};
+
+/**
+ * Copy the currently bound and seeded attractor into the SearchResult buffer.
+ */
+void store_candidate()
+{
+    search_factory = ATTRACTOR_FACTORY;
+    search_lyapunov = SEEDED_LYAPUNOV;
+    search_anisotropy = SEEDED_ANISOTROPY;
+    search_score = SEEDED_SCORE;
+    search_coverage = SEEDED_COVERAGE;
+    search_dimension = SEEDED_DIMENSION;
+    search_warmup = SEEDED_WARMUP;
+    search_parent = SEEDED_PARENT;
+
+    for (int i = 0; i < COEFF.length(); i++) search_coeff[i] = COEFF[i];
+    for (int i = 0; i < PREVIOUS.length(); i++) search_previous[i] = PREVIOUS[i];
+}
+
+/**
+ * Bind the attractor stored in the SearchResult buffer, as if we had just
+ * found it ourselves.
+ */
+void load_candidate()
+{
+    ATTRACTOR_FACTORY = search_factory;
+
+    for (int i = 0; i < COEFF.length(); i++) COEFF[i] = search_coeff[i];
+
+    for (int i = 0; i < PREVIOUS.length(); i++) PREVIOUS[i] = search_previous[i];
+}
+
+/**
+ * The most candidates of each factory (indexed by ATTRACTOR_FACTORY - 1) that
+ * one search will test, or 0 for no limit. Candidates of a factory that has
+ * reached its cap are skipped without being tested.
+ *
+ * Which candidates get skipped depends on how the invocations are scheduled,
+ * so a search with caps can't be reproduced exactly.
+ */
+uniform uint FACTORY_CAPS[FACTORY_COUNT];
+
+/**
+ * Running totals for each factory, indexed by ATTRACTOR_FACTORY (0 is
+ * unused). The host reads and clears them every so often, and weighs the
+ * factories by what they cost per suitable candidate.
+ */
+layout(std430, binding = 4) buffer FactoryStats
+{
+    /** Candidates decided either way, which abandoned ones weren't */
+    uint factory_tested[FACTORY_COUNT + 1];
+    uint factory_suitable[FACTORY_COUNT + 1];
+    /**
+     * Factory steps spent testing, abandoned candidates included, as the low
+     * and high halves of 64-bit counts (see add_factory_steps())
+     */
+    uint factory_steps[FACTORY_COUNT + 1];
+    uint factory_steps_high[FACTORY_COUNT + 1];
+    /** Stage 0 iterations, see warmup_has_settled() */
+    uint factory_warmup[FACTORY_COUNT + 1];
+};
+
+/**
+ * Count a candidate of the bound factory towards its cap.
+ *
+ * @returns false if the factory was already at its cap
+ */
+bool claim_factory_attempt()
+{
+    uint cap = FACTORY_CAPS[ATTRACTOR_FACTORY - 1];
+    uint attempts = atomicAdd(search_factory_attempts[ATTRACTOR_FACTORY - 1], 1u);
+    return cap == 0u || attempts < cap;
+}
+
+/**
+ * Add the bound candidate's steps to FactoryStats. Whoever's add wraps
+ * factory_steps around carries into factory_steps_high, so the count is
+ * exact however many invocations add at once.
+ */
+void add_factory_steps()
+{
+    uint before = atomicAdd(factory_steps[ATTRACTOR_FACTORY], FACTORY_STEPS);
+    if (before + FACTORY_STEPS < before) atomicAdd(factory_steps_high[ATTRACTOR_FACTORY], 1u);
+}
+
+/**
+ * Add the candidate that was just tested to FactoryStats
+ */
+void record_factory_stats(bool suitable)
+{
+    atomicAdd(factory_tested[ATTRACTOR_FACTORY], 1u);
+    add_factory_steps();
+    atomicAdd(factory_warmup[ATTRACTOR_FACTORY], uint(SEEDED_WARMUP));
+    if (suitable) atomicAdd(factory_suitable[ATTRACTOR_FACTORY], 1u);
+}
+
+/**
+ * Everything an invocation needs to carry on with its candidate in the next
+ * slice: the bound factory, the test's progress, and the random stream.
+ * The winner's state is left exactly as the test finished with it, so the
+ * generate stage can start from it.
+ *
+ * The host only needs the size. MUST MATCH THE HOST!
+ */
+struct SearchState
+{
+    vec4  coeff[COEFF_LENGTH];
+    vec4  previous[PREVIOUS_LENGTH];
+    vec4  tangent;
+    mat3  cov;
+    vec4  mean;
+    vec4  box_minimum;
+    vec4  box_maximum;
+    vec4  window;
+    vec4  cycle_point;
+    vec4  settle_minimum;
+    vec4  settle_maximum;
+    uint  rng_counter;
+    int   factory;
+    uint  key;
+    uint  steps;
+    int   stage;
+    int   iteration;
+    float lyapunov;
+    float window_lyapunov;
+    float seeded_lyapunov;
+    float seeded_anisotropy;
+    uvec2 occupancy;
+    float seeded_score;
+    uint  coverage;
+    float seeded_coverage;
+    float seeded_dimension;
+    int   cycle_power;
+    int   cycle_length;
+    int   warmup;
+    int   parent;
+};
+layout(std430, binding = 5) buffer SearchStates
+{
+    SearchState search_state[];
+};
+
+/** Key of the candidate this invocation is testing */
+uint SEARCH_KEY = 0u;
+
+/**
+ * The first ORBIT_SAMPLES points of each invocation's stage 3, so the
+ * winner's control points are the very samples it was tested on, rather
+ * than a second pass over the orbit. Sample s of invocation i is at
+ * [s * SEARCH_INVOCATIONS + i], so neighbouring invocations write
+ * neighbouring samples.
+ */
+layout(std430, binding = 6) coherent buffer OrbitSamples
+{
+    vec4 orbit_sample[];
+};
+
+/** Samples the control points need: 4 for the first bezier, 2 for each after it */
+int ORBIT_SAMPLES = 2 * TOTAL_BEZIERS + 2;
+
+uint orbit_index(uint invocation, int sample_index)
+{
+    return uint(sample_index) * SEARCH_INVOCATIONS + invocation;
+}
+
+void record_orbit_sample(int sample_index, vec4 position)
+{
+    if (sample_index >= ORBIT_SAMPLES) return;
+    orbit_sample[orbit_index(SEARCH_KEY % SEARCH_INVOCATIONS, sample_index)] = position;
+}
+
+/**
+ * The invocations left waiting in TEST_DIMENSION by a search slice, which
+ * the dimension pass runs a workgroup for each of. dimension_groups is its
+ * glDispatchComputeIndirect() command: the host sets it to (0, 1, 1) before
+ * every slice, and the invocations count themselves in.
+ */
+layout(std430, binding = 8) buffer DimensionPending
+{
+    uint dimension_groups[3];
+    uint dimension_pending[];
+};
+
+/**
+ * Each invocation's coverage image, one bit per pixel, packed 32 to a word
+ * along x. Invocation i owns the tile of COVERAGE_WORDS x COVERAGE_RESOLUTION
+ * words in column i % COVERAGE_TILE_COLUMNS, row i / COVERAGE_TILE_COLUMNS.
+ * Like the orbit samples, it is shared by every slot.
+ */
+layout(binding = 0, r32ui) uniform uimage2D coverage_image;
+const int COVERAGE_WORDS = COVERAGE_RESOLUTION / 32;
+/** MUST MATCH THE HOST! */
+const int COVERAGE_TILE_COLUMNS = 64;
+
+ivec2 coverage_word(ivec2 pixel)
+{
+    int invocation = int(SEARCH_KEY % SEARCH_INVOCATIONS);
+    ivec2 tile = ivec2(invocation % COVERAGE_TILE_COLUMNS, invocation / COVERAGE_TILE_COLUMNS);
+    return tile * ivec2(COVERAGE_WORDS, COVERAGE_RESOLUTION) + ivec2(pixel.x / 32, pixel.y);
+}
+
+void clear_coverage_image()
+{
+    int side = coverage_side();
+    for (int y = 0; y < side; y++)
     {
-        // I don't think we need to limit this as we should always find an
-        // attractor within the timeframe.
-        do {
-            bind_attractor_factory();
-            seed_attractor_factory();
-        } while(!seeded_attractor_is_suitable());
+        for (int word = 0; word < (side + 31) / 32; word++)
+        {
+            imageStore(coverage_image, coverage_word(ivec2(32 * word, y)), uvec4(0u));
+        }
     }
+}
 
-    return attractor_factory_next(true);
+/**
+ * Nobody else touches this invocation's tile, but imageAtomicOr hands back
+ * the word as it was, so one round trip both lights the pixel and says
+ * whether it was already lit.
+ *
+ * @returns true if the pixel wasn't lit before
+ */
+bool cover_pixel(ivec2 pixel)
+{
+    uint bit = 1u << uint(pixel.x % 32);
+    return (imageAtomicOr(coverage_image, coverage_word(pixel), bit) & bit) == 0u;
+}
+
+void save_search_state(uint invocation)
+{
+    for (int i = 0; i < COEFF.length(); i++) search_state[invocation].coeff[i] = COEFF[i];
+    for (int i = 0; i < PREVIOUS.length(); i++) search_state[invocation].previous[i] = PREVIOUS[i];
+
+    search_state[invocation].tangent = vec4(TANGENT, 0.0);
+    search_state[invocation].cov = TEST_COV;
+    search_state[invocation].mean = vec4(TEST_MEAN, 0.0);
+    search_state[invocation].box_minimum = vec4(TEST_MINIMUM, 0.0);
+    search_state[invocation].box_maximum = vec4(TEST_MAXIMUM, 0.0);
+    search_state[invocation].window = TEST_WINDOW;
+    search_state[invocation].cycle_point = vec4(TEST_CYCLE_POINT, 0.0);
+    search_state[invocation].settle_minimum = vec4(TEST_SETTLE_MINIMUM, 0.0);
+    search_state[invocation].settle_maximum = vec4(TEST_SETTLE_MAXIMUM, 0.0);
+    search_state[invocation].rng_counter = RNG_COUNTER;
+    search_state[invocation].factory = ATTRACTOR_FACTORY;
+    search_state[invocation].key = SEARCH_KEY;
+    search_state[invocation].steps = FACTORY_STEPS;
+    search_state[invocation].stage = TEST_STAGE;
+    search_state[invocation].iteration = TEST_ITERATION;
+    search_state[invocation].lyapunov = TEST_LYAPUNOV;
+    search_state[invocation].window_lyapunov = TEST_WINDOW_LYAPUNOV;
+    search_state[invocation].seeded_lyapunov = SEEDED_LYAPUNOV;
+    search_state[invocation].seeded_anisotropy = SEEDED_ANISOTROPY;
+    search_state[invocation].occupancy = TEST_OCCUPANCY;
+    search_state[invocation].seeded_score = SEEDED_SCORE;
+    search_state[invocation].coverage = TEST_COVERAGE;
+    search_state[invocation].seeded_coverage = SEEDED_COVERAGE;
+    search_state[invocation].seeded_dimension = SEEDED_DIMENSION;
+    search_state[invocation].cycle_power = TEST_CYCLE_POWER;
+    search_state[invocation].cycle_length = TEST_CYCLE_LENGTH;
+    search_state[invocation].warmup = SEEDED_WARMUP;
+    search_state[invocation].parent = SEEDED_PARENT;
+}
+
+void load_search_state(uint invocation)
+{
+    ATTRACTOR_FACTORY = search_state[invocation].factory;
+
+    for (int i = 0; i < COEFF.length(); i++) COEFF[i] = search_state[invocation].coeff[i];
+    for (int i = 0; i < PREVIOUS.length(); i++) PREVIOUS[i] = search_state[invocation].previous[i];
+
+    TANGENT = search_state[invocation].tangent.xyz;
+    TEST_COV = search_state[invocation].cov;
+    TEST_MEAN = search_state[invocation].mean.xyz;
+    TEST_MINIMUM = search_state[invocation].box_minimum.xyz;
+    TEST_MAXIMUM = search_state[invocation].box_maximum.xyz;
+    TEST_WINDOW = search_state[invocation].window;
+    TEST_CYCLE_POINT = search_state[invocation].cycle_point.xyz;
+    TEST_SETTLE_MINIMUM = search_state[invocation].settle_minimum.xyz;
+    TEST_SETTLE_MAXIMUM = search_state[invocation].settle_maximum.xyz;
+    SEARCH_KEY = search_state[invocation].key;
+    // The stream is the one seed_candidate() started for this key
+    seek_random_stream(SEARCH_KEY + 1u, search_state[invocation].rng_counter);
+    FACTORY_STEPS = search_state[invocation].steps;
+    TEST_STAGE = search_state[invocation].stage;
+    TEST_ITERATION = search_state[invocation].iteration;
+    TEST_LYAPUNOV = search_state[invocation].lyapunov;
+    TEST_WINDOW_LYAPUNOV = search_state[invocation].window_lyapunov;
+    SEEDED_LYAPUNOV = search_state[invocation].seeded_lyapunov;
+    SEEDED_ANISOTROPY = search_state[invocation].seeded_anisotropy;
+    TEST_OCCUPANCY = search_state[invocation].occupancy;
+    SEEDED_SCORE = search_state[invocation].seeded_score;
+    TEST_COVERAGE = search_state[invocation].coverage;
+    SEEDED_COVERAGE = search_state[invocation].seeded_coverage;
+    SEEDED_DIMENSION = search_state[invocation].seeded_dimension;
+    TEST_CYCLE_POWER = search_state[invocation].cycle_power;
+    TEST_CYCLE_LENGTH = search_state[invocation].cycle_length;
+    SEEDED_WARMUP = search_state[invocation].warmup;
+    SEEDED_PARENT = search_state[invocation].parent;
+}
+
+/**
+ * Attractors the search has found recently, newest first, which candidates
+ * can be mutations of. Only PARENT_COUNT of them are valid.
+ */
+struct MutationParent
+{
+    vec4 coeff[COEFF_LENGTH];
+    int  factory;
+};
+layout(std430, binding = 7) readonly buffer MutationParents
+{
+    MutationParent mutation_parent[];
+};
+uniform int PARENT_COUNT = 0;
+/**
+ * Chance a candidate is a mutation of a parent of its factory, rather than a
+ * fresh draw: the mix of exploitation and exploration. Set by the host.
+ */
+uniform float MUTATION_RATE = 0.25;
+/** How far a mutation moves each coefficient, relative to FACTORY_SPREAD */
+uniform float MUTATION_SIGMA = 0.1;
+
+/**
+ * Maybe replace the freshly seeded candidate's coefficients with those of a
+ * parent of the same factory, nudged by MUTATION_SIGMA. Near a chaotic
+ * attractor, most coefficients are chaotic too, so mutations pass far more
+ * often than fresh draws. The starting points are kept, and so is the
+ * factory, so FACTORY_WEIGHTS and FACTORY_CAPS still hold.
+ */
+void mutate_attractor_factory()
+{
+    SEEDED_PARENT = -1;
+    if (PARENT_COUNT <= 0 || MUTATION_RATE <= 0.0) return;
+
+    // Both are drawn either way, so what follows doesn't depend on the parents
+    float f = next_float();
+    uint pick = next_uint();
+
+    int count = 0;
+    for (int i = 0; i < PARENT_COUNT; i++)
+    {
+        if (mutation_parent[i].factory == ATTRACTOR_FACTORY) count++;
+    }
+    if (count == 0 || f >= MUTATION_RATE) return;
+
+    int k = int(pick % uint(count));
+    for (int i = 0; i < PARENT_COUNT && SEEDED_PARENT < 0; i++)
+    {
+        if (mutation_parent[i].factory == ATTRACTOR_FACTORY && k-- == 0) SEEDED_PARENT = i;
+    }
+
+    int factory = ATTRACTOR_FACTORY - 1;
+    float sigma = MUTATION_SIGMA * FACTORY_SPREAD[factory];
+    for (int i = 0; i < FACTORY_COEFFICIENTS[factory]; i++)
+    {
+        for (int c = 0; c < FACTORY_COMPONENTS[factory]; c++)
+        {
+            COEFF[i][c] = mutation_parent[SEEDED_PARENT].coeff[i][c] + next_gaussian(0.0, sigma);
+        }
+    }
+}
+
+/**
+ * Bind and seed the candidate with the given key, from its own stream.
+ * Stream 0 is left to the host (see RA_HOST_STREAM).
+ */
+void seed_candidate(uint key)
+{
+    seed_random_stream(key + 1u);
+    bind_attractor_factory();
+    seed_attractor_factory();
+    mutate_attractor_factory();
+}
+
+/**
+ * Bind and seed the candidate with the given key, ready to be tested, unless
+ * its factory has reached its cap.
+ */
+void begin_candidate(uint key)
+{
+    SEARCH_KEY = key;
+    seed_candidate(key);
+    begin_suitability_test();
+
+    if (!claim_factory_attempt())
+    {
+        TEST_STAGE = TEST_SKIPPED;
+        return;
+    }
+
+    atomicAdd(search_attempts, 1u);
+}
+
+/**
+ * Give up on the bound candidate undecided, as somebody in the team has been
+ * elected with a lower key. Its steps still count towards its factory's
+ * cost, or the factories whose candidates take longest to decide would look
+ * cheaper than they are. Its steps are only counted once, however many
+ * slices follow.
+ */
+void abandon_candidate(uint invocation)
+{
+    // Decided candidates were counted by record_factory_stats()
+    if (TEST_STAGE <= TEST_FULL || TEST_STAGE == TEST_DIMENSION) add_factory_steps();
+    TEST_STAGE = TEST_ABANDONED;
+    save_search_state(invocation);
+}
+
+/**
+ * Carry on testing candidates for one slice, racing every other invocation
+ * in its team to find the suitable candidate with the lowest key. Each
+ * invocation tests keys invocation, invocation + SEARCH_INVOCATIONS, ...
+ * until somebody in its team (possibly itself) has been elected with a
+ * lower key.
+ */
+void search_slice()
+{
+    uint invocation = gl_GlobalInvocationID.x;
+    if (invocation >= SEARCH_INVOCATIONS) return;
+
+    uint team = invocation % search_teams();
+
+    if (SEARCH_FIRST_SLICE)
+    {
+        begin_candidate(invocation);
+    }
+    else
+    {
+        load_search_state(invocation);
+
+        // Elected (or beaten) in an earlier slice, and must keep its state
+        if (TEST_STAGE == TEST_SUITABLE) return;
+        // Somebody was elected in an earlier slice, maybe after we saved
+        if (search_team_winner[team] <= SEARCH_KEY)
+        {
+            abandon_candidate(invocation);
+            return;
+        }
+
+        // Turned down by the dimension pass, which has already counted it
+        if (TEST_STAGE == TEST_UNSUITABLE) begin_candidate(SEARCH_KEY + SEARCH_INVOCATIONS);
+    }
+
+    int budget = SLICE_ITERATIONS;
+    while (true)
+    {
+        // Somebody else already has a lower key, and ours only go up
+        if (search_team_winner[team] <= SEARCH_KEY)
+        {
+            abandon_candidate(invocation);
+            return;
+        }
+
+        // Out of time, so pick this candidate up again in the next slice
+        if (budget <= 0 || !continue_suitability_test(budget))
+        {
+            atomicAdd(search_live, 1u);
+            save_search_state(invocation);
+            return;
+        }
+
+        // The dimension pass runs straight after this slice, and decides
+        if (TEST_STAGE == TEST_DIMENSION)
+        {
+            atomicAdd(search_live, 1u);
+            dimension_pending[atomicAdd(dimension_groups[0], 1u)] = invocation;
+            save_search_state(invocation);
+            return;
+        }
+
+        if (TEST_STAGE != TEST_SKIPPED)
+        {
+            bool suitable = TEST_STAGE == TEST_SUITABLE;
+            record_factory_stats(suitable);
+
+            if (suitable)
+            {
+                // search_winner just says somebody has been elected, until
+                // elect_best_team_winner() decides between the teams
+                atomicMin(search_team_winner[team], SEARCH_KEY);
+                atomicMin(search_winner, SEARCH_KEY);
+                save_search_state(invocation);
+                return;
+            }
+        }
+
+        // Seeding costs about as much as an iteration, which also makes sure
+        // the slice ends even if every candidate is being skipped (which
+        // the host notices, and lifts FACTORY_CAPS)
+        begin_candidate(SEARCH_KEY + SEARCH_INVOCATIONS);
+        budget--;
+    }
+}
+
+/** Radii the dimension pass counts pairs within, halving each time */
+const int DIMENSION_RADII = 8;
+/** Pairs of samples closer than this in time are left out (Theiler window) */
+const int DIMENSION_THEILER = 8;
+/** Radii with fewer pairs within them than this are too noisy to fit */
+const uint DIMENSION_MIN_PAIRS = 20u;
+
+/** The tile of samples every invocation compares its own against */
+shared vec3 DIMENSION_TILE[gl_WorkGroupSize.x];
+/** Pairs whose distance first fell within each radius */
+shared uint DIMENSION_PAIRS[DIMENSION_RADII];
+
+/**
+ * Fit the slope of log C(r) against log r, where C(r) is the number of pairs
+ * within r, over the radii with enough pairs to trust. The largest radius
+ * holds nearly every pair, so it's left out.
+ */
+float correlation_dimension()
+{
+    float n = 0.0;
+    float sum_x = 0.0, sum_y = 0.0, sum_xx = 0.0, sum_xy = 0.0;
+
+    uint within = 0u;
+    for (int radius = DIMENSION_RADII - 1; radius >= 1; radius--)
+    {
+        within += DIMENSION_PAIRS[radius];
+        if (within < DIMENSION_MIN_PAIRS) continue;
+
+        // Radius r0 / 2^radius, relative to r0
+        float x = -float(radius) * log(2.0);
+        float y = log(float(within));
+        n += 1.0;
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    // Too few radii means every pair is far apart or right on top of each
+    // other, which is just a handful of points
+    if (n < 3.0) return 0.0;
+    return (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+}
+
+/**
+ * Run by a whole workgroup, for the search invocation it was dispatched for
+ * (see DimensionPending), whose candidate is waiting in TEST_DIMENSION.
+ * Estimate its Grassberger-Procaccia correlation dimension from the orbit
+ * samples stage 3 recorded, and finish its test.
+ *
+ * Every pair of samples is counted against radii halving from twice the
+ * orbit's RMS distance from its mean. Each invocation owns every
+ * gl_WorkGroupSize.x'th sample, and compares it against a tile of samples
+ * shared by the whole workgroup at a time.
+ */
+void dimension_pass()
+{
+    if (gl_WorkGroupID.x >= dimension_groups[0]) return;
+    uint invocation = dimension_pending[gl_WorkGroupID.x];
+    if (invocation >= SEARCH_INVOCATIONS) return;
+    // The same for the whole workgroup, so nobody skips a barrier()
+    if (search_state[invocation].stage != TEST_DIMENSION) return;
+
+    uint lane = gl_LocalInvocationIndex;
+    int size = int(gl_WorkGroupSize.x);
+
+    int iterations = max(search_state[invocation].iteration, 1);
+    int samples = min(iterations, ORBIT_SAMPLES);
+    mat3 cov = search_state[invocation].cov / float(iterations);
+    float r0_squared = 4.0 * (cov[0][0] + cov[1][1] + cov[2][2]);
+
+    uint pairs[DIMENSION_RADII];
+    for (int radius = 0; radius < DIMENSION_RADII; radius++) pairs[radius] = 0u;
+    if (lane < uint(DIMENSION_RADII)) DIMENSION_PAIRS[lane] = 0u;
+
+    for (int tile = 0; tile < samples; tile += size)
+    {
+        barrier();
+        if (tile + int(lane) < samples)
+        {
+            DIMENSION_TILE[lane] = orbit_sample[orbit_index(invocation, tile + int(lane))].xyz;
+        }
+        barrier();
+
+        int tile_samples = min(size, samples - tile);
+        for (int i = int(lane); i < samples; i += size)
+        {
+            vec3 p = orbit_sample[orbit_index(invocation, i)].xyz;
+
+            // Only later samples, so every pair is counted once
+            for (int t = max(i + DIMENSION_THEILER - tile, 0); t < tile_samples; t++)
+            {
+                vec3 d = p - DIMENSION_TILE[t];
+                float d_squared = dot(d, d);
+                if (!(d_squared < r0_squared)) continue;
+
+                // Halvings of r0 before the radius is smaller than d
+                int radius = d_squared > 0.0 ? int(0.5 * log2(r0_squared / d_squared)) : DIMENSION_RADII - 1;
+                pairs[min(radius, DIMENSION_RADII - 1)]++;
+            }
+        }
+    }
+
+    for (int radius = 0; radius < DIMENSION_RADII; radius++)
+    {
+        if (pairs[radius] > 0u) atomicAdd(DIMENSION_PAIRS[radius], pairs[radius]);
+    }
+    barrier();
+
+    if (lane != 0u) return;
+
+    load_search_state(invocation);
+    SEEDED_DIMENSION = correlation_dimension();
+
+    bool suitable = SEEDED_DIMENSION >= MIN_DIMENSION;
+    TEST_STAGE = suitable ? TEST_SUITABLE : TEST_UNSUITABLE;
+    record_factory_stats(suitable);
+
+    if (suitable)
+    {
+        uint team = invocation % search_teams();
+        atomicMin(search_team_winner[team], SEARCH_KEY);
+        atomicMin(search_winner, SEARCH_KEY);
+    }
+    save_search_state(invocation);
 }
 
 //                                            
@@ -757,89 +2163,180 @@ vec4 generate_next_attractor_point()
 //     ""    ""  ""    ""   """"""   ""   """ 
 //                                            
 
-void main()
-{
-    mesh_bounding_box.minimum = vec4(1e10);
-    mesh_bounding_box.maximum = vec4(-1e10);
+/** Each team's winner, reduced by elect_best_team_winner() */
+shared float ELECT_SCORE[BEST_OF_MAX];
+shared uint  ELECT_KEY[BEST_OF_MAX];
 
-    //
-    //
-    //
+/**
+ * Run by a whole workgroup, one invocation per team. Elect the team winner
+ * with the highest score (the lowest key on a tie) as search_winner.
+ */
+void elect_best_team_winner()
+{
+    uint lane = gl_LocalInvocationIndex;
 
-    int unique_controls = 0;
+    ELECT_SCORE[lane] = -1e30;
+    ELECT_KEY[lane] = NO_WINNER;
+    if (lane < search_teams() && search_team_winner[lane] != NO_WINNER)
+    {
+        ELECT_KEY[lane] = search_team_winner[lane];
+        ELECT_SCORE[lane] = search_state[ELECT_KEY[lane] % SEARCH_INVOCATIONS].seeded_score;
+    }
+    barrier();
 
-    for (int bez = 0; bez < TOTAL_BEZIERS; bez++)
+    for (uint stride = BEST_OF_MAX / 2u; stride > 0u; stride /= 2u)
     {
-        // 
-        // If this is the first bezier, we just generate 4 new points,
-        // ignoring continuity since there is no previous bezier
-        //
-        if (bez <= 0)
+        if (lane < stride)
         {
-            for (int ctrl = 0; ctrl < CONTROLS_PER_BEZIER; ctrl++)
+            float score = ELECT_SCORE[lane + stride];
+            uint key = ELECT_KEY[lane + stride];
+            if (score > ELECT_SCORE[lane] || (score == ELECT_SCORE[lane] && key < ELECT_KEY[lane]))
             {
-                ControlPoint cp;
+                ELECT_SCORE[lane] = score;
+                ELECT_KEY[lane] = key;
+            }
+        }
+        barrier();
+    }
 
-                cp.position = generate_next_attractor_point();
-                unique_controls++;
+    if (lane == 0u && ELECT_KEY[0] != NO_WINNER) search_winner = ELECT_KEY[0];
+    memoryBarrierBuffer();
+    barrier();
+}
 
-                cp.data.x = float(unique_controls-1) / float(UNIQUE_CONTROLS_PER_PATH-1);
-                cp.data.y = 0.0;
-                cp.data.z = 0.0;
-                cp.data.w = 0.0;
+/** Each invocation's share of the bounding box, reduced by generate_controls() */
+shared vec4 GENERATE_MINIMUM[gl_WorkGroupSize.x];
+shared vec4 GENERATE_MAXIMUM[gl_WorkGroupSize.x];
 
-                set_control(bez, ctrl, cp);
-                expand_bounds(cp.position);
-            }
+/**
+ * Run by a whole workgroup. Invocation 0 makes sure the orbit has all
+ * ORBIT_SAMPLES, then every invocation lays out a share of the beziers.
+ *
+ * Bezier b is made of samples 2b+1, 2b+2 and 2b+3, plus the mirror of
+ * sample 2b about 2b+1 (see the top of this file), so the beziers don't
+ * depend on each other. The first bezier is just samples 0 to 3.
+ */
+void generate_controls()
+{
+    uint lane = gl_LocalInvocationIndex;
 
-            continue;
+    //
+    // A winner recorded its samples while it was being tested, so this
+    // only fills in any its test didn't reach (when the Lyapunov estimate
+    // converged early). A known candidate has to generate all of them.
+    //
+    if (lane == 0u)
+    {
+        int recorded = 0;
+        if (search_winner == KNOWN_WINNER)
+        {
+            SEARCH_KEY = 0u;
+            load_candidate();
         }
-        //
-        // For all Beziers after the first, we must handle position and
-        // tangential continuity
-        //
         else
         {
-            for (int ctrl = 0; ctrl < CONTROLS_PER_BEZIER; ctrl++)
+            // The winner stopped as soon as it was elected, so its state is
+            // exactly as the test left it
+            load_search_state(search_winner % SEARCH_INVOCATIONS);
+            store_candidate();
+            recorded = min(TEST_ITERATION, ORBIT_SAMPLES);
+        }
+
+        for (int sample_index = recorded; sample_index < ORBIT_SAMPLES; sample_index++)
+        {
+            record_orbit_sample(sample_index, generate_next_attractor_point());
+        }
+        memoryBarrierBuffer();
+    }
+    barrier();
+
+    uint invocation = search_winner == KNOWN_WINNER ? 0u : search_winner % SEARCH_INVOCATIONS;
+    vec4 minimum = vec4(1e10);
+    vec4 maximum = vec4(-1e10);
+
+    for (int bez = int(lane); bez < TOTAL_BEZIERS; bez += int(gl_WorkGroupSize.x))
+    {
+        for (int ctrl = 0; ctrl < CONTROLS_PER_BEZIER; ctrl++)
+        {
+            ControlPoint cp;
+
+            if (bez <= 0)
+            {
+                cp.position = orbit_sample[orbit_index(invocation, ctrl)];
+            }
+            else if (ctrl == 1)
+            {
+                vec4 mirror_from = orbit_sample[orbit_index(invocation, 2 * bez)];
+                vec4 mirror_to = orbit_sample[orbit_index(invocation, 2 * bez + 1)];
+                cp.position = mirrored_control_position(mirror_from, mirror_to);
+            }
+            else
             {
-                ControlPoint cp;
-
-                switch (ctrl)
-                {
-                    //
-                    // If 0, add control for position continuity
-                    //
-                    // We DON'T increment the unique_controls
-                    // because this is shared from the previous Bezier
-                    //
-                    case 0:
-                        cp.position = get_control(bez-1, 3).position;
-                        break;
-                    //
-                    // If 1, add control for tangency continuity
-                    //
-                    case 1:
-                        ControlPoint mirror_from = get_control(bez-1, 2);
-                        ControlPoint mirror_to = get_control(bez-1, 3);
-                        cp.position = mirrored_control_position(mirror_from.position, mirror_to.position);
-                        unique_controls++;
-                        break;
-                    //
-                    // If 2/3, generate a new point
-                    //
-                    default:
-                        cp.position = generate_next_attractor_point();
-                        unique_controls++;
-                        break;
-                };
-
-                cp.data.x = float(unique_controls-1) / float(UNIQUE_CONTROLS_PER_PATH-1);
-                cp.data.y = 0.0;
-                cp.data.z = 0.0;
-                cp.data.w = 0.0;
-                set_control(bez, ctrl, cp);
-                expand_bounds(cp.position);
+                // 0 is shared with the end of the previous bezier
+                cp.position = orbit_sample[orbit_index(invocation, 2 * bez + max(ctrl, 1))];
             }
+
+            // Every bezier adds 3 unique controls, as control 0 is shared
+            cp.data.x = float(3 * bez + ctrl) / float(UNIQUE_CONTROLS_PER_PATH-1);
+            cp.data.y = 0.0;
+            cp.data.z = 0.0;
+            cp.data.w = 0.0;
+
+            set_control(bez, ctrl, cp);
+            minimum = min(minimum, cp.position);
+            maximum = max(maximum, cp.position);
         }
     }
-}
\ No newline at end of file
+
+    //
+    // Reduce the bounding box across the workgroup
+    //
+    GENERATE_MINIMUM[lane] = minimum;
+    GENERATE_MAXIMUM[lane] = maximum;
+    barrier();
+
+    for (uint stride = gl_WorkGroupSize.x / 2u; stride > 0u; stride /= 2u)
+    {
+        if (lane < stride)
+        {
+            GENERATE_MINIMUM[lane] = min(GENERATE_MINIMUM[lane], GENERATE_MINIMUM[lane + stride]);
+            GENERATE_MAXIMUM[lane] = max(GENERATE_MAXIMUM[lane], GENERATE_MAXIMUM[lane + stride]);
+        }
+        barrier();
+    }
+
+    if (lane == 0u)
+    {
+        mesh_bounding_box.minimum = GENERATE_MINIMUM[0];
+        mesh_bounding_box.maximum = GENERATE_MAXIMUM[0];
+    }
+}
+
+void main()
+{
+    if (COMPUTE_STAGE == STAGE_SEARCH)
+    {
+        search_slice();
+        return;
+    }
+
+    if (COMPUTE_STAGE == STAGE_DIMENSION)
+    {
+        dimension_pass();
+        return;
+    }
+
+    //
+    // Generation needs only one workgroup, which shares the work out
+    //
+    if (gl_WorkGroupID.x != 0u) return;
+
+    //
+    // The host only generates once a search has finished (or when it filled
+    // in a known candidate itself)
+    //
+    if (search_winner == NO_WINNER) return;
+
+    if (search_winner != KNOWN_WINNER && search_teams() > 1u) elect_best_team_winner();
+    generate_controls();
+}
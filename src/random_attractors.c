@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,6 +39,31 @@
 //
 #define RA_CYCLE_TIME_SECS      (30)
 #define RA_CYCLE_FADE_FRACTION  (0.05)
+//
+#define RA_SEARCH_LOCAL_SIZE    (64)            // MUST MATCH local_size_x IN mesh_cs.glsl
+#define RA_SEARCH_GROUPS        (64)
+#define RA_SEARCH_INVOCATIONS   (RA_SEARCH_GROUPS * RA_SEARCH_LOCAL_SIZE)
+#define RA_SEARCH_SLICE_DEFAULT (2000)          // Test iterations per invocation, per frame
+#define RA_SEARCH_MAX_SLICES    (1000)          // Slices before the GPU gives up
+#define RA_ORBIT_SAMPLES        (2 * RA_BEZIER_PER_PATH * RA_PATH_COUNT + 2)  // MUST MATCH ORBIT_SAMPLES IN mesh_cs.glsl
+#define RA_COVERAGE_RESOLUTION  (128)           // MUST MATCH COVERAGE_RESOLUTION IN mesh_cs.glsl
+#define RA_COVERAGE_COLUMNS     (64)            // MUST MATCH COVERAGE_TILE_COLUMNS IN mesh_cs.glsl
+#define RA_COVERAGE_DEFAULT     (0.1f)          // MIN_COVERAGE, see /coverage
+#define RA_DIMENSION_DEFAULT    (1.0f)          // MIN_DIMENSION, see /dimension
+#define RA_SEARCH_NO_WINNER     (0xFFFFFFFFu)   // MUST MATCH NO_WINNER IN mesh_cs.glsl
+#define RA_SEARCH_KNOWN_WINNER  (0xFFFFFFFEu)   // MUST MATCH KNOWN_WINNER IN mesh_cs.glsl
+#define RA_FAMILY_MIN_TESTED    (256)           // Candidates before a family's cost is trusted
+#define RA_FAMILY_PRIOR_PASSED  (1.0)           // Suitable candidates each family starts out credited with
+#define RA_HOST_STREAM          (0)             // Never a candidate's stream in mesh_cs.glsl
+#define RA_CROSS_CHECK_EPSILON  (1e-3f)         // GPU transcendentals are only a few ULPs out
+//
+#define RA_STAGE_SEARCH         (0)
+#define RA_STAGE_GENERATE       (1)
+#define RA_STAGE_DIMENSION      (2)
+//
+#define RA_CPU_SEARCH_GROUPS    (100000)        // Lane groups before the CPU gives up
+//
+#define RA_MESH_QUEUE_DEFAULT   (1)             // Prepared meshes, not counting the one on screen
 
 /**
  * Spotlight sits just below the XZ plane (y=0.05) to prevent z-fighting
@@ -150,6 +176,16 @@ int main(int argc, char *argv[])
     // Shutdown
     //
 
+    if (ra.cpu_search)
+    {
+        ra_log(&ra, "Stopping CPU worker...\n");
+        atomic_store(&ra.cpu_cancel, true);
+        thrd_join(ra.cpu_worker, NULL);
+        free(ra.cpu_controls);
+    }
+
+    ra_cache_close(&ra.catalog);
+
     ra_log(&ra, "Terminating GLFW...\n");
     glfwTerminate();
 
@@ -182,6 +218,233 @@ void ra_parse_args(struct RandomAttractors *ra, int argc, char *argv[])
         return;
     }
 
+    //
+    // Optional extras, which can come in any order after the mode
+    //
+    ra->mesh_queue_depth        = RA_MESH_QUEUE_DEFAULT;
+    ra->search_slice_iterations = RA_SEARCH_SLICE_DEFAULT;
+    ra->best_of                 = 1;
+    ra->min_coverage            = RA_COVERAGE_DEFAULT;
+    ra->min_dimension           = RA_DIMENSION_DEFAULT;
+    ra_engine_default_params(&ra->search_params);
+    memcpy(ra->family_weights, ra->search_params.family_weights, sizeof(ra->family_weights));
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "/serial") == 0)
+        {
+            ra->serial_search = true;
+            printf("Serial search enabled!\n");
+        }
+        else if (strcmp(argv[i], "/cpu") == 0)
+        {
+            ra->cpu_search = true;
+            printf("CPU search enabled! (%d lanes, %s)\n", RA_ENGINE_LANES, ra_engine_simd());
+        }
+        else if (strcmp(argv[i], "/nocache") == 0)
+        {
+            ra->cache_disabled = true;
+            printf("Attractor cache disabled!\n");
+        }
+        else if (strcmp(argv[i], "/warmup") == 0 && i + 2 < argc)
+        {
+            ra->search_params.warmup_window    = (int)strtol(argv[++i], NULL, 10);
+            ra->search_params.warmup_tolerance = strtof(argv[++i], NULL);
+            printf("Warm-up settling window/tolerance are %d/%f\n", ra->search_params.warmup_window,
+                ra->search_params.warmup_tolerance);
+        }
+        else if (strcmp(argv[i], "/converge") == 0 && i + 3 < argc)
+        {
+            ra->search_params.lyapunov_window    = (int)strtol(argv[++i], NULL, 10);
+            ra->search_params.lyapunov_tolerance = strtof(argv[++i], NULL);
+            ra->search_params.lyapunov_margin    = strtof(argv[++i], NULL);
+            printf("Lyapunov convergence window/tolerance/margin are %d/%f/%f\n",
+                ra->search_params.lyapunov_window, ra->search_params.lyapunov_tolerance,
+                ra->search_params.lyapunov_margin);
+        }
+        else if (strcmp(argv[i], "/seed") == 0 && i + 1 < argc)
+        {
+            ra->seed       = (uint32_t)strtoul(argv[++i], NULL, 10);
+            ra->seed_fixed = true;
+            printf("Random seed is %u\n", ra->seed);
+        }
+        else if (strcmp(argv[i], "/replay") == 0 && i + 1 < argc)
+        {
+            ra->seed       = (uint32_t)strtoul(argv[++i], NULL, 10);
+            ra->seed_fixed = true;
+            ra->replay     = true;
+            printf("Replaying cycle seed %u\n", ra->seed);
+        }
+        else if (strcmp(argv[i], "/family") == 0 && i + 1 < argc)
+        {
+            ra->search_params.family = (int)strtol(argv[++i], NULL, 10);
+            if (ra->search_params.family <= RA_FAMILY_NONE || RA_FAMILY_COUNT <= ra->search_params.family
+                || ra->search_params.family == RA_FAMILY_CUSTOM)
+            {
+                printf("Family must be between 1 and %d, other than %d (custom attractors need /equations)\n",
+                    RA_FAMILY_COUNT - 1, RA_FAMILY_CUSTOM);
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Only using attractor family %d\n", ra->search_params.family);
+        }
+        else if (strcmp(argv[i], "/weights") == 0 && i + RA_FAMILY_BUILT_IN < argc)
+        {
+            // The built-in families, as the custom one comes with /equations
+            float total = 0.0f;
+            for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+            {
+                if (family == RA_FAMILY_CUSTOM) continue;
+                float weight = strtof(argv[++i], NULL);
+                ra->family_weights[family]               = weight;
+                ra->search_params.family_weights[family] = weight;
+                total += weight;
+                printf("Attractor family %d has weight %f\n", family, weight);
+
+                if (weight < 0.0f)
+                {
+                    printf("Family weights can't be negative\n");
+                    ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                    return;
+                }
+            }
+            if (total <= 0.0f)
+            {
+                printf("At least one family needs a weight above 0\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+        }
+        else if (strcmp(argv[i], "/caps") == 0 && i + RA_FAMILY_BUILT_IN < argc)
+        {
+            for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+            {
+                if (family == RA_FAMILY_CUSTOM) continue;
+                ra->search_params.family_caps[family] = (int)strtol(argv[++i], NULL, 10);
+                printf("Attractor family %d is capped at %d candidate(s) per search\n", family,
+                    ra->search_params.family_caps[family]);
+            }
+        }
+        else if (strcmp(argv[i], "/catalog") == 0 && i + 1 < argc)
+        {
+            ra->catalog_path = argv[++i];
+            printf("Drawing attractors from the catalog %s\n", ra->catalog_path);
+        }
+        else if (strcmp(argv[i], "/atlas") == 0 && i + 1 < argc)
+        {
+            ra->atlas_path = argv[++i];
+            printf("Drawing fresh candidates from the atlas %s\n", ra->atlas_path);
+        }
+        else if (strcmp(argv[i], "/equations") == 0 && i + 1 < argc)
+        {
+            char error[RA_EQUATIONS_ERROR_LENGTH];
+            ra->equations_path = argv[++i];
+            if (!ra_equations_load(&ra->equations, ra->equations_path, error, sizeof(error)))
+            {
+                printf("Couldn't compile the equations in %s: %s\n", ra->equations_path, error);
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            ra->search_params.equations = &ra->equations;
+            ra->search_params.family    = RA_FAMILY_CUSTOM;
+            printf("Only using the attractor equations in %s\n", ra->equations_path);
+        }
+        else if (strcmp(argv[i], "/queue") == 0 && i + 1 < argc)
+        {
+            ra->mesh_queue_depth = (int)strtol(argv[++i], NULL, 10);
+            if (ra->mesh_queue_depth < 1 || RA_MESH_QUEUE_MAX < ra->mesh_queue_depth)
+            {
+                printf("Queue depth must be between 1 and %d\n", RA_MESH_QUEUE_MAX);
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Mesh queue depth is %d\n", ra->mesh_queue_depth);
+        }
+        else if (strcmp(argv[i], "/slice") == 0 && i + 1 < argc)
+        {
+            ra->search_slice_iterations = (int)strtol(argv[++i], NULL, 10);
+            if (ra->search_slice_iterations < 1)
+            {
+                printf("Slices need at least 1 iteration\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Search slices are %d iterations\n", ra->search_slice_iterations);
+        }
+        else if (strcmp(argv[i], "/best") == 0 && i + 1 < argc)
+        {
+            ra->best_of = (int)strtol(argv[++i], NULL, 10);
+            if (ra->best_of < 1 || RA_BEST_OF_MAX < ra->best_of)
+            {
+                printf("Best-of must be between 1 and %d\n", RA_BEST_OF_MAX);
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Searches pick the best of %d attractors\n", ra->best_of);
+        }
+        else if (strcmp(argv[i], "/mutate") == 0 && i + 2 < argc)
+        {
+            ra->search_params.mutation_rate  = strtof(argv[++i], NULL);
+            ra->search_params.mutation_sigma = strtof(argv[++i], NULL);
+            if (!(0.0f <= ra->search_params.mutation_rate && ra->search_params.mutation_rate <= 1.0f))
+            {
+                printf("Mutation rate must be between 0 and 1\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Mutation rate/sigma are %f/%f\n", ra->search_params.mutation_rate,
+                ra->search_params.mutation_sigma);
+        }
+        else if (strcmp(argv[i], "/proposal") == 0 && i + 1 < argc)
+        {
+            ra->search_params.proposal_floor = strtof(argv[++i], NULL);
+            if (!(0.0f < ra->search_params.proposal_floor && ra->search_params.proposal_floor <= 1.0f))
+            {
+                printf("Proposal floor must be above 0, and at most 1\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Learned proposals are at least %f of the fixed one\n", ra->search_params.proposal_floor);
+        }
+        else if (strcmp(argv[i], "/coverage") == 0 && i + 1 < argc)
+        {
+            ra->min_coverage = strtof(argv[++i], NULL);
+            if (!(0.0f <= ra->min_coverage && ra->min_coverage <= 1.0f))
+            {
+                printf("Coverage must be between 0 and 1\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Attractors must cover %.2f of their bounding box on screen\n", ra->min_coverage);
+        }
+        else if (strcmp(argv[i], "/dimension") == 0 && i + 1 < argc)
+        {
+            ra->min_dimension = strtof(argv[++i], NULL);
+            if (!(0.0f <= ra->min_dimension && ra->min_dimension <= 3.0f))
+            {
+                printf("Dimension must be between 0 and 3\n");
+                ra->error = RA_ERROR_INIT_UNKNOWNARG;
+                return;
+            }
+            printf("Attractors must have a correlation dimension of at least %.2f\n", ra->min_dimension);
+        }
+        else if (strcmp(argv[i], "/stages") == 0 && i + 4 < argc)
+        {
+            ra->search_params.warmup_iterations         = (int)strtol(argv[++i], NULL, 10);
+            ra->search_params.probe_iterations          = (int)strtol(argv[++i], NULL, 10);
+            ra->search_params.lyapunov_probe_iterations = (int)strtol(argv[++i], NULL, 10);
+            ra->search_params.test_iterations           = (int)strtol(argv[++i], NULL, 10);
+            printf("Search stage budgets are %d/%d/%d/%d\n", ra->search_params.warmup_iterations,
+                ra->search_params.probe_iterations, ra->search_params.lyapunov_probe_iterations,
+                ra->search_params.test_iterations);
+        }
+        else
+        {
+            printf("Unrecognised argument: %s\n", argv[i]);
+            ra->error = RA_ERROR_INIT_UNKNOWNARG;
+            return;
+        }
+    }
+
     ra->error = RA_OK;
 }
 
@@ -194,9 +457,38 @@ void ra_print_help()
     printf("  Options:\n");
     printf("      /s - Run in screensaver mode (fullscreen, logging disabled)\n");
     printf("      /p - Run in preview mode (small window, logging enabled)\n");
+    printf("  Extras (after /s or /p):\n");
+    printf("      /serial - Search for attractors on a single GPU thread\n");
+    printf("      /cpu    - Search for attractors on a CPU worker thread\n");
+    printf("      /nocache - Don't read or write the cache of previously found attractors\n");
+    printf("      /catalog <file> - Only draw attractors from a catalog made by ra_mine\n");
+    printf("      /atlas <file> - Draw fresh candidates where a chaos atlas made by ra_mine says attractors are\n");
+    printf("      /seed <n>   - Seed the whole run, so it can be reproduced\n");
+    printf("      /replay <n> - Draw the cycle with the given (logged) seed, over and over\n");
+    printf("      /family <n> - Only use one attractor family (1 to %d, other than %d)\n", RA_FAMILY_COUNT - 1,
+        RA_FAMILY_CUSTOM);
+    printf("      /weights <w1> ... <w%d> - Share of the search each family gets, skipping family %d (default all 1)\n",
+        RA_FAMILY_BUILT_IN, RA_FAMILY_CUSTOM);
+    printf("      /caps <c1> ... <c%d> - Most candidates of each family per search, skipping family %d (0 is no cap)\n",
+        RA_FAMILY_BUILT_IN, RA_FAMILY_CUSTOM);
+    printf("      /equations <file> - Only use the attractor equations in the file (x' = ..., y' = ..., z' = ...)\n");
+    printf("      /queue <n> - Prepare n attractors ahead of time (1 to %d)\n", RA_MESH_QUEUE_MAX);
+    printf("      /slice <n> - Suitability test iterations per search thread, per frame (default %d)\n",
+        RA_SEARCH_SLICE_DEFAULT);
+    printf("      /best <n>  - Pick the best looking of n suitable attractors (1 to %d, default 1)\n", RA_BEST_OF_MAX);
+    printf("      /mutate <rate> <sigma> - Share of candidates that are mutations of recent finds, and how far they move\n");
+    printf("      /proposal <floor> - Least spread of learned fresh draws, relative to the fixed one (0 to 1, default 0.5)\n");
+    printf("      /coverage <f> - Reject attractors covering less of their bounding box on screen than this (0 to 1, default %.2f)\n",
+        RA_COVERAGE_DEFAULT);
+    printf("      /dimension <d> - Reject attractors with a lower correlation dimension (0 to 3, default %.1f)\n",
+        RA_DIMENSION_DEFAULT);
+    printf("      /stages <warmup> <probe> <lyapunov> <test> - Suitability test iteration budgets\n");
+    printf("      /warmup <window> <tolerance> - When the warm-up can stop early\n");
+    printf("      /converge <window> <tolerance> <margin> - When the full test can stop early\n");
     printf("  Correct usage:\n");
     printf("      RandomAttractors.scr /s\n");
-    printf("      RandomAttractors.scr /p\n\n");
+    printf("      RandomAttractors.scr /p\n");
+    printf("      RandomAttractors.scr /p /serial\n\n");
 }
 
 void ra_log(struct RandomAttractors *ra, const char *format, ...)
@@ -308,9 +600,21 @@ void ra_prepare_buffers(struct RandomAttractors *ra)
     //
 
     // Mesh
-    glGenBuffers(1, &ra->controls_ssbo_handle);
-    glGenBuffers(1, &ra->bounding_ssbo_handle);
+    ra->mesh_slot_count = ra->mesh_queue_depth + 1;
+    for (int i = 0; i < ra->mesh_slot_count; i++)
+    {
+        glGenBuffers(1, &ra->mesh_slots[i].controls_ssbo_handle);
+        glGenBuffers(1, &ra->mesh_slots[i].bounding_ssbo_handle);
+        glGenBuffers(1, &ra->mesh_slots[i].search_ssbo_handle);
+    }
     glGenBuffers(1, &ra->srand_ssbo_handle);
+    glGenBuffers(1, &ra->family_stats_ssbo_handle);
+    glGenBuffers(1, &ra->search_state_ssbo_handle);
+    glGenBuffers(1, &ra->orbit_ssbo_handle);
+    glGenBuffers(1, &ra->dimension_ssbo_handle);
+    glGenBuffers(1, &ra->parents_ssbo_handle);
+    glGenTextures(1, &ra->coverage_tex_handle);
+    glGenTextures(1, &ra->atlas_tex_handle);
     glGenVertexArrays(1, &ra->mesh_vao_handle);
     // Spot
     glGenBuffers(1, &ra->spot_vbo_handle);
@@ -320,11 +624,13 @@ void ra_prepare_buffers(struct RandomAttractors *ra)
     // Compile and link all shaders
     //
 
-    // Controls: CS only
-    GLuint mesh_cs_handle  = 0;
-    ra_compile_shader(ra, mesh_cs_glsl,  SHADERTYPE_CS,  &mesh_cs_handle);
+    // Controls: CS only, with the custom family's equations spliced in
+    GLuint  mesh_cs_handle = 0;
+    GLchar *mesh_cs_source = ra_splice_equations(ra, mesh_cs_glsl);
+    ra_compile_shader(ra, mesh_cs_source, SHADERTYPE_CS,  &mesh_cs_handle);
     ra_link_shader_program(ra, -1, -1, -1, mesh_cs_handle, &ra->controls_program_handle);
     glDeleteShader(mesh_cs_handle);
+    free(mesh_cs_source);
 
     // Mesh: VS -> TCS -> TES -> FS
     GLuint mesh_fs_handle  = 0;
@@ -368,37 +674,151 @@ void ra_prepare_buffers(struct RandomAttractors *ra)
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+    for (int i = 0; i < ra->mesh_slot_count; i++)
+    {
+        //
+        // Allocate attractor point vertex data
+        //
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->mesh_slots[i].controls_ssbo_handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, RA_CONTROL_BUFFER_SIZE, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        //
+        // Allocate bounding box storage buffer
+        // Size 2*vec4
+        //
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->mesh_slots[i].bounding_ssbo_handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 8 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        //
+        // Allocate search result storage buffer
+        // Per slot, so the result can be read back for the cache once the
+        // slot is on screen, long after the next search has started
+        //
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->mesh_slots[i].search_ssbo_handle);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(struct SearchResult), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // The first switch moves on to slot 0
+    ra->mesh_slot_current = ra->mesh_slot_count - 1;
+    
+    //
+    // Allocate srand storage buffer
+    // Size uint, set to the cycle seed before every dispatch
+    //
+    if (!ra->seed_fixed)
+    {
+        ra->seed = (uint32_t)time(NULL);
+    }
+    srand(ra->seed);
+    ra_log(ra, "Random seed is %u\n", ra->seed);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->srand_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &ra->seed, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
     //
-    // Allocate attractor point vertex data
+    // Allocate family statistics storage buffer
+    // Running totals, which ra_read_family_stats clears as it reads them
     //
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->controls_ssbo_handle);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, RA_CONTROL_BUFFER_SIZE, NULL, GL_DYNAMIC_DRAW);
+    struct FactoryStats family_stats = { 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->family_stats_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(family_stats), &family_stats, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
     //
-    // Allocate bounding box storage buffer
-    // Size 2*vec4
+    // Allocate search state storage buffer
+    // One SearchState per invocation, shared by every slot because only one
+    // search runs at a time
     //
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->bounding_ssbo_handle);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 8 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->search_state_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, RA_SEARCH_INVOCATIONS * sizeof(struct SearchState), NULL, GL_DYNAMIC_COPY);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    
+
     //
-    // Allocate and initialise srand storage buffer
-    // Size vec2
+    // Allocate orbit storage buffer
+    // The first RA_ORBIT_SAMPLES points of each invocation's full test, which
+    // become the winner's control points. Shared like the search state.
     //
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->srand_ssbo_handle);
-    time_t t = time(NULL);
-    srand(t);
-    ra_log(ra, "Random seed is %ld\n", t);
-    GLuint initial_srand = (GLuint)rand();
-    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &initial_srand, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->orbit_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, RA_SEARCH_INVOCATIONS * RA_ORBIT_SAMPLES * 4 * sizeof(GLfloat), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    //
+    // Allocate dimension pass storage buffer
+    // The dimension pass's indirect dispatch command, then the invocations
+    // it has to finish testing. Shared like the search state.
+    //
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->dimension_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (3 + RA_SEARCH_INVOCATIONS) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    //
+    // Allocate mutation parents storage buffer
+    // Rewritten by ra_upload_parents whenever the parents have changed
+    //
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->parents_ssbo_handle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, RA_ENGINE_PARENT_MAX * sizeof(struct MutationParent), NULL, GL_DYNAMIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
+    //
+    // Allocate coverage image
+    // One RA_COVERAGE_RESOLUTION square bitmap per invocation, 32 pixels to
+    // a texel, tiled RA_COVERAGE_COLUMNS across. The shader clears each
+    // one itself, and it's shared like the search state.
+    //
+    GLsizei coverage_width  = RA_COVERAGE_RESOLUTION / 32 * RA_COVERAGE_COLUMNS;
+    GLsizei coverage_height = RA_COVERAGE_RESOLUTION * ((RA_SEARCH_INVOCATIONS + RA_COVERAGE_COLUMNS - 1) / RA_COVERAGE_COLUMNS);
+    glBindTexture(GL_TEXTURE_2D, ra->coverage_tex_handle);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, coverage_width, coverage_height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //
+    // Pick a cached attractor for the first cycle, and load the atlas
+    //
+    ra_prepare_cache(ra);
+
+    //
+    // Allocate the atlas image, one layer for each family with an atlas
+    // (which skips RA_FAMILY_NONE), if there is one
+    //
+    if (ra->search_params.atlas)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ra->atlas_tex_handle);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, RA_ENGINE_ATLAS_SIZE, RA_ENGINE_ATLAS_SIZE, RA_ATLAS_LAYERS);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, RA_ENGINE_ATLAS_SIZE, RA_ENGINE_ATLAS_SIZE, RA_ATLAS_LAYERS,
+            GL_RED, GL_UNSIGNED_BYTE, ra->atlas.cells[RA_FAMILY_NONE + 1]);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    //
+    // Start the CPU worker on the first cycle straight away
+    //
+    if (ra->cpu_search)
+    {
+        ra->cpu_cycle    = 0;
+        ra->cpu_seed     = ra_cycle_seed(ra, ra->cpu_cycle);
+        ra->cpu_key      = 0;
+        ra->cpu_params   = ra->search_params;
+        ra->cpu_controls = malloc(RA_CONTROL_BUFFER_SIZE);
+        atomic_store(&ra->cpu_done, false);
+        atomic_store(&ra->cpu_cancel, false);
+        thrd_create(&ra->cpu_worker, ra_cpu_worker, ra);
+    }
+
+    // All done :)
+    ra_log(ra, "Buffers prepared.\n");
+}
+
+void ra_bind_mesh_vao(struct RandomAttractors *ra)
+{
     //
     // The mesh VAO gives the VS access to the CS SSBO (control points) like a
     // normal vertex buffer so RenderDoc is actually useful again.
     //
+    // This is re-run every time the queue moves on to a new slot.
+    //
     glBindVertexArray(ra->mesh_vao_handle);
     glBindBuffer(GL_ARRAY_BUFFER, ra->controls_ssbo_handle);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(struct ControlPoint), (void *)0);                    // Z,Y,Z,W
@@ -413,9 +833,6 @@ void ra_prepare_buffers(struct RandomAttractors *ra)
     glEnableVertexAttribArray(4);
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // All done :)
-    ra_log(ra, "Buffers prepared.\n");
 }
 
 void ra_prepare_textures(struct RandomAttractors *ra)
@@ -446,6 +863,27 @@ void ra_prepare_textures(struct RandomAttractors *ra)
     ra_log(ra, "Spotlight texture prepared.\n");
 }
 
+/**
+ * mesh_cs.glsl, with factory_custom() and tangent_custom() compiled from the
+ * custom family's equations (or stubs, without /equations) in place of
+ * RA_EQUATIONS_PRAGMA. The caller frees it.
+ */
+GLchar *ra_splice_equations(struct RandomAttractors *ra, const GLchar *source)
+{
+    const struct AttractorEquations *equations = ra->search_params.equations;
+
+    const char *pragma = strstr(source, RA_EQUATIONS_PRAGMA);
+    size_t      before = pragma ? (size_t)(pragma - source) : strlen(source);
+    const char *after  = pragma ? pragma + strlen(RA_EQUATIONS_PRAGMA) : "";
+    size_t      length = pragma ? ra_equations_glsl(equations, NULL, 0) : 0;
+
+    GLchar *spliced = malloc(before + length + strlen(after) + 1);
+    memcpy(spliced, source, before);
+    if (pragma) ra_equations_glsl(equations, spliced + before, length + 1);
+    strcpy(spliced + before + length, after);
+    return spliced;
+}
+
 enum RA_Error ra_compile_shader(struct RandomAttractors *ra, const GLchar *source, enum RA_ShaderType type, GLuint *handle)
 {
     int gl_shader_type = 0;
@@ -498,6 +936,24 @@ enum RA_Error ra_compile_shader(struct RandomAttractors *ra, const GLchar *sourc
     return RA_OK;
 }
 
+void ra_uniform_1i(GLuint program, const char *name, GLint value)
+{
+    GLint location = glGetUniformLocation(program, name);
+    if (location != -1)
+    {
+        glUniform1i(location, value);
+    }
+}
+
+void ra_uniform_1f(GLuint program, const char *name, GLfloat value)
+{
+    GLint location = glGetUniformLocation(program, name);
+    if (location != -1)
+    {
+        glUniform1f(location, value);
+    }
+}
+
 enum RA_Error ra_link_shader_program(struct RandomAttractors *ra, GLuint shader1, GLuint shader2, GLuint shader3, GLuint shader4, GLuint *program_handle)
 {
     *program_handle = glCreateProgram();
@@ -534,120 +990,1037 @@ enum RA_Error ra_link_shader_program(struct RandomAttractors *ra, GLuint shader1
     return RA_OK;
 }
 
-void ra_compute_new_mesh(struct RandomAttractors *ra, double uptime_secs)
+/**
+ * Find the cache file, and memory-map it to pick the attractor for the first
+ * cycle, so there's something on screen without waiting for a search.
+ */
+void ra_prepare_cache(struct RandomAttractors *ra)
 {
-    glUseProgram(ra->mesh_program_handle);
-    // Uniform: FRAGMENT_HUE_RANDOM
-    // THIS IS USED BY THE MESH, NOT BY THE COMPUTE PROGRAM, BUT IT MUST BE SYNCED WITH THE COMPUTE SHADER
-    GLuint fragment_hue_random_location = glGetUniformLocation(ra->mesh_program_handle, "FRAGMENT_HUE_RANDOM");
-    if (fragment_hue_random_location != -1)
+    if (ra->catalog_path)
     {
-        float fhr = (float) rand() / (float) RAND_MAX;
-        ra_log(ra, "Fragment randomness is %f\n", fhr);
-        glUniform1f(fragment_hue_random_location, (GLfloat) fhr);
+        if (ra_cache_open(&ra->catalog, ra->catalog_path))
+        {
+            ra_log(ra, "Loaded %zu attractor(s) from the catalog\n", ra->catalog.count);
+        }
+        else
+        {
+            ra_log(ra, "Couldn't load the catalog %s, searching instead\n", ra->catalog_path);
+        }
     }
 
-    //
-    // Compute Shader
-    //
+    if (ra->atlas_path)
+    {
+        if (ra_cache_read_atlas(ra->atlas_path, &ra->atlas))
+        {
+            ra->search_params.atlas = &ra->atlas;
+            ra_log(ra, "Loaded the atlas %s\n", ra->atlas_path);
+        }
+        else
+        {
+            ra_log(ra, "Couldn't load the atlas %s, drawing without one\n", ra->atlas_path);
+        }
+    }
 
-    glUseProgram(ra->controls_program_handle);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ra->controls_ssbo_handle);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ra->bounding_ssbo_handle);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ra->srand_ssbo_handle);
+    if (ra->cache_disabled) return;
 
-    // Uniform: PATH_COUNT
-    GLuint path_count_location = glGetUniformLocation(ra->controls_program_handle, "PATH_COUNT");
-    if (path_count_location != -1)
+    // Custom equations get their own cache, next to them
+    bool cache_path_found = ra->equations_path
+        ? ra_cache_equations_path(ra->cache_path, sizeof(ra->cache_path), ra->equations_path)
+        : ra_cache_default_path(ra->cache_path, sizeof(ra->cache_path));
+    if (!cache_path_found)
     {
-        glUniform1i(path_count_location, (GLint) RA_PATH_COUNT);
+        ra_log(ra, "Nowhere to put the attractor cache, disabling it\n");
+        ra->cache_disabled = true;
+        return;
     }
 
-    // Uniform: BEZIER_PER_PATH
-    GLuint bezier_per_path_location = glGetUniformLocation(ra->controls_program_handle, "BEZIER_PER_PATH");
-    if (bezier_per_path_location != -1)
+    // A cached first cycle would depend on what's in the file
+    if (ra->seed_fixed) return;
+
+    // What earlier runs learned about fresh draws
+    if (ra->search_params.proposal_floor < 1.0f
+        && ra_cache_proposal_path(ra->proposal_path, sizeof(ra->proposal_path), ra->cache_path)
+        && ra_cache_read_proposal(ra->proposal_path, &ra->proposal_stats))
     {
-        glUniform1i(bezier_per_path_location, (GLint) RA_BEZIER_PER_PATH);
+        ra_engine_fit_proposal(&ra->search_params, &ra->proposal_stats);
+        ra_log(ra, "Loaded the learned proposal from %s\n", ra->proposal_path);
     }
 
-    glDispatchCompute(1, 1, 1);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
-}
+    struct AttractorCache cache;
+    if (!ra_cache_open(&cache, ra->cache_path))
+    {
+        ra_log(ra, "No cached attractors in %s\n", ra->cache_path);
+        return;
+    }
 
-void ra_render(struct RandomAttractors *ra, double uptime_secs)
-{
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Start somewhere random, and take the first record that looks sane
+    size_t start = (size_t)rand() % cache.count;
+    for (size_t i = 0; i < cache.count; i++)
+    {
+        const struct AttractorRecord *record = &cache.records[(start + i) % cache.count];
+        if (!ra_record_is_drawable(ra, record)) continue;
 
-    //
-    // Compute new geometry
-    //
-    static double next_update_secs = 0.0;
-    if (uptime_secs >= next_update_secs)
+        ra->cache_startup       = *record;
+        ra->cache_startup_ready = true;
+        break;
+    }
+
+    // The newest records are the first parents, oldest first so the newest
+    // ends up first
+    size_t parents = 0;
+    size_t first   = cache.count;
+    while (first > 0 && parents < RA_ENGINE_PARENT_MAX)
     {
-        //
-        // All other rendering logic is aligned strictly to uptime_secs, so
-        // this should be too! Using a delta here would be a BAD idea because
-        // you would be guaranteed to drift 1 frame every cycle, which gets
-        // problematic after a few hours of screensaving!!
-        //
-        // We therefore set the uptime to be at the start of the next cycle
-        //
-        // It's also a little tricky because we need to make sure we don't
-        // dispatch the compute shader twice (not breaking, just inefficient),
-        // so using ceil(...)*CYCLE_SECS is out of the question.
-        //
-        next_update_secs = (floor(uptime_secs / RA_CYCLE_TIME_SECS) + 1.0) * RA_CYCLE_TIME_SECS;
-        ra_log(ra, "Computing new mesh...\n");
-        ra_compute_new_mesh(ra, uptime_secs);
-        ra_log(ra, "Mesh computed!\n");
+        parents += ra_record_is_drawable(ra, &cache.records[--first]);
+    }
+    for (size_t i = first; i < cache.count; i++)
+    {
+        if (ra_record_is_drawable(ra, &cache.records[i])) ra_add_parent(ra, &cache.records[i].candidate);
     }
 
-    //
-    // Spotlight
-    //
+    ra_log(ra, "Loaded %zu cached attractor(s) from %s\n", cache.count, ra->cache_path);
+    ra_cache_close(&cache);
+}
 
-    glUseProgram(ra->spot_program_handle);
-    glBindTexture(GL_TEXTURE_2D, ra->spot_tex_handle);
-    glBindVertexArray(ra->spot_vao_handle);
-    glDrawArrays(GL_TRIANGLES, 0, sizeof(spotlight_vertices) / (sizeof(float) * 6));
-    glBindVertexArray(0);
+/**
+ * The seed of the given cycle, which the cycle can be replayed from.
+ */
+uint32_t ra_cycle_seed(struct RandomAttractors *ra, uint32_t cycle)
+{
+    if (ra->replay) return ra->seed;
 
-    //
-    // Mesh
-    //
+    // Cycle n takes the n-th number of the host stream
+    struct AttractorRng rng;
+    ra_engine_rng_init(&rng, ra->seed, RA_HOST_STREAM);
+    ra_engine_rng_skip(&rng, cycle);
+    return ra_engine_next_uint(&rng);
+}
 
-    glDepthMask(GL_FALSE);
-    glUseProgram(ra->mesh_program_handle);
+/**
+ * FNV-1a of a buffer's contents, so replays can be checked for bit-identical
+ * output. This stalls until the GPU has finished with the buffer.
+ */
+uint32_t ra_checksum_buffer(GLuint buffer, GLsizeiptr size)
+{
+    unsigned char *contents = malloc(size);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, contents);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    // Uniform: TIME_SECS
-    GLuint time_secs_location = glGetUniformLocation(ra->mesh_program_handle, "TIME_SECS");
-    if (time_secs_location != -1)
+    uint32_t hash = 2166136261u;
+    for (GLsizeiptr i = 0; i < size; i++)
     {
-        glUniform1f(time_secs_location, uptime_secs);
+        hash = (hash ^ contents[i]) * 16777619u;
     }
 
-    // Uniform: CYCLE_TIME_SECS
-    GLuint cycle_time_secs_location = glGetUniformLocation(ra->mesh_program_handle, "CYCLE_TIME_SECS");
-    if (cycle_time_secs_location != -1)
-    {
-        glUniform1f(cycle_time_secs_location, (GLfloat) RA_CYCLE_TIME_SECS);
-    }
+    free(contents);
+    return hash;
+}
 
-    // Uniform: CYCLE_FADE_FRACTION
-    GLuint cycle_fade_fraction_location = glGetUniformLocation(ra->mesh_program_handle, "CYCLE_FADE_FRACTION");
-    if (cycle_fade_fraction_location != -1)
-    {
-        glUniform1f(cycle_fade_fraction_location, (GLfloat) RA_CYCLE_FADE_FRACTION);
+/**
+ * Whether a cached attractor can be drawn this run: custom ones only can with
+ * the equations they were found with, which the cache's path ties them to.
+ */
+bool ra_record_is_drawable(struct RandomAttractors *ra, const struct AttractorRecord *record)
+{
+    if (!ra_cache_record_is_valid(record)) return false;
+    return record->candidate.family != RA_FAMILY_CUSTOM || ra->search_params.equations != NULL;
+}
+
+/**
+ * Pick an attractor that doesn't need searching for: one from the catalog
+ * (chosen by the cycle seed), or else the cached one for the first cycle.
+ *
+ * @returns false if the next attractor has to be searched for
+ */
+bool ra_pick_known_attractor(struct RandomAttractors *ra, uint32_t seed, struct AttractorRecord *record)
+{
+    if (ra->catalog.count > 0)
+    {
+        size_t start = (size_t)seed % ra->catalog.count;
+        for (size_t i = 0; i < ra->catalog.count; i++)
+        {
+            const struct AttractorRecord *candidate = &ra->catalog.records[(start + i) % ra->catalog.count];
+            if (!ra_record_is_drawable(ra, candidate)) continue;
+
+            *record = *candidate;
+            return true;
+        }
     }
 
-    glBindVertexArray(ra->mesh_vao_handle);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ra->controls_ssbo_handle);
-    glPatchParameteri(GL_PATCH_VERTICES, 4);
-    glLineWidth(2.0f);
-    glDrawArrays(GL_PATCHES, 0, RA_CONTROLS_COUNT);
+    if (ra->cache_startup_ready)
+    {
+        *record                 = ra->cache_startup;
+        ra->cache_startup_ready = false;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Write a known attractor into the slot's SearchResult buffer, as if it had
+ * won the search stage.
+ */
+void ra_upload_search_result(struct MeshSlot *slot, const struct AttractorRecord *record)
+{
+    struct SearchResult result = {
+        .winner     = RA_SEARCH_KNOWN_WINNER,
+        .factory    = record->candidate.family,
+        .attempts   = 0,
+        .lyapunov   = record->lyapunov,
+        .anisotropy = record->anisotropy,
+        .parent     = -1,
+    };
+    memcpy(result.coeff, record->candidate.coeff, sizeof(result.coeff));
+    memcpy(result.previous, record->candidate.previous, sizeof(result.previous));
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->search_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(result), &result);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * Check the GPU's winner against the CPU engine. Its last step is always
+ * redone, which catches the spliced custom equations (or a factory) drifting
+ * from the engine's. With a fixed seed, where the family weights can't have
+ * changed since the search, it's also reseeded from its key alone.
+ */
+void ra_cross_check_winner(struct RandomAttractors *ra, struct MeshSlot *slot, const struct SearchResult *result)
+{
+    struct AttractorCandidate stepped = { .family = result->factory };
+    memcpy(stepped.coeff, result->coeff, sizeof(stepped.coeff));
+    memcpy(stepped.previous[0], result->previous[1], sizeof(stepped.previous[0]));
+    ra_engine_step_candidate(&stepped, ra->search_params.equations);
+
+    bool step_agrees = true;
+    for (int c = 0; c < 3; c++)
+    {
+        float error = fabsf(stepped.previous[0][c] - result->previous[0][c]);
+        step_agrees = step_agrees && error <= RA_CROSS_CHECK_EPSILON * fmaxf(1.0f, fabsf(stepped.previous[0][c]));
+    }
+    if (!step_agrees) ra_log(ra, "CPU and GPU DISAGREE on the last step of factory %d\n", result->factory);
+
+    if (!ra->seed_fixed || result->winner >= RA_SEARCH_KNOWN_WINNER) return;
+
+    struct AttractorCandidate candidate;
+    ra_engine_seed_key(&candidate, &ra->search_params, slot->seed, result->winner);
+
+    bool agree = candidate.family == result->factory;
+    for (int k = 0; k < RA_ENGINE_COEFF_LENGTH && agree; k++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            float error = fabsf(candidate.coeff[k][c] - result->coeff[k][c]);
+            agree       = agree && error <= RA_CROSS_CHECK_EPSILON * fmaxf(1.0f, fabsf(candidate.coeff[k][c]));
+        }
+    }
+
+    ra_log(ra, "CPU and GPU %s on candidate %u\n", agree ? "agree" : "DISAGREE", result->winner);
+}
+
+/**
+ * Make a newly found attractor the newest parent for mutations. Not done
+ * with a fixed seed, because the run would then depend on which searches
+ * had finished by the time the next one started.
+ */
+void ra_add_parent(struct RandomAttractors *ra, const struct AttractorCandidate *candidate)
+{
+    if (ra->seed_fixed || ra->search_params.mutation_rate <= 0.0f) return;
+
+    ra_engine_add_parent(&ra->search_params, candidate);
+    ra->parents_changed = true;
+}
+
+/**
+ * Learn from a newly found attractor, which must have been a fresh draw from
+ * the current proposal. Not done with a fixed seed, for the same reason as
+ * ra_add_parent.
+ */
+void ra_learn_proposal(struct RandomAttractors *ra, const struct AttractorCandidate *candidate)
+{
+    if (ra->seed_fixed || ra->search_params.proposal_floor >= 1.0f) return;
+
+    ra_engine_learn_proposal(&ra->proposal_stats, &ra->search_params, candidate);
+    ra->proposal_changed = true;
+}
+
+/**
+ * Refit the proposal if there's been something new to learn from, and save
+ * it for the next run. Only done as a search starts, like ra_upload_parents.
+ */
+void ra_fit_proposal(struct RandomAttractors *ra)
+{
+    if (!ra->proposal_changed) return;
+    ra->proposal_changed = false;
+
+    ra_engine_fit_proposal(&ra->search_params, &ra->proposal_stats);
+
+    if (ra->cache_disabled || ra->proposal_path[0] == '\0') return;
+    if (!ra_cache_write_proposal(ra->proposal_path, &ra->proposal_stats))
+    {
+        ra_log(ra, "Couldn't save the learned proposal to %s\n", ra->proposal_path);
+    }
+}
+
+/**
+ * Upload the parents to the MutationParents buffer if they've changed.
+ * Only done as a search starts, so every slice of it sees the same ones.
+ */
+void ra_upload_parents(struct RandomAttractors *ra)
+{
+    if (!ra->parents_changed) return;
+    ra->parents_changed = false;
+
+    struct MutationParent parents[RA_ENGINE_PARENT_MAX] = { 0 };
+    for (int i = 0; i < ra->search_params.parent_count; i++)
+    {
+        parents[i].factory = ra->search_params.parent_family[i];
+        memcpy(parents[i].coeff, ra->search_params.parent_coeff[i], sizeof(parents[i].coeff));
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->parents_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(parents), parents);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    ra->parents_uploaded = ra->search_params.parent_count;
+}
+
+/**
+ * Read back the attractor the slot is drawing, make it a parent if it was a
+ * fresh draw, and append it to the cache. Called once the slot is on
+ * screen, so its fence has been waited on and the read doesn't stall.
+ */
+void ra_cache_mesh(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    if (!slot->cache_result) return;
+    slot->cache_result = false;
+
+    struct SearchResult result;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->search_ssbo_handle);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(result), &result);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (result.winner == RA_SEARCH_NO_WINNER) return;
+    ra_cross_check_winner(ra, slot, &result);
+
+    struct AttractorRecord record = {
+        .candidate  = { .family = result.factory },
+        .lyapunov   = result.lyapunov,
+        .anisotropy = result.anisotropy,
+    };
+    memcpy(record.candidate.coeff, result.coeff, sizeof(record.candidate.coeff));
+    memcpy(record.candidate.previous, result.previous, sizeof(record.candidate.previous));
+
+    ra_log(ra,
+        "Found after %u attempt(s): factory=%d lyapunov=%f anisotropy=%f score=%f coverage=%f dimension=%f warmup=%d"
+        " parent=%d\n",
+        result.attempts, result.factory, result.lyapunov, result.anisotropy, result.score, result.coverage,
+        result.dimension, result.warmup, result.parent);
+
+    if (!ra_cache_record_is_valid(&record)) return;
+
+    // Only fresh draws, so the parents don't all end up one family tree,
+    // and the proposal learns what the fresh draws find. The CPU worker's
+    // finds are added by ra_upload_cpu_mesh.
+    if (result.winner < RA_SEARCH_KNOWN_WINNER && result.parent < 0)
+    {
+        ra_add_parent(ra, &record.candidate);
+        ra_learn_proposal(ra, &record.candidate);
+    }
+
+    if (ra->cache_disabled) return;
+    if (!ra_cache_append(ra->cache_path, &record, 1))
+    {
+        ra_log(ra, "Couldn't append to the attractor cache (it may be full)\n");
+    }
+}
+
+/**
+ * Scale each family's weight down by what a suitable attractor of that
+ * family costs to find: the steps spent testing its candidates, per
+ * candidate that passed. The search time then goes to the families that
+ * turn it into attractors, and one that almost never passes can't take
+ * over just because its candidates are cheap to reject. Every family is
+ * credited with RA_FAMILY_PRIOR_PASSED passes up front, so one that
+ * hasn't passed yet is tried less and less as it spends more, but never
+ * written off. Families without enough measurements yet are assumed to
+ * cost the average.
+ *
+ * Not done with a fixed seed, because the measurements depend on timing and
+ * the run would no longer be reproducible.
+ */
+void ra_reweight_families(struct RandomAttractors *ra)
+{
+    if (ra->seed_fixed) return;
+
+    double cost[RA_FAMILY_COUNT] = { 0 };
+    double cost_sum              = 0.0;
+    int    measured              = 0;
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        if (ra->family_stats.tested[family] < RA_FAMILY_MIN_TESTED) continue;
+
+        double suitable = (double)ra->family_stats.suitable[family] + RA_FAMILY_PRIOR_PASSED;
+        cost[family]    = (double)ra->family_stats.steps[family] / suitable;
+        cost_sum += cost[family];
+        measured++;
+    }
+    if (measured == 0) return;
+
+    double cost_mean = cost_sum / measured;
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        double family_cost = cost[family] > 0.0 ? cost[family] : cost_mean;
+        ra->search_params.family_weights[family] = (float)(ra->family_weights[family] * cost_mean / family_cost);
+    }
+}
+
+/**
+ * Add the FactoryStats buffer to ra->family_stats, clear it, and reweight
+ * the families. Only done while no slot is still being filled, so that the
+ * read never stalls.
+ */
+void ra_read_family_stats(struct RandomAttractors *ra)
+{
+    for (int i = 0; i < ra->mesh_slot_count; i++)
+    {
+        GLsync fence = ra->mesh_slots[i].fence;
+        if (fence && glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+    }
+
+    struct FactoryStats stats;
+    struct FactoryStats cleared = { 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->family_stats_ssbo_handle);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(stats), &stats);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(cleared), &cleared);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        ra->family_stats.tested[family] += stats.tested[family];
+        ra->family_stats.suitable[family] += stats.suitable[family];
+        ra->family_stats.steps[family] += ((uint64_t)stats.steps_high[family] << 32) | stats.steps[family];
+        ra->family_stats.warmup[family] += stats.warmup[family];
+    }
+    ra_reweight_families(ra);
+
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        double tested = (double)ra->family_stats.tested[family];
+        if (tested <= 0.0) continue;
+
+        double suitable = (double)ra->family_stats.suitable[family];
+        double steps    = (double)ra->family_stats.steps[family];
+        ra_log(ra, "Family %d: %.0f tested, %.2f%% suitable, %.0f steps per candidate, %.0f per suitable, "
+                   "%.0f warm-up, weight %f\n",
+            family, tested, 100.0 * suitable / tested, steps / tested, steps / fmax(suitable, 1.0),
+            (double)ra->family_stats.warmup[family] / tested, ra->search_params.family_weights[family]);
+    }
+}
+
+/**
+ * Runs on the CPU worker thread. Finds the next attractor and generates its
+ * control points into ra->cpu_controls, ready for ra_upload_cpu_mesh.
+ */
+int ra_cpu_worker(void *arg)
+{
+    struct RandomAttractors  *ra = arg;
+    struct AttractorCandidate candidate;
+    struct AttractorVerdict   verdict;
+
+    ra->cpu_found = ra_engine_search(&ra->cpu_params, ra->cpu_seed, &ra->cpu_key, RA_CPU_SEARCH_GROUPS,
+        &ra->cpu_cancel, &candidate, &verdict, &ra->cpu_stats);
+    if (ra->cpu_found)
+    {
+        ra_engine_generate_controls(&candidate, ra->cpu_params.equations, RA_PATH_COUNT, RA_BEZIER_PER_PATH,
+            (float *)ra->cpu_controls, ra->cpu_bounds);
+
+        ra->cpu_record.candidate  = candidate;
+        ra->cpu_record.lyapunov   = verdict.lyapunov;
+        ra->cpu_record.anisotropy = verdict.anisotropy;
+        ra->cpu_parent            = verdict.parent;
+    }
+
+    atomic_store(&ra->cpu_done, true);
+    return 0;
+}
+
+/**
+ * Once the CPU worker has finished (it usually has, long ago), upload
+ * whatever it found, and set it going on the next cycle. The render thread
+ * never waits for it.
+ *
+ * Only what it found for the slot's own cycle is used, so the cycle and
+ * seed logged for the slot are the ones it was really found with, and
+ * /replay finds it again. If the GPU has already searched for the worker's
+ * cycle, the worker's attractor is dropped.
+ *
+ * @returns false if the worker gave up, is still going, or finished too late
+ *          for this cycle, so the GPU must search instead.
+ */
+bool ra_upload_cpu_mesh(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    if (!atomic_load(&ra->cpu_done))
+    {
+        ra_log(ra, "CPU worker is still searching, so the GPU will search too\n");
+        return false;
+    }
+    thrd_join(ra->cpu_worker, NULL);
+
+    ra_engine_add_stats(&ra->family_stats, &ra->cpu_stats);
+    memset(&ra->cpu_stats, 0, sizeof(ra->cpu_stats));
+    ra_reweight_families(ra);
+
+    bool found = ra->cpu_found;
+    if (found && ra->cpu_cycle != slot->cycle)
+    {
+        ra_log(ra, "CPU worker finished cycle %u too late for it, so the GPU will search\n", ra->cpu_cycle);
+        found = false;
+    }
+    else if (found)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->controls_ssbo_handle);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, RA_CONTROL_BUFFER_SIZE, ra->cpu_controls);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->bounding_ssbo_handle);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(ra->cpu_bounds), ra->cpu_bounds);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        ra_upload_search_result(slot, &ra->cpu_record);
+        slot->cache_result = true;
+
+        if (ra->cpu_parent < 0 && ra_cache_record_is_valid(&ra->cpu_record))
+        {
+            ra_add_parent(ra, &ra->cpu_record.candidate);
+            ra_learn_proposal(ra, &ra->cpu_record.candidate);
+        }
+    }
+    else
+    {
+        ra_log(ra, "CPU worker didn't find an attractor, falling back to the GPU\n");
+    }
+
+    // Set it going on the cycle after this one
+    ra->cpu_cycle  = ra->cycle_count;
+    ra->cpu_seed   = ra_cycle_seed(ra, ra->cpu_cycle);
+    ra->cpu_key    = 0;
+    ra->cpu_params = ra->search_params;
+    atomic_store(&ra->cpu_done, false);
+    thrd_create(&ra->cpu_worker, ra_cpu_worker, ra);
+    return found;
+}
+
+/**
+ * Bind the compute program and the slot's buffers, and set every uniform
+ * the compute shader needs, ready for a dispatch.
+ */
+void ra_bind_compute(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    GLuint program = ra->controls_program_handle;
+
+    glUseProgram(program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, slot->controls_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, slot->bounding_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ra->srand_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, slot->search_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, ra->family_stats_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, ra->search_state_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, ra->orbit_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, ra->parents_ssbo_handle);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, ra->dimension_ssbo_handle);
+    glBindImageTexture(0, ra->coverage_tex_handle, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+
+    // Shared by every slot, so it's rewritten before every dispatch
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->srand_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &slot->seed);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Uniform: PATH_COUNT
+    GLuint path_count_location = glGetUniformLocation(program, "PATH_COUNT");
+    if (path_count_location != -1)
+    {
+        glUniform1i(path_count_location, (GLint) RA_PATH_COUNT);
+    }
+
+    // Uniform: BEZIER_PER_PATH
+    GLuint bezier_per_path_location = glGetUniformLocation(program, "BEZIER_PER_PATH");
+    if (bezier_per_path_location != -1)
+    {
+        glUniform1i(bezier_per_path_location, (GLint) RA_BEZIER_PER_PATH);
+    }
+
+    // Uniform: SEARCH_INVOCATIONS
+    GLuint search_invocations_location = glGetUniformLocation(program, "SEARCH_INVOCATIONS");
+    if (search_invocations_location != -1)
+    {
+        glUniform1ui(search_invocations_location, ra->serial_search ? 1 : RA_SEARCH_INVOCATIONS);
+    }
+
+    // Uniform: BEST_OF
+    GLuint best_of_location = glGetUniformLocation(program, "BEST_OF");
+    if (best_of_location != -1)
+    {
+        glUniform1ui(best_of_location, (GLuint) ra->best_of);
+    }
+
+    // Uniforms: Suitability test stage budgets
+    ra_uniform_1i(program, "SLICE_ITERATIONS", ra->search_slice_iterations);
+    ra_uniform_1i(program, "WARMUP_ITERATIONS", ra->search_params.warmup_iterations);
+    ra_uniform_1i(program, "WARMUP_WINDOW", ra->search_params.warmup_window);
+    ra_uniform_1f(program, "WARMUP_TOLERANCE", ra->search_params.warmup_tolerance);
+    ra_uniform_1i(program, "PROBE_ITERATIONS", ra->search_params.probe_iterations);
+    ra_uniform_1i(program, "LYAPUNOV_PROBE_ITERATIONS", ra->search_params.lyapunov_probe_iterations);
+    ra_uniform_1f(program, "PROBE_MIN_LYAPUNOV", ra->search_params.probe_min_lyapunov);
+    ra_uniform_1i(program, "TEST_ITERATIONS", ra->search_params.test_iterations);
+    ra_uniform_1i(program, "LYAPUNOV_WINDOW", ra->search_params.lyapunov_window);
+    ra_uniform_1f(program, "LYAPUNOV_TOLERANCE", ra->search_params.lyapunov_tolerance);
+    ra_uniform_1f(program, "LYAPUNOV_MARGIN", ra->search_params.lyapunov_margin);
+    ra_uniform_1f(program, "MIN_COVERAGE", ra->min_coverage);
+    ra_uniform_1f(program, "MIN_DIMENSION", ra->min_dimension);
+    ra_uniform_1i(program, "FORCE_ATTRACTOR_FACTORY", ra->search_params.family);
+
+    // Uniforms: Mutation, with however many parents the buffer holds
+    ra_uniform_1i(program, "PARENT_COUNT", ra->parents_uploaded);
+    ra_uniform_1f(program, "MUTATION_RATE", ra->search_params.mutation_rate);
+    ra_uniform_1f(program, "MUTATION_SIGMA", ra->search_params.mutation_sigma);
+
+    // Uniforms: ATLAS_LOADED and ATLAS_AXES, which skip RA_FAMILY_NONE
+    ra_uniform_1i(program, "ATLAS_LOADED", ra->search_params.atlas != NULL);
+    GLuint atlas_axes_location = glGetUniformLocation(program, "ATLAS_AXES");
+    if (atlas_axes_location != -1 && ra->search_params.atlas)
+    {
+        glUniform2iv(atlas_axes_location, RA_ATLAS_LAYERS, ra->atlas.axes[RA_FAMILY_NONE + 1]);
+        glBindImageTexture(1, ra->atlas_tex_handle, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8);
+    }
+
+    // Uniforms: PROPOSAL_MEAN and PROPOSAL_SIGMA
+    GLuint proposal_mean_location = glGetUniformLocation(program, "PROPOSAL_MEAN");
+    if (proposal_mean_location != -1)
+    {
+        glUniform4fv(proposal_mean_location, RA_ENGINE_PROPOSAL_LENGTH, &ra->search_params.proposal_mean[0][0]);
+    }
+    GLuint proposal_sigma_location = glGetUniformLocation(program, "PROPOSAL_SIGMA");
+    if (proposal_sigma_location != -1)
+    {
+        glUniform4fv(proposal_sigma_location, RA_ENGINE_PROPOSAL_LENGTH, &ra->search_params.proposal_sigma[0][0]);
+    }
+
+    // Uniforms: FACTORY_WEIGHTS and FACTORY_CAPS, arrays of every family but
+    // RA_FAMILY_NONE
+    GLuint factory_weights_location = glGetUniformLocation(program, "FACTORY_WEIGHTS");
+    if (factory_weights_location != -1)
+    {
+        glUniform1fv(factory_weights_location, RA_FAMILY_COUNT - 1, &ra->search_params.family_weights[RA_FAMILY_NONE + 1]);
+    }
+    GLuint factory_caps_location = glGetUniformLocation(program, "FACTORY_CAPS");
+    if (factory_caps_location != -1)
+    {
+        GLuint caps[RA_FAMILY_COUNT - 1] = { 0 };
+        for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT && !slot->caps_lifted; family++)
+        {
+            caps[family - 1] = (GLuint)ra->search_params.family_caps[family];
+        }
+        glUniform1uiv(factory_caps_location, RA_FAMILY_COUNT - 1, caps);
+    }
+}
+
+/**
+ * Dispatch one slice of the slot's search. The slot's fence is signalled
+ * once the GPU has finished it.
+ */
+void ra_dispatch_search_slice(struct RandomAttractors *ra, struct MeshSlot *slot, bool first)
+{
+    ra_bind_compute(ra, slot);
+
+    // Invocations that are still going count themselves in again
+    GLuint live = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->search_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offsetof(struct SearchResult, live), sizeof(live), &live);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // So do invocations left waiting for the dimension pass, each as one
+    // more workgroup of it
+    GLuint dimension_groups[3] = { 0, 1, 1 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ra->dimension_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(dimension_groups), dimension_groups);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    ra_uniform_1i(ra->controls_program_handle, "COMPUTE_STAGE", RA_STAGE_SEARCH);
+    ra_uniform_1i(ra->controls_program_handle, "SEARCH_FIRST_SLICE", first);
+    glDispatchCompute(ra->serial_search ? 1 : RA_SEARCH_GROUPS, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // Finish testing whatever passed everything but its correlation
+    // dimension, one workgroup per invocation waiting, which is often none
+    if (ra->min_dimension > 0.0f)
+    {
+        ra_uniform_1i(ra->controls_program_handle, "COMPUTE_STAGE", RA_STAGE_DIMENSION);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, ra->dimension_ssbo_handle);
+        glDispatchComputeIndirect(0);
+        glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    if (slot->fence) glDeleteSync(slot->fence);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->slices++;
+}
+
+/**
+ * Dispatch the generate stage, which writes the slot's control points from
+ * whatever is in its SearchResult buffer. The slot's fence is signalled once
+ * the GPU has finished it.
+ */
+void ra_dispatch_generate(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    ra_bind_compute(ra, slot);
+
+    ra_uniform_1i(ra->controls_program_handle, "COMPUTE_STAGE", RA_STAGE_GENERATE);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+    if (slot->fence) glDeleteSync(slot->fence);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/**
+ * Check whether every family that could be picked has reached its cap, in
+ * which case the search would only ever skip candidates.
+ */
+bool ra_search_is_capped(struct RandomAttractors *ra, const struct SearchResult *result)
+{
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        bool picked = (ra->search_params.family == RA_FAMILY_NONE) ? ra->search_params.family_weights[family] > 0.0f
+                                                                   : ra->search_params.family == family;
+        int  cap    = ra->search_params.family_caps[family];
+        if (picked && (cap <= 0 || result->family_attempts[family - 1] < (GLuint)cap)) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Move the slot's search on by one slice, or generate its control points
+ * once the search has finished. Does nothing until the last slice has
+ * finished, so it never stalls the frame.
+ *
+ * A search that runs to RA_SEARCH_MAX_SLICES is given up on, like the CPU
+ * engine's RA_CPU_SEARCH_GROUPS, and the slot is left empty to be refilled
+ * with the next cycle. Equations or family settings that never pass would
+ * otherwise keep it searching for ever.
+ *
+ * @returns true once the search has finished
+ */
+bool ra_continue_search(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    if (glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) return false;
+
+    // Only the counters, not the candidate
+    struct SearchResult result;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->search_ssbo_handle);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, offsetof(struct SearchResult, coeff), &result);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    //
+    // Finished once somebody has been elected and nobody is still testing a
+    // candidate with a lower key
+    //
+    if (result.winner != RA_SEARCH_NO_WINNER && result.live == 0)
+    {
+        ra_log(ra, "Search finished in %d slice(s)\n", slot->slices);
+        ra_dispatch_generate(ra, slot);
+        slot->searching = false;
+        return true;
+    }
+
+    if (!slot->caps_lifted && ra_search_is_capped(ra, &result))
+    {
+        ra_log(ra, "Every family has reached its cap, so the caps are lifted for this search\n");
+        slot->caps_lifted = true;
+    }
+
+    if (slot->slices >= RA_SEARCH_MAX_SLICES)
+    {
+        ra_log(ra, "Search gave up after %d slice(s), so cycle %u is skipped\n", slot->slices, slot->cycle);
+        slot->searching = false;
+        slot->filled    = false;
+        ra_read_family_stats(ra);
+        return false;
+    }
+
+    ra_dispatch_search_slice(ra, slot, false);
+    return false;
+}
+
+/**
+ * Fill the given slot with a new attractor. Searches carry on over the
+ * following frames (see ra_continue_search), and the slot's fence is
+ * signalled once the GPU has finished with it.
+ */
+void ra_compute_new_mesh(struct RandomAttractors *ra, struct MeshSlot *slot)
+{
+    slot->cycle = ra->cycle_count++;
+    slot->seed  = ra_cycle_seed(ra, slot->cycle);
+
+    slot->filled       = true;
+    slot->cache_result = false;
+    slot->searching    = false;
+    slot->caps_lifted  = false;
+    slot->slices       = 0;
+    if (slot->fence)
+    {
+        glDeleteSync(slot->fence);
+        slot->fence = 0;
+    }
+
+    //
+    // Catalogued or cached attractor: generate, but don't search
+    // CPU engine: upload what the worker found
+    //
+
+    struct AttractorRecord known;
+    if (ra_pick_known_attractor(ra, slot->seed, &known))
+    {
+        ra_log(ra, "Using a known attractor\n");
+        ra_upload_search_result(slot, &known);
+        ra_dispatch_generate(ra, slot);
+        return;
+    }
+    else if (ra->cpu_search && ra_upload_cpu_mesh(ra, slot))
+    {
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        return;
+    }
+
+    //
+    // Compute Shader
+    //
+    // (1) Search: thousands of invocations race to find a suitable
+    //     candidate, one slice per frame (one invocation in serial mode)
+    // (2) Generate: one workgroup picks the best of each team's winners
+    //     (see /best) and lays out the control points, once the search
+    //     has finished
+    //
+    // Reset the election first, so the slices can tell when anybody won
+    //
+    struct SearchResult search_reset = { .winner = RA_SEARCH_NO_WINNER };
+    for (int team = 0; team < RA_BEST_OF_MAX; team++) search_reset.team_winners[team] = RA_SEARCH_NO_WINNER;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot->search_ssbo_handle);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(search_reset), &search_reset);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    ra_upload_parents(ra);
+    ra_fit_proposal(ra);
+
+    slot->cache_result = true;
+    slot->searching    = true;
+    ra_dispatch_search_slice(ra, slot, true);
+}
+
+/**
+ * Whether the next attractor has to come from the CPU worker, which is
+ * still finding it. With a fixed seed the GPU mustn't race the worker, or
+ * which engine found each cycle (and so its attractor) would depend on
+ * timing, and /replay wouldn't find it again.
+ */
+bool ra_cpu_is_awaited(struct RandomAttractors *ra)
+{
+    return ra->cpu_search && ra->seed_fixed && !atomic_load(&ra->cpu_done);
+}
+
+/**
+ * Put the next prepared slot on screen. This is just a handle swap unless
+ * the queue has run dry.
+ *
+ * Never waits for a search, which may take many frames or be given up on
+ * (see ra_continue_search), so the window keeps polling events. The mesh
+ * on screen stays there instead, while ra_refill_mesh_queue carries on.
+ *
+ * @returns false if the next slot is still searching
+ */
+bool ra_switch_mesh(struct RandomAttractors *ra)
+{
+    int              next = (ra->mesh_slot_current + 1) % ra->mesh_slot_count;
+    struct MeshSlot *slot = &ra->mesh_slots[next];
+
+    if (!slot->filled)
+    {
+        if (ra_cpu_is_awaited(ra))
+        {
+            ra_log(ra, "Mesh queue is empty, but the seed is fixed, so waiting for the CPU worker...\n");
+            return false;
+        }
+
+        ra_log(ra, "Mesh queue is empty! Computing now...\n");
+        ra_compute_new_mesh(ra, slot);
+    }
+
+    if (slot->searching)
+    {
+        ra_log(ra, "Next mesh is still searching! Keeping the current one...\n");
+        return false;
+    }
+    else if (glClientWaitSync(slot->fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+        // Still correct (the memory barrier orders the draw after it), but
+        // this frame will wait for the GPU to finish it
+        ra_log(ra, "Next mesh isn't finished yet!\n");
+    }
+
+    // The old slot is free to be refilled
+    ra->mesh_slots[ra->mesh_slot_current].filled = false;
+    ra->mesh_slot_current = next;
+
+    ra->controls_ssbo_handle = slot->controls_ssbo_handle;
+    ra->bounding_ssbo_handle = slot->bounding_ssbo_handle;
+    ra_bind_mesh_vao(ra);
+    ra_cache_mesh(ra, slot);
+    ra_read_family_stats(ra);
+
+    // Not ra_log, because seeds reported from the field are the whole point
+    printf("Cycle %u has seed %u\n", slot->cycle, slot->seed);
+    if (ra->seed_fixed)
+    {
+        ra_log(ra, "Control point checksum is %08x\n", ra_checksum_buffer(slot->controls_ssbo_handle, RA_CONTROL_BUFFER_SIZE));
+    }
+
+    // FRAGMENT_HUE_RANDOM
+    // THIS IS USED BY THE MESH, NOT BY THE COMPUTE PROGRAM, BUT IT MUST BE SYNCED WITH THE COMPUTE SHADER
+    // Derived from the cycle seed, so replays are coloured the same too
+    struct AttractorRng hue_rng;
+    ra_engine_rng_init(&hue_rng, slot->seed, RA_HOST_STREAM);
+    GLfloat hue_random = ra_engine_next_float(&hue_rng);
+    ra_log(ra, "Fragment randomness is %f\n", hue_random);
+
+    // Uniform: FRAGMENT_HUE_RANDOM
+    glUseProgram(ra->mesh_program_handle);
+    GLuint fragment_hue_random_location = glGetUniformLocation(ra->mesh_program_handle, "FRAGMENT_HUE_RANDOM");
+    if (fragment_hue_random_location != -1)
+    {
+        glUniform1f(fragment_hue_random_location, hue_random);
+    }
+
+    return true;
+}
+
+/**
+ * Dispatch at most one search slice, or start filling at most one empty
+ * slot, so no single frame pays for more than a slice of one attractor.
+ */
+void ra_refill_mesh_queue(struct RandomAttractors *ra)
+{
+    for (int i = 1; i < ra->mesh_slot_count; i++)
+    {
+        struct MeshSlot *slot = &ra->mesh_slots[(ra->mesh_slot_current + i) % ra->mesh_slot_count];
+
+        // Searches share their state buffer, so the rest of the queue waits
+        if (slot->searching)
+        {
+            ra_continue_search(ra, slot);
+            return;
+        }
+        if (slot->filled) continue;
+
+        // The CPU worker is still finding this one, so try again next frame
+        if (ra->cpu_search && !atomic_load(&ra->cpu_done)) return;
+
+        ra_log(ra, "Preparing mesh %d cycle(s) ahead...\n", i);
+        ra_compute_new_mesh(ra, slot);
+        return;
+    }
+}
+
+void ra_render(struct RandomAttractors *ra, double uptime_secs)
+{
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    //
+    // Swap to the next (already computed) geometry
+    //
+    static double next_update_secs = 0.0;
+    bool          switched         = false;
+    if (uptime_secs >= next_update_secs)
+    {
+        //
+        // All other rendering logic is aligned strictly to uptime_secs, so
+        // this should be too! Using a delta here would be a BAD idea because
+        // you would be guaranteed to drift 1 frame every cycle, which gets
+        // problematic after a few hours of screensaving!!
+        //
+        // We therefore set the uptime to be at the start of the next cycle
+        //
+        // It's also a little tricky because we need to make sure we don't
+        // dispatch the compute shader twice (not breaking, just inefficient),
+        // so using ceil(...)*CYCLE_SECS is out of the question.
+        //
+        next_update_secs = (floor(uptime_secs / RA_CYCLE_TIME_SECS) + 1.0) * RA_CYCLE_TIME_SECS;
+        ra_log(ra, "Switching to next mesh...\n");
+        switched = ra_switch_mesh(ra);
+    }
+    else if (!ra->controls_ssbo_handle && !ra->mesh_slots[(ra->mesh_slot_current + 1) % ra->mesh_slot_count].searching
+             && !ra_cpu_is_awaited(ra))
+    {
+        // Nothing on screen yet, so don't wait a whole cycle for the first mesh
+        switched = ra_switch_mesh(ra);
+    }
+
+    //
+    // Spotlight
+    //
+
+    glUseProgram(ra->spot_program_handle);
+    glBindTexture(GL_TEXTURE_2D, ra->spot_tex_handle);
+    glBindVertexArray(ra->spot_vao_handle);
+    glDrawArrays(GL_TRIANGLES, 0, sizeof(spotlight_vertices) / (sizeof(float) * 6));
     glBindVertexArray(0);
+
+    //
+    // Mesh
+    //
+
+    glDepthMask(GL_FALSE);
+    glUseProgram(ra->mesh_program_handle);
+
+    // Uniform: TIME_SECS
+    GLuint time_secs_location = glGetUniformLocation(ra->mesh_program_handle, "TIME_SECS");
+    if (time_secs_location != -1)
+    {
+        glUniform1f(time_secs_location, uptime_secs);
+    }
+
+    // Uniform: CYCLE_TIME_SECS
+    GLuint cycle_time_secs_location = glGetUniformLocation(ra->mesh_program_handle, "CYCLE_TIME_SECS");
+    if (cycle_time_secs_location != -1)
+    {
+        glUniform1f(cycle_time_secs_location, (GLfloat) RA_CYCLE_TIME_SECS);
+    }
+
+    // Uniform: CYCLE_FADE_FRACTION
+    GLuint cycle_fade_fraction_location = glGetUniformLocation(ra->mesh_program_handle, "CYCLE_FADE_FRACTION");
+    if (cycle_fade_fraction_location != -1)
+    {
+        glUniform1f(cycle_fade_fraction_location, (GLfloat) RA_CYCLE_FADE_FRACTION);
+    }
+
+    // Only the spotlight until the first mesh is ready
+    if (ra->controls_ssbo_handle)
+    {
+        glBindVertexArray(ra->mesh_vao_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ra->controls_ssbo_handle);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ra->bounding_ssbo_handle);
+        glPatchParameteri(GL_PATCH_VERTICES, 4);
+        glLineWidth(2.0f);
+        glDrawArrays(GL_PATCHES, 0, RA_CONTROLS_COUNT);
+        glBindVertexArray(0);
+    }
     glDepthMask(GL_TRUE);
+
+    //
+    // Top up the look-ahead queue after drawing, but never on the same frame
+    // as a switch, so the switch costs no more than a normal frame
+    //
+    if (!switched) ra_refill_mesh_queue(ra);
 }
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include "attractor_cache.h"
+#include "attractor_engine.h"
 
 enum RA_Error
 {
@@ -23,6 +29,35 @@ enum RA_ShaderType
     SHADERTYPE_TES = 5000
 };
 
+#define RA_MESH_QUEUE_MAX (8)
+#define RA_BEST_OF_MAX    (64)  // MUST MATCH BEST_OF_MAX (local_size_x) IN mesh_cs.glsl
+#define RA_ATLAS_LAYERS   (RA_FAMILY_COUNT - 1)  // ATLAS_AXES in mesh_cs.glsl, which skips RA_FAMILY_NONE
+
+/**
+ * One set of mesh buffers in the look-ahead queue. Each slot is filled by the
+ * compute shader (or the CPU worker) while another slot is on screen.
+ */
+struct MeshSlot
+{
+    GLuint   controls_ssbo_handle;
+    GLuint   bounding_ssbo_handle;
+    /** The attractor drawn from this slot, as a SearchResult */
+    GLuint   search_ssbo_handle;
+    /** Signalled once the GPU has finished filling the buffers */
+    GLsync   fence;
+    uint32_t cycle;
+    /** Everything random about the cycle derives from this */
+    uint32_t seed;
+    bool     filled;
+    /** Append the attractor to the cache once it's on screen */
+    bool     cache_result;
+    /** Still searching, one slice per frame, before it can generate */
+    bool     searching;
+    /** Every family reached its FACTORY_CAPS, so they're ignored */
+    bool     caps_lifted;
+    int      slices;
+};
+
 struct RandomAttractors
 {
     enum RA_Error error;
@@ -32,9 +67,89 @@ struct RandomAttractors
 
     // Bezier control points 
     GLuint controls_program_handle;
-    GLuint controls_ssbo_handle;
-    GLuint bounding_ssbo_handle;
+    GLuint controls_ssbo_handle; // Of the slot on screen
+    GLuint bounding_ssbo_handle; // Of the slot on screen
     GLuint srand_ssbo_handle;
+    GLuint search_state_ssbo_handle;
+    GLuint orbit_ssbo_handle;
+    GLuint dimension_ssbo_handle;
+    GLuint coverage_tex_handle;
+    bool   serial_search;
+    int    best_of;
+    float  min_coverage;
+    float  min_dimension;
+    int    search_slice_iterations;
+
+    // Suitability test budgets, shared by the GPU and CPU searches
+    struct AttractorSearchParams search_params;
+
+    // Family weights (/weights), before they're scaled by what each family
+    // costs to test, which is measured by both searches
+    float                       family_weights[RA_FAMILY_COUNT];
+    GLuint                      family_stats_ssbo_handle;
+    struct AttractorFamilyStats family_stats;
+
+    // Mutation (/mutate): the parents live in search_params, and are
+    // uploaded at the start of each search
+    GLuint parents_ssbo_handle;
+    int    parents_uploaded;  // PARENT_COUNT
+    bool   parents_changed;
+
+    // Learned proposal (/proposal): fitted into search_params at the start
+    // of each search, and saved next to the cache
+    struct AttractorProposalStats proposal_stats;
+    char                          proposal_path[RA_CACHE_PATH_LENGTH];
+    bool                          proposal_changed;
+
+    // Reproducibility (/seed, /replay)
+    uint32_t seed;        // Of the whole run, or of every cycle when replaying
+    bool     seed_fixed;
+    bool     replay;
+    uint32_t cycle_count; // Cycles computed so far
+
+    // CPU attractor engine (/cpu)
+    bool                   cpu_search;
+    bool                   cpu_found;
+    thrd_t                 cpu_worker;
+    atomic_bool            cpu_done;  // Set by the worker as it returns, so it can be joined
+    atomic_bool            cpu_cancel; // Set on shutdown, so the worker returns without finishing
+    uint32_t               cpu_cycle; // The cycle the worker was seeded for
+    uint32_t               cpu_seed;
+    uint32_t               cpu_key;   // Next candidate key, as in mesh_cs.glsl
+    int                    cpu_parent;
+    // The worker's own copies, so nothing is shared while it runs
+    struct AttractorSearchParams cpu_params;
+    struct AttractorFamilyStats  cpu_stats;
+    struct AttractorRecord cpu_record;
+    struct ControlPoint   *cpu_controls;
+    GLfloat                cpu_bounds[2][4];
+
+    // Attractor cache (disabled by /nocache)
+    bool                   cache_disabled;
+    char                   cache_path[RA_CACHE_PATH_LENGTH];
+    struct AttractorRecord cache_startup;
+    bool                   cache_startup_ready;
+
+    // Catalog from ra_mine (/catalog), mapped for the whole run
+    const char           *catalog_path;
+    struct AttractorCache catalog;
+
+    // Chaos atlas from ra_mine (/atlas), which search_params points at
+    // once it's loaded
+    const char           *atlas_path;
+    struct AttractorAtlas atlas;
+    GLuint                atlas_tex_handle;
+
+    // The custom family's equations (/equations), which search_params points
+    // at, and which are spliced into mesh_cs.glsl
+    const char               *equations_path;
+    struct AttractorEquations equations;
+
+    // Look-ahead mesh queue: 1 slot on screen + mesh_queue_depth prepared
+    int             mesh_queue_depth;
+    int             mesh_slot_count;
+    int             mesh_slot_current;
+    struct MeshSlot mesh_slots[RA_MESH_QUEUE_MAX + 1];
 
     // Mesh
     GLuint mesh_program_handle;
@@ -53,6 +168,88 @@ struct ControlPoint
     GLfloat data[4];
 };
 
+/**
+ * Mirrors the SearchResult buffer in mesh_cs.glsl (std430)
+ */
+struct SearchResult
+{
+    GLuint  winner;
+    GLint   factory;
+    GLuint  attempts;
+    GLfloat lyapunov;
+    GLfloat anisotropy;
+    GLuint  live;
+    GLfloat score;
+    GLfloat coverage;
+    GLfloat dimension;
+    GLint   warmup;
+    GLint   parent;
+    GLuint  _padding[1];
+    GLuint  family_attempts[RA_FAMILY_COUNT - 1];
+    _Alignas(16) GLfloat coeff[RA_ENGINE_COEFF_LENGTH][4];  // vec4s are 16-byte aligned in std430
+    GLfloat previous[10][4];
+    GLuint  team_winners[RA_BEST_OF_MAX];
+};
+
+/**
+ * Mirrors SearchState in mesh_cs.glsl (std430). The host only needs its size.
+ */
+struct SearchState
+{
+    GLfloat coeff[RA_ENGINE_COEFF_LENGTH][4];
+    GLfloat previous[10][4];
+    GLfloat tangent[4];
+    GLfloat cov[3][4];
+    GLfloat mean[4];
+    GLfloat box_minimum[4];
+    GLfloat box_maximum[4];
+    GLfloat window[4];
+    GLfloat cycle_point[4];
+    GLfloat settle_minimum[4];
+    GLfloat settle_maximum[4];
+    GLuint  rng_counter;
+    GLint   factory;
+    GLuint  key;
+    GLuint  steps;
+    GLint   stage;
+    GLint   iteration;
+    GLfloat lyapunov;
+    GLfloat window_lyapunov;
+    GLfloat seeded_lyapunov;
+    GLfloat seeded_anisotropy;
+    GLuint  occupancy[2];
+    GLfloat seeded_score;
+    GLuint  coverage;
+    GLfloat seeded_coverage;
+    GLfloat seeded_dimension;
+    GLint   cycle_power;
+    GLint   cycle_length;
+    GLint   warmup;
+    GLint   parent;
+};
+
+/**
+ * Mirrors MutationParent in mesh_cs.glsl (std430)
+ */
+struct MutationParent
+{
+    GLfloat coeff[RA_ENGINE_COEFF_LENGTH][4];
+    GLint   factory;
+    GLuint  _padding[3];
+};
+
+/**
+ * Mirrors the FactoryStats buffer in mesh_cs.glsl (std430)
+ */
+struct FactoryStats
+{
+    GLuint tested[RA_FAMILY_COUNT];
+    GLuint suitable[RA_FAMILY_COUNT];
+    GLuint steps[RA_FAMILY_COUNT];      // Low and high halves of 64-bit counts
+    GLuint steps_high[RA_FAMILY_COUNT];
+    GLuint warmup[RA_FAMILY_COUNT];
+};
+
 void          ra_parse_args(struct RandomAttractors *mdbrt, int argc, char *argv[]);
 void          ra_print_help();
 void          ra_log(struct RandomAttractors *ra, const char *format, ...);
@@ -61,7 +258,35 @@ void          _callback_ra_framebuffer_size(GLFWwindow *window, int width, int h
 void          ra_prepare_buffers(struct RandomAttractors *ra);
 void          ra_prepare_textures(struct RandomAttractors *ra);
 enum RA_Error ra_compile_shader(struct RandomAttractors *ra, const GLchar *source, enum RA_ShaderType type, GLuint *handle);
+GLchar       *ra_splice_equations(struct RandomAttractors *ra, const GLchar *source);
+void          ra_uniform_1i(GLuint program, const char *name, GLint value);
+void          ra_uniform_1f(GLuint program, const char *name, GLfloat value);
 enum RA_Error ra_link_shader_program(
     struct RandomAttractors *ra, GLuint shader1, GLuint shader2, GLuint shader3, GLuint shader4, GLuint *program_handle);
-void ra_compute_next_step(struct RandomAttractors *ra);
+void ra_prepare_cache(struct RandomAttractors *ra);
+uint32_t ra_cycle_seed(struct RandomAttractors *ra, uint32_t cycle);
+uint32_t ra_checksum_buffer(GLuint buffer, GLsizeiptr size);
+bool ra_record_is_drawable(struct RandomAttractors *ra, const struct AttractorRecord *record);
+bool ra_pick_known_attractor(struct RandomAttractors *ra, uint32_t seed, struct AttractorRecord *record);
+void ra_upload_search_result(struct MeshSlot *slot, const struct AttractorRecord *record);
+void ra_cross_check_winner(struct RandomAttractors *ra, struct MeshSlot *slot, const struct SearchResult *result);
+void ra_cache_mesh(struct RandomAttractors *ra, struct MeshSlot *slot);
+void ra_add_parent(struct RandomAttractors *ra, const struct AttractorCandidate *candidate);
+void ra_upload_parents(struct RandomAttractors *ra);
+void ra_learn_proposal(struct RandomAttractors *ra, const struct AttractorCandidate *candidate);
+void ra_fit_proposal(struct RandomAttractors *ra);
+void ra_reweight_families(struct RandomAttractors *ra);
+void ra_read_family_stats(struct RandomAttractors *ra);
+int  ra_cpu_worker(void *arg);
+bool ra_upload_cpu_mesh(struct RandomAttractors *ra, struct MeshSlot *slot);
+void ra_bind_mesh_vao(struct RandomAttractors *ra);
+void ra_bind_compute(struct RandomAttractors *ra, struct MeshSlot *slot);
+void ra_dispatch_search_slice(struct RandomAttractors *ra, struct MeshSlot *slot, bool first);
+void ra_dispatch_generate(struct RandomAttractors *ra, struct MeshSlot *slot);
+bool ra_search_is_capped(struct RandomAttractors *ra, const struct SearchResult *result);
+bool ra_continue_search(struct RandomAttractors *ra, struct MeshSlot *slot);
+void ra_compute_new_mesh(struct RandomAttractors *ra, struct MeshSlot *slot);
+bool ra_cpu_is_awaited(struct RandomAttractors *ra);
+bool ra_switch_mesh(struct RandomAttractors *ra);
+void ra_refill_mesh_queue(struct RandomAttractors *ra);
 void ra_render(struct RandomAttractors *ra, double uptime_secs);
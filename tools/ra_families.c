@@ -0,0 +1,467 @@
+//
+// ra_families: generates each attractor family's code from its declaration
+// in attractor_families.h. CMake builds and runs it when the project is
+// configured, as
+//
+//     ra_families <families.glsl> <kernels.glsl> <attractor_kernels.h>
+//
+// - families.glsl: the FACTORY_* constants and draw tables, which replace
+//   "#pragma attractor_families" in the shaders
+// - kernels.glsl: every family's factory, tangent and flow functions, and
+//   the dispatch between them, which replace "#pragma attractor_kernels"
+// - attractor_kernels.h: the same functions in C for the CPU engine, and
+//   RA_KERNELS, which says which each family uses
+//
+// The equations are compiled by attractor_equations.c, the same compiler
+// /equations uses, into straight-line code with no branches. Families with
+// the same equations share a kernel, and so a case of the dispatch, so a
+// family that only differs in how it's drawn costs the GPU no divergence.
+//
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attractor_equations.h"
+#include "attractor_families.h"
+
+#define RA_FAMILIES_MAX_KERNELS (32)
+
+struct Family
+{
+    const char *name;
+    int         coefficients;
+    int         components;
+    double      spread;
+    bool        gaussian;
+    bool        flow;
+    const char *equations;  // NULL for the custom family's, which the host compiles
+    int         kernel;     // Index into kernels[]
+    // Where the family's coefficients are, or would be, in PROPOSAL_* and
+    // UNIFORM_*
+    int proposal_offset;
+    int uniform_offset;
+    // Its starting box
+    double low[3], high[3];
+};
+
+struct Kernel
+{
+    char                      name[64];  // Lower case, as in factory_<name>()
+    const struct Family      *family;    // The first that uses it, which names it
+    struct AttractorEquations equations;
+};
+
+struct UniformDraw
+{
+    const char *name;
+    int         first, last;
+    double      low, high;
+    int         steps;
+};
+
+struct Start
+{
+    const char *name;
+    double      low[3], high[3];
+};
+
+#define RA_FAMILIES_FAMILY(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME)                    \
+    { #NAME, COEFFICIENTS, COMPONENTS, SPREAD, RA_DRAW_##DRAW == RA_DRAW_GAUSSIAN,                 \
+        RA_TIME_##TIME == RA_TIME_FLOW, RA_EQUATIONS_##NAME, 0, 0, 0, { 0 }, { 0 } },
+#define RA_FAMILIES_UNIFORM(NAME, FIRST, LAST, LOW, HIGH, STEPS) \
+    { #NAME, FIRST, LAST, LOW, HIGH, STEPS },
+#define RA_FAMILIES_START(NAME, LOW_X, LOW_Y, LOW_Z, HIGH_X, HIGH_Y, HIGH_Z) \
+    { #NAME, { LOW_X, LOW_Y, LOW_Z }, { HIGH_X, HIGH_Y, HIGH_Z } },
+
+static struct Family families[] = { RA_FAMILIES(RA_FAMILIES_FAMILY) };
+static const struct UniformDraw uniform_draws[] = { RA_UNIFORM_DRAWS(RA_FAMILIES_UNIFORM) };
+static const struct Start starts[] = { RA_STARTS(RA_FAMILIES_START) };
+
+#define RA_FAMILIES_COUNT ((int)(sizeof(families) / sizeof(families[0])))
+
+static struct Kernel kernels[RA_FAMILIES_MAX_KERNELS];
+static int           kernel_count;
+
+static void ra_families_fail(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "ra_families: ");
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(EXIT_FAILURE);
+}
+
+static struct Family *ra_families_find(const char *name)
+{
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        if (strcmp(families[i].name, name) == 0) return &families[i];
+    }
+    ra_families_fail("%s isn't in RA_FAMILIES", name);
+    return NULL;
+}
+
+/**
+ * A float literal GLSL reads as the same float C does
+ */
+static const char *ra_families_float(double value, char text[32])
+{
+    snprintf(text, 32, "%.9g", value);
+    if (strpbrk(text, ".e") == NULL) strcat(text, ".0");
+    return text;
+}
+
+/**
+ * Compile each family's equations, sharing a kernel between families whose
+ * equations are the same, and check they only use coefficients the family
+ * draws
+ */
+static void ra_families_compile(void)
+{
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        struct Family *family = &families[i];
+
+        family->kernel = -1;
+        for (int k = 0; k < kernel_count && family->kernel < 0; k++)
+        {
+            const char *equations = kernels[k].family->equations;
+            bool same = (equations == NULL || family->equations == NULL)
+                ? equations == family->equations
+                : strcmp(equations, family->equations) == 0;
+            if (same && kernels[k].family->flow == family->flow) family->kernel = k;
+        }
+        if (family->kernel >= 0) continue;
+
+        if (kernel_count == RA_FAMILIES_MAX_KERNELS) ra_families_fail("too many kernels");
+        struct Kernel *kernel = &kernels[kernel_count];
+        kernel->family        = family;
+        for (int c = 0; family->name[c] != '\0' && c < (int)sizeof(kernel->name) - 1; c++)
+            kernel->name[c] = (char)tolower((unsigned char)family->name[c]);
+        family->kernel = kernel_count++;
+
+        if (family->equations == NULL) continue;
+
+        char error[RA_EQUATIONS_ERROR_LENGTH];
+        if (!ra_equations_parse(&kernel->equations, family->equations, error, sizeof(error)))
+            ra_families_fail("RA_EQUATIONS_%s: %s", family->name, error);
+    }
+
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        const struct Family *family = &families[i];
+        if (family->coefficients * 3 > RA_EQUATIONS_MAX_COEFFICIENTS)
+            ra_families_fail("%s has more coefficients than COEFF", family->name);
+
+        uint32_t used = kernels[family->kernel].equations.coefficients;
+        for (int c = 0; c < RA_EQUATIONS_MAX_COEFFICIENTS; c++)
+        {
+            bool drawn = c / 3 < family->coefficients && c % 3 < family->components;
+            if ((used & (1u << c)) && !drawn)
+                ra_families_fail("%s's equations use a coefficient it doesn't draw", family->name);
+        }
+    }
+}
+
+/**
+ * Lay out PROPOSAL_* and UNIFORM_*, and check the uniform draws cover each
+ * uniform family's coefficients in order
+ */
+static void ra_families_lay_out(int *proposal_length, int *uniform_length)
+{
+    *proposal_length = 0;
+    *uniform_length  = 0;
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        struct Family *family   = &families[i];
+        family->proposal_offset = *proposal_length;
+        family->uniform_offset  = *uniform_length;
+        *(family->gaussian ? proposal_length : uniform_length) += family->coefficients;
+
+        int next = 0;
+        for (size_t d = 0; d < sizeof(uniform_draws) / sizeof(uniform_draws[0]); d++)
+        {
+            const struct UniformDraw *draw = &uniform_draws[d];
+            if (ra_families_find(draw->name) != family) continue;
+
+            if (family->gaussian)
+                ra_families_fail("%s is GAUSSIAN, but has uniform draws", draw->name);
+            if (draw->first != next || draw->last < draw->first)
+                ra_families_fail("%s's uniform draws are out of order", draw->name);
+            next = draw->last + 1;
+        }
+        if (!family->gaussian && next != family->coefficients)
+            ra_families_fail("%s's uniform draws don't cover its coefficients", family->name);
+
+        for (int c = 0; c < 3; c++)
+        {
+            family->low[c]  = -0.5;
+            family->high[c] = 0.5;
+        }
+    }
+
+    for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++)
+    {
+        struct Family *family = ra_families_find(starts[s].name);
+        memcpy(family->low, starts[s].low, sizeof(family->low));
+        memcpy(family->high, starts[s].high, sizeof(family->high));
+    }
+}
+
+static void ra_families_write_constants(FILE *file, int proposal_length, int uniform_length)
+{
+    char number[32];
+
+    int coeff_length = 0;
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        if (families[i].coefficients > coeff_length) coeff_length = families[i].coefficients;
+    }
+
+    fprintf(file, "const int FACTORY_COUNT = %d;\n", RA_FAMILIES_COUNT);
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "const int FACTORY_%s = %d;\n", families[i].name, i + 1);
+
+    fprintf(file, "const int FACTORY_COEFFICIENTS[FACTORY_COUNT] = int[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%d", i ? ", " : "", families[i].coefficients);
+    fprintf(file, ");\nconst int FACTORY_COMPONENTS[FACTORY_COUNT] = int[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%d", i ? ", " : "", families[i].components);
+    fprintf(file, ");\nconst float FACTORY_SPREAD[FACTORY_COUNT] = float[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%s", i ? ", " : "", ra_families_float(families[i].spread, number));
+    fprintf(file, ");\nconst bool FACTORY_GAUSSIAN[FACTORY_COUNT] = bool[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%s", i ? ", " : "", families[i].gaussian ? "true" : "false");
+    fprintf(file, ");\nconst int FACTORY_PROPOSAL_OFFSET[FACTORY_COUNT] = int[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%d", i ? ", " : "", families[i].proposal_offset);
+    fprintf(file, ");\nconst int FACTORY_UNIFORM_OFFSET[FACTORY_COUNT] = int[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%d", i ? ", " : "", families[i].uniform_offset);
+    fprintf(file, ");\nconst bool FACTORY_FLOW[FACTORY_COUNT] = bool[](");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        fprintf(file, "%s%s", i ? ", " : "", families[i].flow ? "true" : "false");
+    for (int bound = 0; bound < 2; bound++)
+    {
+        fprintf(file, ");\nconst vec3 FACTORY_START_%s[FACTORY_COUNT] = vec3[](",
+            bound ? "HIGH" : "LOW");
+        for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        {
+            const double *corner = bound ? families[i].high : families[i].low;
+            fprintf(file, "%svec3(", i ? ", " : "");
+            for (int c = 0; c < 3; c++)
+                fprintf(file, "%s%s", c ? ", " : "", ra_families_float(corner[c], number));
+            fprintf(file, ")");
+        }
+    }
+    fprintf(file, ");\nconst int PROPOSAL_LENGTH = %d;\n", proposal_length);
+    fprintf(file, "const int COEFF_LENGTH = %d;\n", coeff_length);
+
+    // Every uniform coefficient's range, padded so the arrays aren't empty
+    int length = uniform_length > 0 ? uniform_length : 1;
+    fprintf(file, "const int UNIFORM_LENGTH = %d;\n", length);
+    const char *arrays[3] = { "float UNIFORM_LOW", "float UNIFORM_HIGH", "int UNIFORM_STEPS" };
+    for (int a = 0; a < 3; a++)
+    {
+        fprintf(file, "const %s[UNIFORM_LENGTH] = %s[](", arrays[a], a < 2 ? "float" : "int");
+        int written = 0;
+        for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+        {
+            for (size_t d = 0; d < sizeof(uniform_draws) / sizeof(uniform_draws[0]); d++)
+            {
+                const struct UniformDraw *draw = &uniform_draws[d];
+                if (strcmp(draw->name, families[i].name) != 0) continue;
+
+                for (int k = draw->first; k <= draw->last; k++)
+                {
+                    if (a < 2)
+                        ra_families_float(a == 0 ? draw->low : draw->high, number);
+                    else
+                        snprintf(number, sizeof(number), "%d", draw->steps);
+                    fprintf(file, "%s%s", written++ ? ", " : "", number);
+                }
+            }
+        }
+        if (written == 0) fprintf(file, a < 2 ? "0.0" : "0");
+        fprintf(file, ");\n");
+    }
+}
+
+static void ra_families_write_kernel(FILE *file, const struct Kernel *kernel, bool glsl)
+{
+    const struct AttractorEquations *equations = &kernel->equations;
+    bool                             flow      = kernel->family->flow;
+
+    size_t length = glsl ? ra_equations_glsl_kernel(equations, kernel->name, flow, NULL, 0)
+                         : ra_equations_c_kernel(equations, kernel->name, flow, NULL, 0);
+    char  *code   = malloc(length + 1);
+    if (code == NULL) ra_families_fail("out of memory");
+
+    if (glsl)
+        ra_equations_glsl_kernel(equations, kernel->name, flow, code, length + 1);
+    else
+        ra_equations_c_kernel(equations, kernel->name, flow, code, length + 1);
+    fprintf(file, "// RA_EQUATIONS_%s\n%s\n", kernel->family->name, code);
+    free(code);
+}
+
+/**
+ * The case labels of every family that uses the kernel
+ */
+static void ra_families_write_cases(FILE *file, int kernel)
+{
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        if (families[i].kernel == kernel)
+            fprintf(file, "        case FACTORY_%s:\n", families[i].name);
+    }
+}
+
+static void ra_families_write_glsl_kernels(FILE *file)
+{
+    for (int k = 0; k < kernel_count; k++)
+    {
+        if (kernels[k].family->equations) ra_families_write_kernel(file, &kernels[k], true);
+    }
+
+    // Flows are told apart by their first family's FACTORY_<NAME>
+    const char *flow_functions[2][2] = {
+        { "vec3 flow_derivative(int flow, vec3 p)", "derivative_%s(p);\n" },
+        { "vec3 flow_tangent(int flow, vec3 p, vec3 w)", "tangent_%s(p, w);\n" },
+    };
+    for (int f = 0; f < 2; f++)
+    {
+        fprintf(file, "%s\n{\n    switch (flow)\n    {\n        default:\n", flow_functions[f][0]);
+        bool any = false;
+        for (int k = 0; k < kernel_count; k++)
+        {
+            if (!kernels[k].family->flow) continue;
+
+            fprintf(file, "        case FACTORY_%s:\n            return ", kernels[k].family->name);
+            fprintf(file, flow_functions[f][1], kernels[k].name);
+            any = true;
+        }
+        if (!any) fprintf(file, "            return vec3(0.0);\n");
+        fprintf(file, "    }\n}\n\n");
+    }
+
+    fprintf(file,
+        "/**\n"
+        " * The bound factory's next point from PREVIOUS[0]\n"
+        " */\n"
+        "vec4 factory_next()\n{\n    switch (ATTRACTOR_FACTORY)\n    {\n        default:\n");
+    for (int k = 0; k < kernel_count; k++)
+    {
+        ra_families_write_cases(file, k);
+        if (kernels[k].family->flow)
+            fprintf(file, "            return integrate_flow(FACTORY_%s);\n",
+                kernels[k].family->name);
+        else
+            fprintf(file, "            return factory_%s();\n", kernels[k].name);
+    }
+    fprintf(file, "    }\n}\n\n");
+
+    fprintf(file,
+        "/**\n"
+        " * factory_next(), also replacing v with J * v, where J is the bound\n"
+        " * factory's Jacobian at PREVIOUS[0]. A flow's carries v through the same\n"
+        " * steps as the orbit, as its tangent can't be found from PREVIOUS[0] alone.\n"
+        " */\n"
+        "vec4 factory_tangent_next(inout vec3 v)\n{\n    switch (ATTRACTOR_FACTORY)\n    {\n"
+        "        default:\n");
+    for (int k = 0; k < kernel_count; k++)
+    {
+        ra_families_write_cases(file, k);
+        if (kernels[k].family->flow)
+        {
+            fprintf(file, "            return integrate_flow_tangent(FACTORY_%s, v);\n",
+                kernels[k].family->name);
+        }
+        else
+        {
+            fprintf(file, "            v = tangent_%s(v);\n            return factory_%s();\n",
+                kernels[k].name, kernels[k].name);
+        }
+    }
+    fprintf(file, "    }\n}\n");
+}
+
+static void ra_families_write_c_kernels(FILE *file)
+{
+    fprintf(file,
+        "#pragma once\n\n"
+        "//\n"
+        "// Generated by tools/ra_families.c from attractor_families.h, when the\n"
+        "// project is configured, so don't edit it. Every kernel takes its\n"
+        "// coefficients with a stride, like the engine's factories.\n"
+        "//\n\n"
+        "#include <math.h>\n\n");
+
+    for (int k = 0; k < kernel_count; k++)
+    {
+        if (kernels[k].family->equations) ra_families_write_kernel(file, &kernels[k], false);
+    }
+
+    fprintf(file,
+        "// Each family's kernel, in ATTRACTOR_FACTORY order, as\n"
+        "// KERNEL(name, function, TIME), where TIME is MAP, FLOW or EQUATIONS\n"
+        "// for the custom family, which runs /equations (see attractor_equations.h)\n"
+        "#define RA_KERNELS(KERNEL)");
+    for (int i = 0; i < RA_FAMILIES_COUNT; i++)
+    {
+        const struct Kernel *kernel = &kernels[families[i].kernel];
+
+        char name[64] = { 0 };
+        for (int c = 0; families[i].name[c] != '\0' && c < (int)sizeof(name) - 1; c++)
+            name[c] = (char)tolower((unsigned char)families[i].name[c]);
+
+        if (kernel->family->equations == NULL)
+            fprintf(file, " \\\n    KERNEL(%s, ra_equations, EQUATIONS)", name);
+        else
+            fprintf(file, " \\\n    KERNEL(%s, ra_kernel_%s, %s)", name, kernel->name,
+                families[i].flow ? "FLOW" : "MAP");
+    }
+    fprintf(file, "\n");
+}
+
+static FILE *ra_families_open(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL) ra_families_fail("couldn't write %s", path);
+    return file;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        fprintf(stderr,
+            "Usage: ra_families <families.glsl> <kernels.glsl> <attractor_kernels.h>\n");
+        return EXIT_FAILURE;
+    }
+
+    int proposal_length, uniform_length;
+    ra_families_compile();
+    ra_families_lay_out(&proposal_length, &uniform_length);
+
+    FILE *file = ra_families_open(argv[1]);
+    ra_families_write_constants(file, proposal_length, uniform_length);
+    fclose(file);
+
+    file = ra_families_open(argv[2]);
+    ra_families_write_glsl_kernels(file);
+    fclose(file);
+
+    file = ra_families_open(argv[3]);
+    ra_families_write_c_kernels(file);
+    fclose(file);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,657 @@
+//
+// ra_mine: tests millions of candidates offline with the CPU attractor
+// engine, and writes the best of them to a catalog that the screensaver can
+// draw from with /catalog, so it never has to search at all.
+//
+// Lane groups are handed out to one worker per core in contiguous ranges.
+// Workers claim small chunks from the front of their own range, and when
+// that runs dry they steal the back half of somebody else's.
+//
+// With /atlas it also maps where in coefficient space every candidate it
+// tested passed or failed, and writes a chaos atlas for the screensaver's
+// /atlas, so its searches mostly draw where attractors are.
+//
+// ra_mine /selftest checks that the engine's lane groups agree exactly with
+// the candidates they stand for, see ra_mine_selftest().
+//
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "attractor_cache.h"
+#include "attractor_engine.h"
+
+#define RA_MINE_MAX_THREADS     (256)
+#define RA_MINE_CHUNK_GROUPS    (64)        // Lane groups claimed at a time
+#define RA_MINE_DEFAULT_GROUPS  (1000000)
+#define RA_MINE_DEFAULT_KEEP    (1024)
+#define RA_MINE_SELFTEST_GROUPS (200)       // Lane groups per family for /selftest
+#define RA_MINE_SELFTEST_SEED   (1)
+//
+// A real point cloud can't have an anisotropy below 1/3 (perfectly
+// isotropic). Lower values come from attractors that have collapsed to a
+// speck, where the 1e-6 in the anisotropy denominator dominates.
+//
+#define RA_MINE_MIN_ANISOTROPY  (1.0f / 3.0f)
+
+// Families drawn from the proposal, which are the only ones atlases map
+#define RA_MINE_FAMILY_ATLAS(NAME, COEFFICIENTS, COMPONENTS, SPREAD, DRAW, TIME) \
+    RA_DRAW_##DRAW == RA_DRAW_GAUSSIAN,
+static const bool ra_mine_family_atlas[RA_FAMILY_COUNT]
+    = { false, RA_FAMILIES(RA_MINE_FAMILY_ATLAS) };
+
+struct Miner;
+
+struct MinerWorker
+{
+    struct Miner *miner;
+    int           index;
+    thrd_t        thread;
+
+    // Unclaimed lane groups [next, end), which thieves take from the back of
+    mtx_t     lock;
+    long long next;
+    long long end;
+
+    // Best survivors so far, up to twice keep before they're trimmed
+    struct AttractorRecord *best;
+    size_t                  best_count;
+
+    struct AttractorFamilyStats stats;
+    // Only with /atlas, as it's several megabytes
+    struct AttractorAtlasCounts *atlas_counts;
+};
+
+struct Miner
+{
+    const char                  *catalog_path;
+    const char                  *atlas_path;
+    bool                         selftest;
+    struct AttractorEquations    equations;
+    struct AttractorSearchParams params;
+    uint32_t                     seed;
+    long long                    groups;
+    int                          thread_count;
+    size_t                       keep;
+
+    atomic_llong tested;
+    atomic_llong survived;
+    atomic_int   finished;
+
+    struct MinerWorker workers[RA_MINE_MAX_THREADS];
+};
+
+void ra_mine_print_help()
+{
+    printf("\n  ~~ Help ~~ \n");
+    printf("  ra_mine, the offline attractor miner for RandomAttractors.scr\n");
+    printf("  Usage:\n");
+    printf("      ra_mine <catalog> [extras]\n");
+    printf("      ra_mine /selftest [extras] - Check the lane groups against single candidates\n");
+    printf("  Extras:\n");
+    printf("      /groups <n>  - Lane groups of %d candidates to test (default %d)\n",
+        RA_ENGINE_LANES, RA_MINE_DEFAULT_GROUPS);
+    printf("      /threads <n> - Worker threads (default one per core, max %d)\n",
+        RA_MINE_MAX_THREADS);
+    printf("      /keep <n>    - Survivors to write to the catalog (default %d)\n",
+        RA_MINE_DEFAULT_KEEP);
+    printf("      /seed <n>    - Seed, so catalogs can be reproduced (default from the clock)\n");
+    printf("      /family <n>  - Only mine one attractor family (1 to %d, other than %d)\n",
+        RA_FAMILY_COUNT - 1, RA_FAMILY_CUSTOM);
+    printf("      /weights <w1> ... <w%d> - Relative chance of mining each family, skipping "
+           "family %d (default 1, but 0 for family %d)\n",
+        RA_FAMILY_BUILT_IN, RA_FAMILY_CUSTOM, RA_FAMILY_SPROTT);
+    printf("      /equations <file> - Only mine the attractor equations in the file\n");
+    printf("      /stages <warmup> <probe> <lyapunov> <test> - Suitability test iteration "
+           "budgets\n");
+    printf("      /warmup <window> <tolerance> - When the warm-up can stop early\n");
+    printf("      /converge <window> <tolerance> <margin> - When the full test can stop early\n");
+    printf("      /atlas <path> - Also map where candidates passed, and write a chaos atlas\n\n");
+}
+
+int ra_mine_core_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+/**
+ * Higher is better: chaotic (large Lyapunov exponent), and spread out across
+ * more than one axis (small anisotropy).
+ */
+float ra_mine_score(const struct AttractorRecord *record)
+{
+    return record->lyapunov * (1.0f - record->anisotropy);
+}
+
+int ra_mine_compare_records(const void *a, const void *b)
+{
+    float score_a = ra_mine_score(a);
+    float score_b = ra_mine_score(b);
+    return (score_a < score_b) - (score_a > score_b);
+}
+
+/**
+ * Group g tests candidate keys [g * RA_ENGINE_LANES, (g + 1) * RA_ENGINE_LANES),
+ * each from its own stream, so the catalog doesn't depend on which worker
+ * happened to test it, and a key can be reseeded alone with
+ * ra_engine_seed_key.
+ */
+uint32_t ra_mine_group_key(long long group)
+{
+    return (uint32_t)(group * RA_ENGINE_LANES);
+}
+
+/**
+ * How often each family passed the suitability test, and what that cost.
+ * Families with a low yield are the ones to turn down with /weights.
+ */
+void ra_mine_print_stats(const struct AttractorFamilyStats *stats)
+{
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        if (stats->tested[family] == 0) continue;
+
+        double tested   = (double)stats->tested[family];
+        double suitable = (double)stats->suitable[family];
+        double steps    = (double)stats->steps[family];
+        double warmup   = (double)stats->warmup[family];
+        printf("  family %d: %llu tested, %.2f%% suitable, %.0f steps per candidate, "
+               "%.0f steps per suitable, %.0f warm-up\n",
+            family, (unsigned long long)stats->tested[family], 100.0 * suitable / tested,
+            steps / tested, suitable > 0 ? steps / suitable : steps, warmup / tested);
+    }
+}
+
+bool ra_mine_claim(struct MinerWorker *worker, long long *begin, long long *end)
+{
+    mtx_lock(&worker->lock);
+
+    bool claimed = worker->next < worker->end;
+    if (claimed)
+    {
+        *begin       = worker->next;
+        *end         = worker->next + RA_MINE_CHUNK_GROUPS < worker->end
+            ? worker->next + RA_MINE_CHUNK_GROUPS
+            : worker->end;
+        worker->next = *end;
+    }
+
+    mtx_unlock(&worker->lock);
+    return claimed;
+}
+
+/**
+ * Take the back half of the first victim with more than a chunk left.
+ *
+ * @returns false once there's nothing worth stealing anywhere
+ */
+bool ra_mine_steal(struct MinerWorker *thief)
+{
+    struct Miner *miner = thief->miner;
+
+    for (int i = 1; i < miner->thread_count; i++)
+    {
+        struct MinerWorker *victim = &miner->workers[(thief->index + i) % miner->thread_count];
+
+        long long begin = 0;
+        long long end   = 0;
+
+        mtx_lock(&victim->lock);
+        long long remaining = victim->end - victim->next;
+        if (remaining > RA_MINE_CHUNK_GROUPS)
+        {
+            begin       = victim->end - remaining / 2;
+            end         = victim->end;
+            victim->end = begin;
+        }
+        mtx_unlock(&victim->lock);
+
+        if (begin < end)
+        {
+            mtx_lock(&thief->lock);
+            thief->next = begin;
+            thief->end  = end;
+            mtx_unlock(&thief->lock);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ra_mine_keep(struct MinerWorker *worker, const struct AttractorRecord *record)
+{
+    struct Miner *miner = worker->miner;
+
+    worker->best[worker->best_count++] = *record;
+    if (worker->best_count < 2 * miner->keep) return;
+
+    qsort(worker->best, worker->best_count, sizeof(*worker->best), ra_mine_compare_records);
+    worker->best_count = miner->keep;
+}
+
+int ra_mine_worker(void *arg)
+{
+    struct MinerWorker *worker = arg;
+    struct Miner       *miner  = worker->miner;
+
+    struct AttractorCandidate survivors[RA_ENGINE_LANES];
+    struct AttractorVerdict   verdicts[RA_ENGINE_LANES];
+
+    while (true)
+    {
+        long long begin = 0;
+        long long end   = 0;
+        if (!ra_mine_claim(worker, &begin, &end))
+        {
+            if (!ra_mine_steal(worker)) break;
+            continue;
+        }
+
+        long long survived = 0;
+        for (long long group = begin; group < end; group++)
+        {
+            uint32_t key   = ra_mine_group_key(group);
+            int      count = ra_engine_test_group(
+                &miner->params, miner->seed, key, survivors, verdicts, &worker->stats,
+                worker->atlas_counts);
+
+            for (int i = 0; i < count; i++)
+            {
+                if (verdicts[i].anisotropy < RA_MINE_MIN_ANISOTROPY) continue;
+
+                struct AttractorRecord record = {
+                    .candidate  = survivors[i],
+                    .lyapunov   = verdicts[i].lyapunov,
+                    .anisotropy = verdicts[i].anisotropy,
+                };
+                ra_mine_keep(worker, &record);
+                survived++;
+            }
+        }
+
+        atomic_fetch_add(&miner->tested, (end - begin) * RA_ENGINE_LANES);
+        atomic_fetch_add(&miner->survived, survived);
+    }
+
+    atomic_fetch_add(&miner->finished, 1);
+    return 0;
+}
+
+bool ra_mine_parse_args(struct Miner *miner, int argc, char *argv[])
+{
+    if (argc < 2) return false;
+
+    // The self-test writes nothing, and is reproducible unless told otherwise
+    miner->selftest     = strcmp(argv[1], "/selftest") == 0;
+    miner->catalog_path = miner->selftest ? NULL : argv[1];
+    miner->seed         = miner->selftest ? RA_MINE_SELFTEST_SEED : (uint32_t)time(NULL);
+    miner->groups       = miner->selftest ? RA_MINE_SELFTEST_GROUPS : RA_MINE_DEFAULT_GROUPS;
+    miner->thread_count = ra_mine_core_count();
+    miner->keep         = RA_MINE_DEFAULT_KEEP;
+    ra_engine_default_params(&miner->params);
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "/groups") == 0 && i + 1 < argc)
+        {
+            miner->groups = strtoll(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "/threads") == 0 && i + 1 < argc)
+        {
+            miner->thread_count = (int)strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "/keep") == 0 && i + 1 < argc)
+        {
+            miner->keep = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "/seed") == 0 && i + 1 < argc)
+        {
+            miner->seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "/family") == 0 && i + 1 < argc)
+        {
+            miner->params.family = (int)strtol(argv[++i], NULL, 10);
+            if (miner->params.family <= RA_FAMILY_NONE || RA_FAMILY_COUNT <= miner->params.family
+                || miner->params.family == RA_FAMILY_CUSTOM)
+            {
+                printf("Family must be between 1 and %d, other than %d (custom attractors need "
+                       "/equations)\n",
+                    RA_FAMILY_COUNT - 1, RA_FAMILY_CUSTOM);
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "/weights") == 0 && i + RA_FAMILY_BUILT_IN < argc)
+        {
+            for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+            {
+                if (family == RA_FAMILY_CUSTOM) continue;
+                miner->params.family_weights[family] = strtof(argv[++i], NULL);
+            }
+        }
+        else if (strcmp(argv[i], "/stages") == 0 && i + 4 < argc)
+        {
+            miner->params.warmup_iterations         = (int)strtol(argv[++i], NULL, 10);
+            miner->params.probe_iterations          = (int)strtol(argv[++i], NULL, 10);
+            miner->params.lyapunov_probe_iterations = (int)strtol(argv[++i], NULL, 10);
+            miner->params.test_iterations           = (int)strtol(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "/warmup") == 0 && i + 2 < argc)
+        {
+            miner->params.warmup_window    = (int)strtol(argv[++i], NULL, 10);
+            miner->params.warmup_tolerance = strtof(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "/converge") == 0 && i + 3 < argc)
+        {
+            miner->params.lyapunov_window    = (int)strtol(argv[++i], NULL, 10);
+            miner->params.lyapunov_tolerance = strtof(argv[++i], NULL);
+            miner->params.lyapunov_margin    = strtof(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "/atlas") == 0 && i + 1 < argc)
+        {
+            miner->atlas_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "/equations") == 0 && i + 1 < argc)
+        {
+            char        error[RA_EQUATIONS_ERROR_LENGTH];
+            const char *path = argv[++i];
+            if (!ra_equations_load(&miner->equations, path, error, sizeof(error)))
+            {
+                printf("Couldn't compile the equations in %s: %s\n", path, error);
+                return false;
+            }
+            miner->params.equations = &miner->equations;
+            miner->params.family    = RA_FAMILY_CUSTOM;
+        }
+        else
+        {
+            printf("Unrecognised argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    if (miner->thread_count < 1) miner->thread_count = 1;
+    if (miner->thread_count > RA_MINE_MAX_THREADS) miner->thread_count = RA_MINE_MAX_THREADS;
+    if (miner->groups < 1 || miner->keep < 1)
+    {
+        printf("Groups and keep must both be at least 1\n");
+        return false;
+    }
+    if (miner->groups > (long long)(UINT32_MAX / RA_ENGINE_LANES))
+    {
+        // Past this the candidate keys would wrap around and repeat
+        printf("At most %lld groups can be tested with one seed\n",
+            (long long)(UINT32_MAX / RA_ENGINE_LANES));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Whether two points are bit for bit the same, where any NaN matches any
+ * other, as its sign and payload are up to the instructions that made it.
+ */
+bool ra_mine_same_point(const float a[4], const float b[4])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (isnan(a[i]) && isnan(b[i])) continue;
+        if (memcmp(&a[i], &b[i], sizeof(a[i])) != 0) return false;
+    }
+    return true;
+}
+
+/**
+ * Check one family's lane groups, each against the candidates it stands for.
+ *
+ * @returns How many candidates disagreed
+ */
+long long ra_mine_selftest_family(const struct Miner *miner, enum RA_Family family)
+{
+    struct AttractorSearchParams params = miner->params;
+    params.family                       = family;
+
+    // Just the warm-up, which never stops early, so every lane the pre-screen
+    // passes takes exactly warmup_iterations steps
+    struct AttractorSearchParams walk = params;
+    walk.warmup_window                = 0;
+    walk.probe_iterations             = 0;
+    walk.lyapunov_probe_iterations    = 0;
+    walk.test_iterations              = 0;
+
+    long long checked    = 0;
+    long long walked     = 0;
+    long long mismatches = 0;
+
+    for (long long group = 0; group < miner->groups; group++)
+    {
+        uint32_t key = ra_mine_group_key(group);
+
+        struct AttractorCandidate candidates[RA_ENGINE_LANES];
+        struct AttractorRng       rngs[RA_ENGINE_LANES];
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            ra_engine_seed_key(&candidates[l], &params, miner->seed, key + (uint32_t)l);
+            ra_engine_rng_init(&rngs[l], miner->seed, key + (uint32_t)l + 1);
+        }
+
+        //
+        // Every survivor of the full test must be the candidate
+        // ra_engine_seed_key() reseeds for one of the group's keys, as the
+        // catalog and the screensaver's CPU search rely on
+        //
+        struct AttractorCandidate found[RA_ENGINE_LANES];
+        struct AttractorVerdict   verdicts[RA_ENGINE_LANES];
+        int count = ra_engine_test_group(&params, miner->seed, key, found, verdicts, NULL, NULL);
+        for (int i = 0; i < count; i++)
+        {
+            bool seeded = false;
+            for (int l = 0; l < RA_ENGINE_LANES && !seeded; l++)
+            {
+                seeded = memcmp(found[i].coeff, candidates[l].coeff, sizeof(found[i].coeff)) == 0;
+            }
+            mismatches += !seeded;
+            checked++;
+        }
+
+        //
+        // Every lane must walk exactly where ra_engine_step_candidate() walks
+        // its candidate alone
+        //
+        struct AttractorLanes lanes;
+        ra_engine_pack_lanes(&lanes, candidates, rngs);
+        ra_engine_test_lanes(&lanes, &walk);
+        for (int l = 0; l < RA_ENGINE_LANES; l++)
+        {
+            struct AttractorCandidate lane;
+            ra_engine_unpack_lane(&lanes, l, &lane);
+
+            struct AttractorCandidate alone = candidates[l];
+            for (int i = 0; i < lanes.verdict[l].warmup; i++)
+            {
+                ra_engine_step_candidate(&alone, params.equations);
+            }
+
+            bool same = ra_mine_same_point(lane.previous[0], alone.previous[0]);
+            if (lanes.verdict[l].warmup > 0)
+            {
+                same = same && ra_mine_same_point(lane.previous[1], alone.previous[1]);
+                walked++;
+            }
+            mismatches += !same;
+            checked++;
+        }
+    }
+
+    printf("  family %d: %lld checked (%lld walked), %lld mismatched\n", family, checked, walked,
+        mismatches);
+    return mismatches;
+}
+
+/**
+ * Test the engine against itself, with no GPU: the lane groups (with SIMD,
+ * if this CPU runs it) against ra_engine_seed_key() and the single candidate
+ * path the screensaver draws with, for every family or just the one asked
+ * for. Both must agree bit for bit, which they only do if the compiler
+ * didn't fuse any multiply-adds (-ffp-contract=off).
+ *
+ * @returns Whether everything agreed
+ */
+bool ra_mine_selftest(const struct Miner *miner)
+{
+    printf("Self-testing %lld group(s) of %d (%s) per family with seed %u...\n", miner->groups,
+        RA_ENGINE_LANES, ra_engine_simd(), miner->seed);
+
+    long long mismatches = 0;
+    for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+    {
+        if (miner->params.family != RA_FAMILY_NONE && family != miner->params.family) continue;
+        if (family == RA_FAMILY_CUSTOM && miner->params.equations == NULL) continue;
+
+        mismatches += ra_mine_selftest_family(miner, (enum RA_Family)family);
+    }
+
+    printf(mismatches == 0 ? "Passed\n" : "FAILED\n");
+    return mismatches == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct Miner miner = { 0 };
+
+    if (!ra_mine_parse_args(&miner, argc, argv))
+    {
+        ra_mine_print_help();
+        return 1;
+    }
+    if (miner.selftest) return ra_mine_selftest(&miner) ? 0 : 1;
+
+    printf("Mining %lld candidates in groups of %d (%s) on %d thread(s) with seed %u...\n",
+        miner.groups * RA_ENGINE_LANES, RA_ENGINE_LANES, ra_engine_simd(), miner.thread_count,
+        miner.seed);
+
+    //
+    // Split the groups evenly to start with, and let stealing even it out
+    //
+    for (int t = 0; t < miner.thread_count; t++)
+    {
+        struct MinerWorker *worker = &miner.workers[t];
+        worker->miner              = &miner;
+        worker->index              = t;
+        worker->next               = miner.groups * t / miner.thread_count;
+        worker->end                = miner.groups * (t + 1) / miner.thread_count;
+        worker->best               = malloc(2 * miner.keep * sizeof(*worker->best));
+        worker->atlas_counts
+            = miner.atlas_path ? calloc(1, sizeof(*worker->atlas_counts)) : NULL;
+        mtx_init(&worker->lock, mtx_plain);
+    }
+    for (int t = 0; t < miner.thread_count; t++)
+    {
+        thrd_create(&miner.workers[t].thread, ra_mine_worker, &miner.workers[t]);
+    }
+
+    //
+    // Progress
+    //
+    time_t start = time(NULL);
+    while (atomic_load(&miner.finished) < miner.thread_count)
+    {
+        thrd_sleep(&(struct timespec){ .tv_sec = 1 }, NULL);
+
+        long long tested   = atomic_load(&miner.tested);
+        long long survived = atomic_load(&miner.survived);
+        double    elapsed  = difftime(time(NULL), start);
+        printf("\r  %lld tested, %lld suitable (%.0f candidates/s)   ", tested, survived,
+            elapsed > 0 ? tested / elapsed : 0.0);
+        fflush(stdout);
+    }
+    printf("\n");
+
+    //
+    // Merge every worker's best, rank them, and keep the very best
+    //
+    size_t                      total   = 0;
+    struct AttractorRecord     *ranking
+        = malloc(miner.thread_count * 2 * miner.keep * sizeof(*ranking));
+    struct AttractorFamilyStats stats   = { 0 };
+    for (int t = 0; t < miner.thread_count; t++)
+    {
+        struct MinerWorker *worker = &miner.workers[t];
+        thrd_join(worker->thread, NULL);
+
+        memcpy(&ranking[total], worker->best, worker->best_count * sizeof(*ranking));
+        total += worker->best_count;
+        ra_engine_add_stats(&stats, &worker->stats);
+        if (t > 0 && worker->atlas_counts)
+            ra_engine_add_atlas_counts(miner.workers[0].atlas_counts, worker->atlas_counts);
+
+        free(worker->best);
+        mtx_destroy(&worker->lock);
+    }
+
+    ra_mine_print_stats(&stats);
+
+    //
+    // Fit the atlas to every worker's counts, which are all in the first's
+    //
+    if (miner.atlas_path)
+    {
+        static struct AttractorAtlas atlas;
+        ra_engine_fit_atlas(&atlas, miner.workers[0].atlas_counts);
+        for (int t = 0; t < miner.thread_count; t++) free(miner.workers[t].atlas_counts);
+
+        for (int family = RA_FAMILY_NONE + 1; family < RA_FAMILY_COUNT; family++)
+        {
+            if (stats.tested[family] == 0 || !ra_mine_family_atlas[family]) continue;
+            printf("  family %d atlas: coefficients %d.%c and %d.%c\n", family,
+                atlas.axes[family][0] / 3, "xyz"[atlas.axes[family][0] % 3],
+                atlas.axes[family][1] / 3, "xyz"[atlas.axes[family][1] % 3]);
+        }
+
+        if (!ra_cache_write_atlas(miner.atlas_path, &atlas))
+        {
+            printf("Couldn't write the atlas to %s\n", miner.atlas_path);
+            return 1;
+        }
+        printf("Wrote the atlas to %s\n", miner.atlas_path);
+    }
+
+    qsort(ranking, total, sizeof(*ranking), ra_mine_compare_records);
+    if (total > miner.keep) total = miner.keep;
+
+    for (size_t i = 0; i < total && i < 5; i++)
+    {
+        printf("  #%zu: family=%d lyapunov=%f anisotropy=%f\n", i + 1, ranking[i].candidate.family,
+            ranking[i].lyapunov, ranking[i].anisotropy);
+    }
+
+    bool written = ra_cache_write(miner.catalog_path, ranking, total);
+    free(ranking);
+    if (!written)
+    {
+        printf("Couldn't write the catalog to %s\n", miner.catalog_path);
+        return 1;
+    }
+
+    printf("Wrote %zu attractor(s) to %s\n", total, miner.catalog_path);
+    return 0;
+}